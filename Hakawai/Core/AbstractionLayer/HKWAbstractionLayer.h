@@ -96,6 +96,9 @@
  \param textView    the \c UITextView or subclass (e.g. HKWTextView) which the layer should sit atop
  \param enabled     whether or not to enable the change rejection feature (the delegate can choose to reject changes,
                     but this requires extra memory consumption to store the text state)
+ \note With change rejection enabled, programmatic changes to the text view's text must be bracketed by \c pushIgnore
+       and \c popIgnore, or followed by \c textViewDidProgrammaticallyUpdate. Otherwise a change the delegate rejects
+       afterwards can't be rolled back, and is left in the text.
  */
 + (instancetype)instanceWithTextView:(UITextView *)textView changeRejection:(BOOL)enabled;
 
@@ -16,6 +16,8 @@
 
 #import "HKWAbstractionLayer.h"
 
+#import "_HKWPrivateConstants.h"
+
 /*!
  An enum describing the states the state machine can be in.
  
@@ -81,6 +83,24 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
     HKWAbstractionLayerInputModeKorean
 };
 
+/*!
+ The largest number of edits the change rejection journal holds. An editing run which makes more edits than this, such
+ as a long run of marked text, falls back to a copy of the text as it was before the run.
+ */
+static const NSUInteger HKWAbstractionLayerEditJournalCapacity = 64;
+
+/*!
+ An edit made to the text view's text, recorded so that it can be undone if the delegate rejects the change it is part
+ of. \c range is the range of the text which replaced \c replacedText.
+ */
+@interface HKWAbstractionLayerEdit : NSObject
+@property (nonatomic) NSRange range;
+@property (nonatomic, strong) NSAttributedString *replacedText;
+@end
+
+@implementation HKWAbstractionLayerEdit
+@end
+
 @interface HKWAbstractionLayer ()
 
 @property (nonatomic, weak) UITextView *parentTextView;
@@ -139,8 +159,21 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
 @property (nonatomic) NSRange changeRange;
 @property (nonatomic) BOOL changeIsPaste;
 
+// Whether the delegate can reject changes. Only the edits reported through textViewShouldChangeTextInRange:... can be
+//  rolled back; any other change to the text must be bracketed by pushIgnore/popIgnore or followed by
+//  textViewDidProgrammaticallyUpdate, so that it is accepted. Otherwise a change rejected later in the same editing run
+//  is logged and left in the text, rather than rolled back to a state that never existed.
 @property (nonatomic) BOOL changeRejectionEnabled;
-@property (nonatomic, strong) NSAttributedString *previousText;
+
+// Change rejection properties. The edits made since the text was last accepted are journaled as they are made, so that
+//  a rejected change can be rolled back by undoing only those edits, rather than by keeping a copy of the entire text.
+@property (nonatomic, strong) NSMutableArray<HKWAbstractionLayerEdit *> *editJournal;
+/// The length the text should have once every journaled edit has been made.
+@property (nonatomic) NSUInteger editJournalTextLength;
+/// A copy of the text as it was last accepted, taken if the edits made since then no longer fit in the journal.
+@property (nonatomic, strong) NSAttributedString *acceptedTextSnapshot;
+/// Whether the text was changed in a way the journal didn't record, so that it can no longer be used to roll back.
+@property (nonatomic) BOOL editJournalInvalid;
 
 @end
 
@@ -175,7 +208,8 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
 
     self.changeRejectionEnabled = enabled;
     if (enabled) {
-        self.previousText = [textView.attributedText copy];
+        self.editJournal = [NSMutableArray array];
+        [self acceptText];
     }
 }
 
@@ -210,7 +244,7 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
     self.previousTextLength = [textView.attributedText length];
     self.previousSelectedRange = textView.selectedRange;
     if (self.changeRejectionEnabled) {
-        self.previousText = [textView.attributedText copy];
+        [self acceptText];
     }
 }
 
@@ -356,6 +390,9 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
             NSAssert(NO, @"Internal error: illegal state transition");
             break;
     }
+    if (self.changeRejectionEnabled) {
+        [self recordEditInRange:range replacementText:text];
+    }
     return YES;
 }
 
@@ -504,10 +541,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                    autocorrect:NO];
                         if (self.changeRejectionEnabled) {
                             if (shouldChange) {
-                                self.previousText = [parentTextView.attributedText copy];
+                                [self acceptText];
                             }
                             else {
-                                parentTextView.attributedText = [self.previousText copy];
+                                [self rejectText];
                                 self.state = HKWAbstractionLayerStateQuiescent;
                             }
                         }
@@ -547,10 +584,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                            autocorrect:!self.changeIsPaste];
                                 if (self.changeRejectionEnabled) {
                                     if (shouldChange) {
-                                        self.previousText = [parentTextView.attributedText copy];
+                                        [self acceptText];
                                     }
                                     else {
-                                        parentTextView.attributedText = [self.previousText copy];
+                                        [self rejectText];
                                         self.state = HKWAbstractionLayerStateQuiescent;
                                     }
                                 }
@@ -563,10 +600,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                                 length:[self.changeString length]];
                                 if (self.changeRejectionEnabled) {
                                     if (shouldChange) {
-                                        self.previousText = [parentTextView.attributedText copy];
+                                        [self acceptText];
                                     }
                                     else {
-                                        parentTextView.attributedText = [self.previousText copy];
+                                        [self rejectText];
                                         self.state = HKWAbstractionLayerStateQuiescent;
                                     }
                                 }
@@ -580,10 +617,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                            autocorrect:!self.changeIsPaste];
                                 if (self.changeRejectionEnabled) {
                                     if (shouldChange) {
-                                        self.previousText = [parentTextView.attributedText copy];
+                                        [self acceptText];
                                     }
                                     else {
-                                        parentTextView.attributedText = [self.previousText copy];
+                                        [self rejectText];
                                         self.state = HKWAbstractionLayerStateQuiescent;
                                     }
                                 }
@@ -627,10 +664,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                                 length:length];
                                 if (self.changeRejectionEnabled) {
                                     if (shouldChange) {
-                                        self.previousText = [parentTextView.attributedText copy];
+                                        [self acceptText];
                                     }
                                     else {
-                                        parentTextView.attributedText = [self.previousText copy];
+                                        [self rejectText];
                                         self.state = HKWAbstractionLayerStateQuiescent;
                                     }
                                 }
@@ -649,10 +686,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                            autocorrect:NO];
                                 if (self.changeRejectionEnabled) {
                                     if (shouldChange) {
-                                        self.previousText = [parentTextView.attributedText copy];
+                                        [self acceptText];
                                     }
                                     else {
-                                        parentTextView.attributedText = [self.previousText copy];
+                                        [self rejectText];
                                         self.state = HKWAbstractionLayerStateQuiescent;
                                     }
                                 }
@@ -677,10 +714,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                                            autocorrect:NO];
                                 if (self.changeRejectionEnabled) {
                                     if (shouldChange) {
-                                        self.previousText = [parentTextView.attributedText copy];
+                                        [self acceptText];
                                     }
                                     else {
-                                        parentTextView.attributedText = [self.previousText copy];
+                                        [self rejectText];
                                         self.state = HKWAbstractionLayerStateQuiescent;
                                     }
                                 }
@@ -713,10 +750,10 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
                                            autocorrect:NO];
                 if (self.changeRejectionEnabled) {
                     if (shouldChange) {
-                        self.previousText = [parentTextView.attributedText copy];
+                        [self acceptText];
                     }
                     else {
-                        parentTextView.attributedText = [self.previousText copy];
+                        [self rejectText];
                         self.state = HKWAbstractionLayerStateQuiescent;
                     }
                 }
@@ -728,6 +765,102 @@ typedef NS_ENUM(NSInteger, HKWAbstractionLayerInputMode) {
 }
 
 
+#pragma mark - Change rejection
+
+/*!
+ Record an edit the text view is about to make to its text, so that it can be undone if the change it is part of is
+ rejected.
+ */
+- (void)recordEditInRange:(NSRange)range replacementText:(NSString *)text {
+    if (self.editJournalInvalid || self.acceptedTextSnapshot) {
+        return;
+    }
+    [self discardJournaledEditIfNotMade];
+    NSTextStorage *textStorage = self.parentTextView.textStorage;
+    if ([textStorage length] != self.editJournalTextLength || NSMaxRange(range) > [textStorage length]) {
+        // The text was changed without going through the journal
+        self.editJournalInvalid = YES;
+        [self.editJournal removeAllObjects];
+        return;
+    }
+    if ([self.editJournal count] == HKWAbstractionLayerEditJournalCapacity) {
+        // Rebuild the accepted text once, and roll back to it for the rest of the editing run
+        NSMutableAttributedString *acceptedText = [textStorage mutableCopy];
+        [self undoJournaledEditsInAttributedString:acceptedText];
+        self.acceptedTextSnapshot = [acceptedText copy];
+        [self.editJournal removeAllObjects];
+        return;
+    }
+    HKWAbstractionLayerEdit *edit = [HKWAbstractionLayerEdit new];
+    edit.range = NSMakeRange(range.location, [text length]);
+    edit.replacedText = [textStorage attributedSubstringFromRange:range];
+    [self.editJournal addObject:edit];
+    self.editJournalTextLength = self.editJournalTextLength - range.length + [text length];
+}
+
+/*!
+ Discard the most recently journaled edit if the text view didn't end up making it, as happens when the text view
+ replaces a space it was about to insert with a period, or drops a predictive suggestion.
+ */
+- (void)discardJournaledEditIfNotMade {
+    HKWAbstractionLayerEdit *edit = [self.editJournal lastObject];
+    NSTextStorage *textStorage = self.parentTextView.textStorage;
+    if (!edit || [textStorage length] == self.editJournalTextLength) {
+        return;
+    }
+    NSUInteger lengthBeforeEdit = self.editJournalTextLength - edit.range.length + [edit.replacedText length];
+    NSRange replacedRange = NSMakeRange(edit.range.location, [edit.replacedText length]);
+    if ([textStorage length] == lengthBeforeEdit
+        && NSMaxRange(replacedRange) <= [textStorage length]
+        && [[textStorage.string substringWithRange:replacedRange] isEqualToString:edit.replacedText.string]) {
+        [self.editJournal removeLastObject];
+        self.editJournalTextLength = lengthBeforeEdit;
+    }
+}
+
+/*!
+ Undo the journaled edits, most recent first, on an attributed string holding the text as it is now.
+ */
+- (void)undoJournaledEditsInAttributedString:(NSMutableAttributedString *)string {
+    for (HKWAbstractionLayerEdit *edit in [self.editJournal reverseObjectEnumerator]) {
+        [string replaceCharactersInRange:edit.range withAttributedString:edit.replacedText];
+    }
+}
+
+/*!
+ Mark the text view's current text as accepted, discarding the edits journaled so far.
+ */
+- (void)acceptText {
+    [self.editJournal removeAllObjects];
+    self.editJournalTextLength = [self.parentTextView.textStorage length];
+    self.acceptedTextSnapshot = nil;
+    self.editJournalInvalid = NO;
+}
+
+/*!
+ Roll the text view's text back to the text which was last accepted. Only the journaled edits are undone, through the
+ text storage, unless the editing run outgrew the journal.
+ */
+- (void)rejectText {
+    UITextView *parentTextView = self.parentTextView;
+    NSTextStorage *textStorage = parentTextView.textStorage;
+    [self discardJournaledEditIfNotMade];
+    if (self.acceptedTextSnapshot) {
+        parentTextView.attributedText = self.acceptedTextSnapshot;
+    }
+    else if (!self.editJournalInvalid && [textStorage length] == self.editJournalTextLength) {
+        [textStorage beginEditing];
+        [self undoJournaledEditsInAttributedString:textStorage];
+        [textStorage endEditing];
+    }
+    else {
+        // The text was changed without going through the journal, so there is nothing reliable to roll back to. Leave
+        //  the text as it is rather than corrupting it.
+        HKWLOG(@"WARNING: a rejected change couldn't be rolled back, since the text was changed outside the journal");
+    }
+    [self acceptText];
+}
+
 #pragma mark - Private helper methods
 
 - (HKWAbstractionLayerInputMode)inputMode {
@@ -72,6 +72,19 @@
     [self.tableView reloadData];
 }
 
+- (void)performBatchUpdates:(void (^)(UITableView *))updates {
+    UITableView *tableView = self.tableView;
+    if (@available(iOS 11.0, *)) {
+        [tableView performBatchUpdates:^{
+            updates(tableView);
+        } completion:nil];
+    } else {
+        [tableView beginUpdates];
+        updates(tableView);
+        [tableView endUpdates];
+    }
+}
+
 - (void)becomeVisible {
     self.hidden = NO;
     UIAccessibilityPostNotification(UIAccessibilityLayoutChangedNotification, nil);
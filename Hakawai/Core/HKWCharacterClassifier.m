@@ -0,0 +1,245 @@
+//
+//  HKWCharacterClassifier.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "_HKWCharacterClassifier.h"
+
+/// The size, in bytes, of a bitmap with one bit for each code point of the Basic Multilingual Plane.
+#define HKW_BMP_BITMAP_LENGTH 8192
+
+static uint8_t HKWWhitespaceBitmap[HKW_BMP_BITMAP_LENGTH];
+static uint8_t HKWPunctuationBitmap[HKW_BMP_BITMAP_LENGTH];
+static uint8_t HKWAlphanumericBitmap[HKW_BMP_BITMAP_LENGTH];
+static NSCharacterSet *HKWWhitespaceSet;
+static NSCharacterSet *HKWPunctuationSet;
+static NSCharacterSet *HKWAlphanumericSet;
+/// The shared classes which have members outside the BMP, and therefore need the surrogate pair fallback.
+static HKWCharacterClass HKWSharedSupplementaryClasses;
+
+NS_INLINE BOOL HKWBitmapContainsCharacter(const uint8_t *bitmap, unichar c) {
+    return (bitmap[c >> 3] & (1 << (c & 7))) != 0;
+}
+
+/*!
+ Return whether a UTF-16 code unit is a member of any of the classes in the mask, consulting only the bitmaps which the
+ mask requires.
+ */
+NS_INLINE BOOL HKWCharacterMatchesMask(const uint8_t *controlBitmap, HKWCharacterClass mask, unichar c) {
+    return (((mask & HKWCharacterClassWhitespace) && HKWBitmapContainsCharacter(HKWWhitespaceBitmap, c))
+            || ((mask & HKWCharacterClassPunctuation) && HKWBitmapContainsCharacter(HKWPunctuationBitmap, c))
+            || ((mask & HKWCharacterClassControl) && HKWBitmapContainsCharacter(controlBitmap, c))
+            || ((mask & HKWCharacterClassAlphanumeric) && HKWBitmapContainsCharacter(HKWAlphanumericBitmap, c)));
+}
+
+/*!
+ Copy the BMP portion of a character set's bitmap representation into \c bitmap, and return whether the set has any
+ members outside the BMP.
+ */
+static BOOL HKWCompileCharacterSet(NSCharacterSet *characterSet, uint8_t *bitmap) {
+    memset(bitmap, 0, HKW_BMP_BITMAP_LENGTH);
+    if (!characterSet) {
+        return NO;
+    }
+    NSData *representation = [characterSet bitmapRepresentation];
+    [representation getBytes:bitmap length:MIN([representation length], (NSUInteger)HKW_BMP_BITMAP_LENGTH)];
+    for (uint8_t plane = 1; plane <= 16; plane++) {
+        if ([characterSet hasMemberInPlane:plane]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+@interface HKWCharacterClassifier () {
+    uint8_t _controlBitmap[HKW_BMP_BITMAP_LENGTH];
+}
+
+@property (nonatomic, readwrite, nullable) NSCharacterSet *controlCharacterSet;
+
+/// The classes, shared or not, which need the surrogate pair fallback.
+@property (nonatomic) HKWCharacterClass supplementaryClasses;
+
+@end
+
+@implementation HKWCharacterClassifier
+
++ (void)initialize {
+    if (self != [HKWCharacterClassifier class]) {
+        return;
+    }
+    HKWWhitespaceSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    HKWPunctuationSet = [NSCharacterSet punctuationCharacterSet];
+    HKWAlphanumericSet = [NSCharacterSet alphanumericCharacterSet];
+    HKWSharedSupplementaryClasses = HKWCharacterClassNone;
+    if (HKWCompileCharacterSet(HKWWhitespaceSet, HKWWhitespaceBitmap)) {
+        HKWSharedSupplementaryClasses |= HKWCharacterClassWhitespace;
+    }
+    if (HKWCompileCharacterSet(HKWPunctuationSet, HKWPunctuationBitmap)) {
+        HKWSharedSupplementaryClasses |= HKWCharacterClassPunctuation;
+    }
+    if (HKWCompileCharacterSet(HKWAlphanumericSet, HKWAlphanumericBitmap)) {
+        HKWSharedSupplementaryClasses |= HKWCharacterClassAlphanumeric;
+    }
+}
+
++ (instancetype)sharedClassifier {
+    static HKWCharacterClassifier *sharedClassifier;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedClassifier = [self classifierWithControlCharacterSet:nil];
+    });
+    return sharedClassifier;
+}
+
++ (instancetype)classifierWithControlCharacterSet:(NSCharacterSet *)controlCharacterSet {
+    HKWCharacterClassifier *classifier = [[self class] new];
+    classifier.controlCharacterSet = [controlCharacterSet copy];
+    classifier.supplementaryClasses = HKWSharedSupplementaryClasses;
+    if (HKWCompileCharacterSet(classifier.controlCharacterSet, classifier->_controlBitmap)) {
+        classifier.supplementaryClasses |= HKWCharacterClassControl;
+    }
+    return classifier;
+}
+
+#pragma mark - API
+
+- (HKWCharacterClass)classOfCharacter:(unichar)character {
+    HKWCharacterClass characterClass = HKWCharacterClassNone;
+    if (HKWBitmapContainsCharacter(HKWWhitespaceBitmap, character)) {
+        characterClass |= HKWCharacterClassWhitespace;
+    }
+    if (HKWBitmapContainsCharacter(HKWPunctuationBitmap, character)) {
+        characterClass |= HKWCharacterClassPunctuation;
+    }
+    if (HKWBitmapContainsCharacter(_controlBitmap, character)) {
+        characterClass |= HKWCharacterClassControl;
+    }
+    if (HKWBitmapContainsCharacter(HKWAlphanumericBitmap, character)) {
+        characterClass |= HKWCharacterClassAlphanumeric;
+    }
+    return characterClass;
+}
+
+- (HKWCharacterClass)classOfLongCharacter:(UTF32Char)character {
+    if (character <= 0xFFFF) {
+        return [self classOfCharacter:(unichar)character];
+    }
+    HKWCharacterClass characterClass = HKWCharacterClassNone;
+    HKWCharacterClass supplementaryClasses = self.supplementaryClasses;
+    if ((supplementaryClasses & HKWCharacterClassWhitespace) && [HKWWhitespaceSet longCharacterIsMember:character]) {
+        characterClass |= HKWCharacterClassWhitespace;
+    }
+    if ((supplementaryClasses & HKWCharacterClassPunctuation) && [HKWPunctuationSet longCharacterIsMember:character]) {
+        characterClass |= HKWCharacterClassPunctuation;
+    }
+    if ((supplementaryClasses & HKWCharacterClassControl)
+        && [self.controlCharacterSet longCharacterIsMember:character]) {
+        characterClass |= HKWCharacterClassControl;
+    }
+    if ((supplementaryClasses & HKWCharacterClassAlphanumeric)
+        && [HKWAlphanumericSet longCharacterIsMember:character]) {
+        characterClass |= HKWCharacterClassAlphanumeric;
+    }
+    return characterClass;
+}
+
+- (BOOL)character:(unichar)character isInClass:(HKWCharacterClass)characterClass {
+    return HKWCharacterMatchesMask(_controlBitmap, characterClass, character);
+}
+
+- (NSUInteger)nextIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                             inCharacters:(const unichar *)characters
+                                   length:(NSUInteger)length
+                                fromIndex:(NSUInteger)location {
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithCharacters(&reader, characters, length);
+    return [self nextIndexOfCharacterInClass:characterClass inReader:&reader fromIndex:location];
+}
+
+- (NSUInteger)previousIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                 inCharacters:(const unichar *)characters
+                                       length:(NSUInteger)length
+                                        range:(NSRange)searchRange {
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithCharacters(&reader, characters, length);
+    return [self previousIndexOfCharacterInClass:characterClass inReader:&reader range:searchRange];
+}
+
+- (NSUInteger)nextIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                 inString:(NSString *)string
+                                fromIndex:(NSUInteger)location {
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, string);
+    return [self nextIndexOfCharacterInClass:characterClass inReader:&reader fromIndex:location];
+}
+
+- (NSUInteger)previousIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                     inString:(NSString *)string
+                                        range:(NSRange)searchRange {
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, string);
+    return [self previousIndexOfCharacterInClass:characterClass inReader:&reader range:searchRange];
+}
+
+- (NSUInteger)nextIndexOfCharacterInClass:(HKWCharacterClass)mask
+                                 inReader:(HKWCharacterReader *)reader
+                                fromIndex:(NSUInteger)location {
+    const NSUInteger length = reader->length;
+    const uint8_t *controlBitmap = _controlBitmap;
+    const BOOL needsFallback = (mask & self.supplementaryClasses) != 0;
+    for (NSUInteger i = location; i < length; i++) {
+        unichar c = HKWCharacterReaderCharacterAtIndex(reader, i);
+        if (needsFallback && CFStringIsSurrogateHighCharacter(c) && i + 1 < length) {
+            unichar low = HKWCharacterReaderCharacterAtIndex(reader, i + 1);
+            if (CFStringIsSurrogateLowCharacter(low)) {
+                if ([self classOfLongCharacter:CFStringGetLongCharacterForSurrogatePair(c, low)] & mask) {
+                    return i;
+                }
+                i++;
+                continue;
+            }
+        }
+        if (HKWCharacterMatchesMask(controlBitmap, mask, c)) {
+            return i;
+        }
+    }
+    return length;
+}
+
+- (NSUInteger)previousIndexOfCharacterInClass:(HKWCharacterClass)mask
+                                     inReader:(HKWCharacterReader *)reader
+                                        range:(NSRange)searchRange {
+    if (searchRange.location == NSNotFound) {
+        return NSNotFound;
+    }
+    const uint8_t *controlBitmap = _controlBitmap;
+    const BOOL needsFallback = (mask & self.supplementaryClasses) != 0;
+    const NSUInteger start = searchRange.location;
+    for (NSUInteger i = MIN(NSMaxRange(searchRange), reader->length); i > start; i--) {
+        unichar c = HKWCharacterReaderCharacterAtIndex(reader, i - 1);
+        if (needsFallback && CFStringIsSurrogateLowCharacter(c) && i - 1 > start) {
+            unichar high = HKWCharacterReaderCharacterAtIndex(reader, i - 2);
+            if (CFStringIsSurrogateHighCharacter(high)) {
+                if ([self classOfLongCharacter:CFStringGetLongCharacterForSurrogatePair(high, c)] & mask) {
+                    return i - 2;
+                }
+                i--;
+                continue;
+            }
+        }
+        if (HKWCharacterMatchesMask(controlBitmap, mask, c)) {
+            return i - 1;
+        }
+    }
+    return NSNotFound;
+}
+
+@end
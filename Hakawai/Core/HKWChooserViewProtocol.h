@@ -43,6 +43,13 @@ typedef NS_ENUM(NSInteger, HKWChooserBorderMode) {
 
 @optional
 
+/*!
+ Apply incremental changes to the chooser view's table view, instead of reloading all of its data. The block updates the
+ data source and makes the corresponding row and section changes, which are then applied together, so it must be called
+ synchronously within a batch of table view updates. If not implemented, \c reloadData is called instead.
+ */
+- (void)performBatchUpdates:(void (^)(UITableView *tableView))updates;
+
 /*!
  Return an instance of the chooser view with a given frame with no delegate. This method is intended for
  use with completely custom chooser views.
@@ -13,6 +13,7 @@
 #import "HKWTextView+Extras.h"
 
 #import "_HKWTextView.h"
+#import "_HKWCharacterClassifier.h"
 
 @interface HKWTextView ()
 @property (nonatomic, readonly) BOOL inInsertionMode;
@@ -55,42 +56,34 @@
 }
 
 - (NSRange)rangeForWordPrecedingLocation:(NSUInteger)location searchToEnd:(BOOL)toEnd {
-    NSCharacterSet *whitespaceNewlineSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    HKWCharacterClassifier *classifier = [HKWCharacterClassifier sharedClassifier];
+    NSString *text = self.textStorage.string;
+    NSUInteger textLength = [text length];
     if (!self.inInsertionMode
         || location == 0
-        || location > [self.text length]
-        || [whitespaceNewlineSet characterIsMember:[self characterPrecedingLocation:(NSInteger)location]]) {
+        || location > textLength
+        || [classifier character:[text characterAtIndex:location - 1] isInClass:HKWCharacterClassWhitespace]) {
         return NSMakeRange(NSNotFound, 0);
     }
-    // Walk backwards through the string to find the first delimiter.
-    NSUInteger firstLocation = 0;
-    for (NSInteger i=(NSInteger)location - 1; i>=0; i--) {
-        if (i > 0) {
-            unichar c = [self.text characterAtIndex:(NSUInteger)i];
-            if ([whitespaceNewlineSet characterIsMember:c]) {
-                firstLocation = (NSUInteger)i + 1;
-                break;
-            }
-        }
-    }
+    // Walk backwards through the string to find the first delimiter. The first character of the text is never treated
+    //  as a delimiter.
+    NSUInteger delimiterLocation = [classifier previousIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                                                      inString:text
+                                                                         range:NSMakeRange(1, location - 1)];
+    NSUInteger firstLocation = (delimiterLocation == NSNotFound ? 0 : delimiterLocation + 1);
     NSUInteger length;
-    if (location == [self.text length]
-        || [whitespaceNewlineSet characterIsMember:[self.text characterAtIndex:location]]
+    if (location == textLength
+        || [classifier character:[text characterAtIndex:location] isInClass:HKWCharacterClassWhitespace]
         || !toEnd) {
         // We're at the end of a word, or the end of the text field in general
         length = location - firstLocation;
     }
     else {
         // Walk forward through the string to find the end, or the next whitespace/newline
-        NSUInteger cursor = firstLocation;
-        while (cursor < [self.text length]) {
-            cursor++;
-            if ([whitespaceNewlineSet characterIsMember:[self characterPrecedingLocation:(NSInteger)cursor]]) {
-                cursor--;
-                break;
-            }
-        }
-        length = cursor - firstLocation;
+        NSUInteger end = [classifier nextIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                                        inString:text
+                                                       fromIndex:firstLocation];
+        length = end - firstLocation;
     }
     return NSMakeRange(firstLocation, length);
 }
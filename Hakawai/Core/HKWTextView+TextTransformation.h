@@ -43,6 +43,22 @@
 - (void)transformTextAtRange:(NSRange)range
              withTransformer:(NSAttributedString *(^)(NSAttributedString *))transformer;
 
+/*!
+ Perform a group of text transformations as a single transaction. Every call to \c transformTextAtRange:withTransformer:
+ (or a method built upon it) made within the block is applied directly to the text storage as part of one editing
+ session, so the text is processed and laid out only once. The external delegate's
+ \c textView:didChangeAttributedTextTo:originalText:originalRange: method is invoked once after the block runs, with the
+ smallest range containing all of the changes.
+
+ Once the transaction completes, the selection is restored relative to the changed text: a selection before the changed
+ text is left alone, a selection after it is shifted by the change in length, an insertion point within changed text
+ whose length didn't change stays where it was, and any other selection overlapping the changed text collapses to an
+ insertion point at its end. Transactions may be nested; only the outermost one applies these rules.
+
+ \param transformations    a block which performs the text transformations
+ */
+- (void)performBatchTransformations:(void (^)(void))transformations;
+
 /*!
  Insert plain text at an index location within the text view's attributed text. The text is formatted with the default
  attributes contained within the \c typingAttributes dictionary
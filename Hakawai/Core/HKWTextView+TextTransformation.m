@@ -37,8 +37,12 @@
 
 - (void)transformTextAtRangeImpl:(NSRange)range
                  withTransformer:(NSAttributedString *(^)(NSAttributedString *))transformer {
+    if (self.batchTransformationDepth > 0) {
+        [self transformTextInBatchAtRange:range withTransformer:transformer];
+        return;
+    }
     BOOL usingAbstraction = self.abstractionLayerEnabled;
-    if (transformer && [self.attributedText length] == 0 && range.location == 0) {
+    if (transformer && [self.textStorage length] == 0 && range.location == 0) {
         // Special case: text view text is empty; beginning is valid
         if (usingAbstraction) {
             [self.abstractionLayer pushIgnore];
@@ -53,7 +57,7 @@
     }
     if (!transformer
         || range.location == NSNotFound
-        || range.location > [self.attributedText length]) {
+        || range.location > [self.textStorage length]) {
         return;
     }
 
@@ -64,24 +68,46 @@
     NSRange originalSelectedRange = self.selectedRange;
     self.transformInProgress = YES;
     NSUInteger end = range.length + range.location;
-    if (end > [self.attributedText length]) {
+    if (end > [self.textStorage length]) {
         // Trim the range if it extends past the end of the string.
-        end = [self.attributedText length];
-        range.length = [self.attributedText length] - range.location;
+        end = [self.textStorage length];
+        range.length = [self.textStorage length] - range.location;
     }
-    NSAttributedString *originalInfix = [self.attributedText attributedSubstringFromRange:range];
-    NSAttributedString *prefixString = [self.attributedText attributedSubstringFromRange:NSMakeRange(0, range.location)];
-    NSAttributedString *infixString = transformer(originalInfix);
-    NSAttributedString *postfixString = [self.attributedText attributedSubstringFromRange:NSMakeRange(end, [self.attributedText length] - end)];
-    NSMutableAttributedString *buffer = [[NSMutableAttributedString alloc] initWithAttributedString:prefixString];
-    if (infixString) [buffer appendAttributedString:infixString];
-    if (postfixString) [buffer appendAttributedString:postfixString];
+    NSAttributedString *originalInfix = nil;
+    NSAttributedString *infixString = nil;
+    if (HKWTextView.enableInPlaceTextTransformation) {
+        // Edit the text storage directly, so that only the transformed range needs to be processed and laid out again
+        NSTextStorage *textStorage = self.textStorage;
+        originalInfix = [textStorage attributedSubstringFromRange:range];
+        infixString = transformer(originalInfix);
 
-    // We turn on 'autocorrect insertion rejection' before we set the text in order to reject a spurious additional
-    //  call to the shouldChange... method in the text view delegate
-    self.shouldRejectAutocorrectInsertions = YES;
-    self.attributedText = buffer;
-    self.shouldRejectAutocorrectInsertions = NO;
+        self.shouldRejectAutocorrectInsertions = YES;
+        [textStorage beginEditing];
+        [textStorage replaceCharactersInRange:range withAttributedString:infixString ?: [NSAttributedString new]];
+        [textStorage endEditing];
+        self.shouldRejectAutocorrectInsertions = NO;
+
+        if (originalSelectedRange.location != NSNotFound) {
+            self.selectedRange = [self selectedRangeAfterReplacingRange:range
+                                                             withLength:[infixString length]
+                                                  originalSelectedRange:originalSelectedRange];
+        }
+    }
+    else {
+        originalInfix = [self.attributedText attributedSubstringFromRange:range];
+        NSAttributedString *prefixString = [self.attributedText attributedSubstringFromRange:NSMakeRange(0, range.location)];
+        infixString = transformer(originalInfix);
+        NSAttributedString *postfixString = [self.attributedText attributedSubstringFromRange:NSMakeRange(end, [self.attributedText length] - end)];
+        NSMutableAttributedString *buffer = [[NSMutableAttributedString alloc] initWithAttributedString:prefixString];
+        if (infixString) [buffer appendAttributedString:infixString];
+        if (postfixString) [buffer appendAttributedString:postfixString];
+
+        // We turn on 'autocorrect insertion rejection' before we set the text in order to reject a spurious additional
+        //  call to the shouldChange... method in the text view delegate
+        self.shouldRejectAutocorrectInsertions = YES;
+        self.attributedText = buffer;
+        self.shouldRejectAutocorrectInsertions = NO;
+    }
 
     if (shouldRestore && range.length == [infixString length]) {
         // If the replacement text and the original text are the same length, restore the insertion cursor to its
@@ -98,6 +124,139 @@
     }
 }
 
+- (void)performBatchTransformations:(void (^)(void))transformations {
+    if (!transformations) {
+        return;
+    }
+    if (self.batchTransformationDepth > 0) {
+        // Nested transaction; the outermost one takes care of everything
+        self.batchTransformationDepth++;
+        transformations();
+        self.batchTransformationDepth--;
+        return;
+    }
+
+    BOOL usingAbstraction = self.abstractionLayerEnabled;
+    if (usingAbstraction) {
+        [self.abstractionLayer pushIgnore];
+    }
+    __strong __auto_type externalDelegate = self.externalDelegate;
+    BOOL shouldNotify = [externalDelegate respondsToSelector:@selector(textView:didChangeAttributedTextTo:originalText:originalRange:)];
+    NSTextStorage *textStorage = self.textStorage;
+    NSUInteger originalLength = [textStorage length];
+    NSRange originalSelectedRange = self.selectedRange;
+
+    self.batchChangedRange = NSMakeRange(NSNotFound, 0);
+    self.batchOriginalText = (shouldNotify ? [NSMutableAttributedString new] : nil);
+    self.transformInProgress = YES;
+    self.shouldRejectAutocorrectInsertions = YES;
+    self.batchTransformationDepth = 1;
+    [textStorage beginEditing];
+    transformations();
+    [textStorage endEditing];
+    self.batchTransformationDepth = 0;
+    self.shouldRejectAutocorrectInsertions = NO;
+
+    NSRange changedRange = self.batchChangedRange;
+    NSAttributedString *originalText = [self.batchOriginalText copy];
+    self.batchChangedRange = NSMakeRange(NSNotFound, 0);
+    self.batchOriginalText = nil;
+
+    // Every change lies within the changed range, so the difference in length is entirely accounted for there
+    NSRange originalRange = NSMakeRange(NSNotFound, 0);
+    if (changedRange.location != NSNotFound) {
+        originalRange = NSMakeRange(changedRange.location, changedRange.length + originalLength - [textStorage length]);
+        if (originalSelectedRange.location != NSNotFound) {
+            BOOL lengthUnchanged = (originalRange.length == changedRange.length);
+            self.selectedRange = ((lengthUnchanged && originalSelectedRange.length == 0)
+                                  ? originalSelectedRange
+                                  : [self selectedRangeAfterReplacingRange:originalRange
+                                                                withLength:changedRange.length
+                                                     originalSelectedRange:originalSelectedRange]);
+        }
+    }
+    self.transformInProgress = NO;
+
+    if (shouldNotify && changedRange.location != NSNotFound) {
+        [externalDelegate textView:self
+         didChangeAttributedTextTo:[textStorage attributedSubstringFromRange:changedRange]
+                      originalText:originalText
+                     originalRange:originalRange];
+    }
+    if (usingAbstraction) {
+        [self.abstractionLayer popIgnore];
+    }
+}
+
+/*!
+ Apply a single text transformation as part of an in-progress batch. The text storage is edited in place, and the
+ range of text touched by the batch (along with its original contents, if needed) is tracked so that the side effects
+ of the transformation can be applied once the batch completes.
+ */
+- (void)transformTextInBatchAtRange:(NSRange)range
+                    withTransformer:(NSAttributedString *(^)(NSAttributedString *))transformer {
+    NSTextStorage *textStorage = self.textStorage;
+    if (!transformer
+        || range.location == NSNotFound
+        || range.location > [textStorage length]) {
+        return;
+    }
+    if (NSMaxRange(range) > [textStorage length]) {
+        // Trim the range if it extends past the end of the string.
+        range.length = [textStorage length] - range.location;
+    }
+    NSAttributedString *originalInfix = [textStorage attributedSubstringFromRange:range];
+    NSAttributedString *infixString = transformer(originalInfix);
+
+    NSMutableAttributedString *originalText = self.batchOriginalText;
+    NSRange changedRange = self.batchChangedRange;
+    if (changedRange.location == NSNotFound) {
+        changedRange = range;
+        [originalText setAttributedString:originalInfix];
+    }
+    else {
+        NSUInteger start = MIN(changedRange.location, range.location);
+        NSUInteger end = MAX(NSMaxRange(changedRange), NSMaxRange(range));
+        // Text outside the changed range hasn't been touched by the batch yet, so its current contents are also its
+        //  original contents.
+        if (end > NSMaxRange(changedRange)) {
+            NSRange trailingRange = NSMakeRange(NSMaxRange(changedRange), end - NSMaxRange(changedRange));
+            [originalText appendAttributedString:[textStorage attributedSubstringFromRange:trailingRange]];
+        }
+        if (start < changedRange.location) {
+            NSRange leadingRange = NSMakeRange(start, changedRange.location - start);
+            [originalText insertAttributedString:[textStorage attributedSubstringFromRange:leadingRange] atIndex:0];
+        }
+        changedRange = NSMakeRange(start, end - start);
+    }
+
+    [textStorage replaceCharactersInRange:range withAttributedString:infixString ?: [NSAttributedString new]];
+    changedRange.length = changedRange.length - range.length + [infixString length];
+    self.batchChangedRange = changedRange;
+}
+
+/*!
+ Return the selection range that should be applied after the text within \c range was replaced in place by text of a
+ given length. A selection entirely before the edit is left alone, and one entirely after the edit is shifted so that it
+ still covers the same text. A selection that overlapped the edit collapses to an insertion point at the end of the
+ replacement text.
+ */
+- (NSRange)selectedRangeAfterReplacingRange:(NSRange)range
+                                 withLength:(NSUInteger)length
+                      originalSelectedRange:(NSRange)selectedRange {
+    // An insertion at the insertion point leaves the insertion point after the inserted text
+    BOOL isInsertionAtCursor = (range.length == 0
+                                && selectedRange.length == 0
+                                && selectedRange.location == range.location);
+    if (!isInsertionAtCursor && NSMaxRange(selectedRange) <= range.location) {
+        return selectedRange;
+    }
+    if (selectedRange.location >= NSMaxRange(range)) {
+        return NSMakeRange(selectedRange.location - range.length + length, selectedRange.length);
+    }
+    return NSMakeRange(range.location + length, 0);
+}
+
 - (void)insertPlainText:(NSString *)text location:(NSUInteger)location {
     [self insertAttributedText:[[NSAttributedString alloc] initWithString:text attributes:self.typingAttributes]
                       location:location];
@@ -45,10 +45,18 @@ NS_ASSUME_NONNULL_BEGIN
 + (BOOL)directlyUpdateQueryWithCustomDelegate;
 + (BOOL)enableControlCharactersToPrepend;
 + (BOOL)enableControlCharacterMaxLengthFix;
++ (BOOL)enableInPlaceTextTransformation;
++ (BOOL)enableRenderingOnlyMentionHighlighting;
++ (BOOL)enableTypeaheadResultsCache;
++ (BOOL)enableBackgroundResultsProcessing;
 + (void)setEnableMentionsPluginV2:(BOOL)enabled;
 + (void)setDirectlyUpdateQueryWithCustomDelegate:(BOOL)enabled;
 + (void)setEnableControlCharactersToPrepend:(BOOL)enabled;
 + (void)setEnableControlCharacterMaxLengthFix:(BOOL)enabled;
++ (void)setEnableInPlaceTextTransformation:(BOOL)enabled;
++ (void)setEnableRenderingOnlyMentionHighlighting:(BOOL)enabled;
++ (void)setEnableTypeaheadResultsCache:(BOOL)enabled;
++ (void)setEnableBackgroundResultsProcessing:(BOOL)enabled;
 
 #pragma mark - Initialization
 
@@ -44,6 +44,10 @@ static BOOL enableMentionsPluginV2 = NO;
 static BOOL directlyUpdateQueryWithCustomDelegate = NO;
 static BOOL enableControlCharactersToPrepend = NO;
 static BOOL enableControlCharacterMaxLengthFix = YES;
+static BOOL enableInPlaceTextTransformation = NO;
+static BOOL enableRenderingOnlyMentionHighlighting = NO;
+static BOOL enableTypeaheadResultsCache = NO;
+static BOOL enableBackgroundResultsProcessing = NO;
 
 @implementation HKWTextView
 
@@ -79,6 +83,38 @@ static BOOL enableControlCharacterMaxLengthFix = YES;
     enableControlCharactersToPrepend = enabled;
 }
 
++ (BOOL)enableInPlaceTextTransformation {
+    return enableInPlaceTextTransformation;
+}
+
++ (void)setEnableInPlaceTextTransformation:(BOOL)enabled {
+    enableInPlaceTextTransformation = enabled;
+}
+
++ (BOOL)enableRenderingOnlyMentionHighlighting {
+    return enableRenderingOnlyMentionHighlighting;
+}
+
++ (void)setEnableRenderingOnlyMentionHighlighting:(BOOL)enabled {
+    enableRenderingOnlyMentionHighlighting = enabled;
+}
+
++ (BOOL)enableTypeaheadResultsCache {
+    return enableTypeaheadResultsCache;
+}
+
++ (void)setEnableTypeaheadResultsCache:(BOOL)enabled {
+    enableTypeaheadResultsCache = enabled;
+}
+
++ (BOOL)enableBackgroundResultsProcessing {
+    return enableBackgroundResultsProcessing;
+}
+
++ (void)setEnableBackgroundResultsProcessing:(BOOL)enabled {
+    enableBackgroundResultsProcessing = enabled;
+}
+
 #pragma mark - Lifecycle
 
 - (instancetype _Nonnull)initWithFrame:(CGRect)frame textContainer:(nullable __unused NSTextContainer *)textContainer {
@@ -13,23 +13,153 @@
 #import "_HKWLayoutManager.h"
 
 #import "HKWCustomAttributes.h"
+#import "_HKWCharacterClassifier.h"
 
 typedef NSArray RoundedRectAttributeTuple;
 typedef NSMutableArray RangeValuesBuffer;
 typedef NSMutableArray RectValuesBuffer;
 
-@interface HKWLayoutManager ()
+/*!
+ The rects drawn for a run of the rounded rect background attribute, as computed the last time the run was drawn.
+ */
+@interface HKWRoundedRectGeometry : NSObject
+@property (nonatomic, strong) HKWRoundedRectBackgroundAttributeValue *attributeValue;
+@property (nonatomic, copy) NSArray<NSValue *> *rects;
+@end
+
+@implementation HKWRoundedRectGeometry
+@end
+
+/*!
+ The number of columns of the scratch buffer used to intersect fragment rects with enclosing rects: the minimum x, the
+ minimum y, the maximum x and the maximum y of each fragment rect, and the greatest maximum y of the fragment rects up
+ to and including it.
+ */
+static const NSUInteger HKWFragmentScratchColumns = 5;
+
+/*!
+ The attribute which marks each mention, i.e. \c HKWMentionAttributeName, which the core classes can't import. Every
+ mention shares the same rounded rect background attribute value, so runs of that attribute are split at mention
+ boundaries to keep adjacent mentions from being drawn as a single rounded rect.
+ */
+static NSString *const HKWLayoutManagerMentionAttributeName = @"HKWMentionAttributeName";
+
+@interface HKWLayoutManager () {
+    /// A structure-of-arrays buffer of fragment rects, reused by every call to
+    /// \c arrayOfRectsForFragmentRects:enclosingRects:rrbAttributeData: so that it doesn't allocate for each run.
+    CGFloat *_fragmentScratch;
+    NSUInteger _fragmentScratchCapacity;
+}
 @property (nonatomic, readonly) CGFloat cornerRadius;
 @property (nonatomic, readonly) CGFloat additionalHeight;
+@property (nonatomic, readwrite) NSRange highlightedCharacterRange;
+@property (nonatomic, copy, readwrite) NSDictionary *highlightAttributes;
+/// Whether the glyphs currently being drawn lie within the highlighted character range.
+@property (nonatomic) BOOL isDrawingHighlightedGlyphs;
+/// The rects of the rounded rect background attribute runs drawn so far, keyed by their character range, so that they
+/// aren't recomputed every time the runs are redrawn. Entries are discarded once the layout of their run may change.
+@property (nonatomic, strong) NSMutableDictionary<NSValue *, HKWRoundedRectGeometry *> *roundedRectGeometryCache;
 @end
 
 @implementation HKWLayoutManager
 
+- (instancetype)init {
+    self = [super init];
+    if (!self) { return nil; }
+
+    self.highlightedCharacterRange = NSMakeRange(NSNotFound, 0);
+    self.roundedRectGeometryCache = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+- (void)dealloc {
+    free(_fragmentScratch);
+}
+
+#pragma mark - API
+
+- (void)setHighlightedCharacterRange:(NSRange)characterRange attributes:(NSDictionary *)attributes {
+    if (characterRange.location == NSNotFound || characterRange.length == 0) {
+        characterRange = NSMakeRange(NSNotFound, 0);
+        attributes = nil;
+    }
+    NSRange previousRange = self.highlightedCharacterRange;
+    if (NSEqualRanges(previousRange, characterRange)
+        && (attributes == self.highlightAttributes || [attributes isEqualToDictionary:self.highlightAttributes])) {
+        return;
+    }
+    self.highlightedCharacterRange = characterRange;
+    self.highlightAttributes = attributes;
+    // Only the display needs to be refreshed; the highlight never changes the layout
+    [self invalidateDisplayForHighlightedCharacterRange:previousRange];
+    [self invalidateDisplayForHighlightedCharacterRange:characterRange];
+}
+
+#pragma mark - Drawing
+
 - (void)drawGlyphsForGlyphRange:(NSRange)glyphsToShow atPoint:(CGPoint)origin {
-    [super drawGlyphsForGlyphRange:glyphsToShow atPoint:origin];
-    // Here to be overriden if necessary
+    NSRange highlightedGlyphRange = NSIntersectionRange([self highlightedGlyphRange], glyphsToShow);
+    if (highlightedGlyphRange.length == 0) {
+        [super drawGlyphsForGlyphRange:glyphsToShow atPoint:origin];
+        return;
+    }
+
+    // Draw the highlighted glyphs on their own, so that their foreground color can be replaced as they are shown
+    NSRange leadingGlyphRange = NSMakeRange(glyphsToShow.location, highlightedGlyphRange.location - glyphsToShow.location);
+    NSRange trailingGlyphRange = NSMakeRange(NSMaxRange(highlightedGlyphRange),
+                                             NSMaxRange(glyphsToShow) - NSMaxRange(highlightedGlyphRange));
+    if (leadingGlyphRange.length > 0) {
+        [super drawGlyphsForGlyphRange:leadingGlyphRange atPoint:origin];
+    }
+    self.isDrawingHighlightedGlyphs = YES;
+    [super drawGlyphsForGlyphRange:highlightedGlyphRange atPoint:origin];
+    self.isDrawingHighlightedGlyphs = NO;
+    if (trailingGlyphRange.length > 0) {
+        [super drawGlyphsForGlyphRange:trailingGlyphRange atPoint:origin];
+    }
 }
 
+- (void)showCGGlyphs:(const CGGlyph *)glyphs
+           positions:(const CGPoint *)positions
+               count:(NSInteger)glyphCount
+                font:(UIFont *)font
+          textMatrix:(CGAffineTransform)textMatrix
+          attributes:(NSDictionary<NSAttributedStringKey, id> *)attributes
+           inContext:(CGContextRef)context {
+    if (@available(iOS 13.0, *)) {
+        [super showCGGlyphs:glyphs
+                  positions:positions
+                      count:glyphCount
+                       font:font
+                 textMatrix:textMatrix
+                 attributes:[self attributesForShowingGlyphsWithAttributes:attributes inContext:context]
+                  inContext:context];
+    }
+    // Prior to iOS 13, this method is never called; the layout manager calls the variant below instead
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-implementations"
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+// Prior to iOS 13, this is the method the layout manager uses to show glyphs.
+- (void)showCGGlyphs:(const CGGlyph *)glyphs
+           positions:(const CGPoint *)positions
+               count:(NSUInteger)glyphCount
+                font:(UIFont *)font
+              matrix:(CGAffineTransform)textMatrix
+          attributes:(NSDictionary<NSAttributedStringKey, id> *)attributes
+           inContext:(CGContextRef)graphicsContext {
+    [super showCGGlyphs:glyphs
+              positions:positions
+                  count:glyphCount
+                   font:font
+                 matrix:textMatrix
+             attributes:[self attributesForShowingGlyphsWithAttributes:attributes inContext:graphicsContext]
+              inContext:graphicsContext];
+}
+#pragma clang diagnostic pop
+
 - (void)drawBackgroundForGlyphRange:(NSRange)glyphsToShow atPoint:(CGPoint)origin {
     [super drawBackgroundForGlyphRange:glyphsToShow atPoint:origin];
 
@@ -37,8 +167,61 @@ typedef NSMutableArray RectValuesBuffer;
     // Handle drawing background for the new rounded rect background attribute.
     NSArray *tuples = [self roundedRectBackgroundAttributeTuplesInTextStorage:self.textStorage
                                                              withinGlyphRange:glyphsToShow];
+    [self drawRoundedRectBackgroundAttributeTuples:tuples atPoint:origin cachesGeometry:YES];
+
+    // -------------------------------------------------------------------------------------------------------------- //
+    // Handle drawing background for the highlighted character range, on top of the backgrounds of the stored text.
+    [self drawHighlightBackgroundWithinGlyphRange:glyphsToShow atPoint:origin];
+}
+
+#pragma mark - Editing
+
+- (void)processEditingForTextStorage:(NSTextStorage *)textStorage
+                              edited:(NSTextStorageEditActions)editMask
+                               range:(NSRange)newCharRange
+                      changeInLength:(NSInteger)delta
+                    invalidatedRange:(NSRange)invalidatedCharRange {
+    NSRange highlightedRange = self.highlightedCharacterRange;
+    if (highlightedRange.location != NSNotFound) {
+        NSUInteger oldEditEnd = (NSUInteger)((NSInteger)NSMaxRange(newCharRange) - delta);
+        if (oldEditEnd <= highlightedRange.location
+            && (newCharRange.location < highlightedRange.location || delta >= 0)) {
+            // The edit happened entirely before the highlighted text, so the highlight moves along with the text
+            highlightedRange.location = (NSUInteger)((NSInteger)highlightedRange.location + delta);
+            self.highlightedCharacterRange = highlightedRange;
+        } else if (newCharRange.location < NSMaxRange(highlightedRange)) {
+            // The highlighted text itself was edited, so the highlight no longer describes it
+            self.highlightedCharacterRange = NSMakeRange(NSNotFound, 0);
+            self.highlightAttributes = nil;
+        }
+    }
+    [self invalidateRoundedRectGeometryFromCharacterIndex:MIN(newCharRange.location, invalidatedCharRange.location)];
+    [super processEditingForTextStorage:textStorage
+                                 edited:editMask
+                                  range:newCharRange
+                         changeInLength:delta
+                       invalidatedRange:invalidatedCharRange];
+}
+
+- (void)textContainerChangedGeometry:(NSTextContainer *)container {
+    // Every line may have been laid out differently
+    [self.roundedRectGeometryCache removeAllObjects];
+    [super textContainerChangedGeometry:container];
+}
+
+#pragma mark - Private methods
+
+/*!
+ Draw the rounded rectangle backgrounds described by an array of tuples generated by the
+ \c roundedRectBackgroundAttributeTuplesInTextStorage:withinGlyphRange: method. If \c cachesGeometry is YES, the tuples
+ describe runs of the stored text, and their rects are looked up in and added to the geometry cache.
+ */
+- (void)drawRoundedRectBackgroundAttributeTuples:(NSArray *)tuples
+                                         atPoint:(CGPoint)origin
+                                  cachesGeometry:(BOOL)cachesGeometry {
     NSArray *roundedRectBackgroundRectArrays = [self rectArraysForRoundedRectBackgroundAttributeTuples:tuples
-                                                                                       inTextContainer:self.textContainers[0]];
+                                                                                       inTextContainer:self.textContainers[0]
+                                                                                        cachesGeometry:cachesGeometry];
     if ([roundedRectBackgroundRectArrays count] == 0) {
         return;
     }
@@ -46,12 +229,23 @@ typedef NSMutableArray RectValuesBuffer;
     NSAssert([tuples count] == [roundedRectBackgroundRectArrays count],
              @"The number of tuples must always be equal to the number of rounded rect background rect arrays");
 
-    CGContextRef context = UIGraphicsGetCurrentContext();
-    CGContextSaveGState(context);
+    // Gather the rects of each color into a single path, so that the number of draw calls depends only on the number of
+    //  colors. A rect is stroked and filled with the same color, so drawing them by color doesn't change their look.
+    NSMutableArray<UIColor *> *colors = [NSMutableArray array];
+    NSMutableArray *paths = [NSMutableArray array];
     for (NSUInteger i=0; i<[tuples count]; i++) {
         HKWRoundedRectBackgroundAttributeValue *data = tuples[i][1];
-        CGContextSetStrokeColorWithColor(context, [data.backgroundColor CGColor]);
-        CGContextSetFillColorWithColor(context, [data.backgroundColor CGColor]);
+        UIColor *color = data.backgroundColor;
+        if (!color) {
+            continue;
+        }
+        NSUInteger colorIndex = [colors indexOfObject:color];
+        if (colorIndex == NSNotFound) {
+            colorIndex = [colors count];
+            [colors addObject:color];
+            [paths addObject:CFBridgingRelease(CGPathCreateMutable())];
+        }
+        CGMutablePathRef path = (__bridge CGMutablePathRef)paths[colorIndex];
 
         for (NSValue *value in roundedRectBackgroundRectArrays[i]) {
             CGRect unionRect = [value CGRectValue];
@@ -64,21 +258,93 @@ typedef NSMutableArray RectValuesBuffer;
                 continue;
             }
 
-            CGPathRef p = CGPathCreateWithRoundedRect(unionRect, self.cornerRadius, self.cornerRadius, NULL);
-            CGContextAddPath(context, p);
-            CGContextStrokePath(context);
-            CGPathRelease(p);
-            p = CGPathCreateWithRoundedRect(unionRect, self.cornerRadius, self.cornerRadius, NULL);
-            CGContextAddPath(context, p);
-            CGContextFillPath(context);
-            CGPathRelease(p);
+            CGPathAddRoundedRect(path, NULL, unionRect, self.cornerRadius, self.cornerRadius);
         }
     }
+
+    CGContextRef context = UIGraphicsGetCurrentContext();
+    CGContextSaveGState(context);
+    for (NSUInteger i=0; i<[colors count]; i++) {
+        CGPathRef path = (__bridge CGPathRef)paths[i];
+        if (CGPathIsEmpty(path)) {
+            continue;
+        }
+        CGContextSetStrokeColorWithColor(context, [colors[i] CGColor]);
+        CGContextSetFillColorWithColor(context, [colors[i] CGColor]);
+        CGContextAddPath(context, path);
+        CGContextDrawPath(context, kCGPathFillStroke);
+    }
     CGContextRestoreGState(context);
 }
 
+/*!
+ Draw the background of the part of the highlighted character range which lies within the given glyph range, using the
+ background attributes in \c highlightAttributes.
+ */
+- (void)drawHighlightBackgroundWithinGlyphRange:(NSRange)glyphsToShow atPoint:(CGPoint)origin {
+    NSRange highlightedGlyphRange = NSIntersectionRange([self highlightedGlyphRange], glyphsToShow);
+    NSTextContainer *container = [self.textContainers firstObject];
+    if (highlightedGlyphRange.length == 0 || !container) {
+        return;
+    }
+    NSDictionary *attributes = self.highlightAttributes;
+
+    UIColor *backgroundColor = attributes[NSBackgroundColorAttributeName];
+    if ([backgroundColor isKindOfClass:[UIColor class]]) {
+        CGContextRef context = UIGraphicsGetCurrentContext();
+        CGContextSaveGState(context);
+        CGContextSetFillColorWithColor(context, [backgroundColor CGColor]);
+        [self enumerateEnclosingRectsForGlyphRange:highlightedGlyphRange
+                          withinSelectedGlyphRange:NSMakeRange(NSNotFound, 0)
+                                   inTextContainer:container
+                                        usingBlock:^(CGRect rect, __unused BOOL *stop) {
+                                            CGContextFillRect(context, CGRectOffset(rect, origin.x, origin.y));
+                                        }];
+        CGContextRestoreGState(context);
+    }
+
+    id roundedRectBackground = attributes[HKWRoundedRectBackgroundAttributeName];
+    if ([roundedRectBackground isKindOfClass:[HKWRoundedRectBackgroundAttributeValue class]]) {
+        NSRange characterRange = [self characterRangeForGlyphRange:highlightedGlyphRange actualGlyphRange:NULL];
+        RoundedRectAttributeTuple *tuple = @[[NSValue valueWithRange:characterRange], roundedRectBackground];
+        // The highlight isn't a run of the stored text, so its geometry isn't cached
+        [self drawRoundedRectBackgroundAttributeTuples:@[tuple] atPoint:origin cachesGeometry:NO];
+    }
+}
+
+/*!
+ Return the glyph range corresponding to the highlighted character range, or \c {NSNotFound, 0} if there is no valid
+ highlight.
+ */
+- (NSRange)highlightedGlyphRange {
+    NSRange characterRange = self.highlightedCharacterRange;
+    if (characterRange.location == NSNotFound || NSMaxRange(characterRange) > [self.textStorage length]) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    return [self glyphRangeForCharacterRange:characterRange actualCharacterRange:NULL];
+}
 
-#pragma mark - Private methods
+- (void)invalidateDisplayForHighlightedCharacterRange:(NSRange)characterRange {
+    if (characterRange.location == NSNotFound || NSMaxRange(characterRange) > [self.textStorage length]) {
+        return;
+    }
+    [self invalidateDisplayForCharacterRange:characterRange];
+}
+
+/*!
+ Return the attributes with which a run of glyphs should be shown. Highlighted glyphs take on the foreground color of
+ the highlight, which is also set as the context's fill color since that is what the glyphs are actually drawn with.
+ */
+- (NSDictionary *)attributesForShowingGlyphsWithAttributes:(NSDictionary *)attributes inContext:(CGContextRef)context {
+    UIColor *highlightColor = self.highlightAttributes[NSForegroundColorAttributeName];
+    if (!self.isDrawingHighlightedGlyphs || ![highlightColor isKindOfClass:[UIColor class]]) {
+        return attributes;
+    }
+    CGContextSetFillColorWithColor(context, [highlightColor CGColor]);
+    NSMutableDictionary *buffer = [attributes mutableCopy] ?: [NSMutableDictionary dictionary];
+    buffer[NSForegroundColorAttributeName] = highlightColor;
+    return [buffer copy];
+}
 
 /*!
  Return an array of tuple-style arrays. Each tuple contains two objects: the NSValue-encoded range of a rounded
@@ -96,51 +362,81 @@ typedef NSMutableArray RectValuesBuffer;
     // https://www.icu-project.org/docs/papers/forms_of_unicode/
     NSRange characterRange = [self characterRangeForGlyphRange:glyphRange actualGlyphRange:nil];
 
-    // Go through the attributes in the given range and pick out the ones that correspond to the
-    [textStorage enumerateAttributesInRange:characterRange
-                                    options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
-                                 usingBlock:^(NSDictionary *attrs, NSRange attributeRange, __unused BOOL *stop) {
-                                     for (NSString *attr in attrs) {
-                                         if (attr == HKWRoundedRectBackgroundAttributeName) {
-                                             id const attributeValue = attrs[attr];
-                                             if (!attributeValue) {
-                                                 NSAssert(NO, @"Internal error");
-                                                 continue;
-                                             }
-                                             RoundedRectAttributeTuple *tuple = @[[NSValue valueWithRange:attributeRange], attributeValue];
-                                             [buffer addObject:tuple];
-                                         }
-                                     }
-                                 }];
+    // Go through the runs of the rounded rect background attribute in the given range. Runs are compared by value
+    //  rather than by their other attributes, so that a mention whose other attributes vary is still a single run, but
+    //  are split wherever one mention ends and another begins. A run cut off by either end of the range is extended to
+    //  its full length, so that it is drawn as a single rounded rect, and its geometry is cached under the same range
+    //  however much of it is being drawn.
+    const NSRange fullRange = NSMakeRange(0, [textStorage length]);
+    [textStorage enumerateAttribute:HKWRoundedRectBackgroundAttributeName
+                            inRange:characterRange
+                            options:0
+                         usingBlock:^(id attributeValue, NSRange attributeRange, __unused BOOL *stop) {
+                             if (!attributeValue) {
+                                 return;
+                             }
+                             if (attributeRange.location == characterRange.location
+                                 || NSMaxRange(attributeRange) == NSMaxRange(characterRange)) {
+                                 [textStorage attribute:HKWRoundedRectBackgroundAttributeName
+                                                atIndex:attributeRange.location
+                                  longestEffectiveRange:&attributeRange
+                                                inRange:fullRange];
+                             }
+                             NSUInteger location = attributeRange.location;
+                             while (location < NSMaxRange(attributeRange)) {
+                                 NSRange mentionRange;
+                                 [textStorage attribute:HKWLayoutManagerMentionAttributeName
+                                                atIndex:location
+                                  longestEffectiveRange:&mentionRange
+                                                inRange:attributeRange];
+                                 NSRange runRange = NSMakeRange(location, NSMaxRange(mentionRange) - location);
+                                 location = NSMaxRange(runRange);
+                                 if (NSIntersectionRange(runRange, characterRange).length == 0) {
+                                     // Part of an extended run which lies entirely outside of the given range
+                                     continue;
+                                 }
+                                 RoundedRectAttributeTuple *tuple = @[[NSValue valueWithRange:runRange], attributeValue];
+                                 [buffer addObject:tuple];
+                             }
+                         }];
     return [NSArray arrayWithArray:buffer];
 }
 
 /*!
  Given an array of tuples generated by \c roundedRectBackgroundAttributeTuplesInTextStorage:withinRange: method,
- return a final array of line fragment rects which the layout manager should draw onto the screen.
+ return a final array of line fragment rects which the layout manager should draw onto the screen. If
+ \c cachesGeometry is YES, the rects of each tuple are taken from the geometry cache if they are there, and added to it
+ otherwise.
  */
 - (NSArray *)rectArraysForRoundedRectBackgroundAttributeTuples:(NSArray *)attributeTuples
-                                               inTextContainer:(NSTextContainer *)container {
+                                               inTextContainer:(NSTextContainer *)container
+                                                cachesGeometry:(BOOL)cachesGeometry {
     if ([attributeTuples count] == 0 || !container) {
         return nil;
     }
 
     NSMutableArray *finalRectArrays = [NSMutableArray new];
 
-    NSRange currentRange;
     RectValuesBuffer *lineFragments = [NSMutableArray new];
     RectValuesBuffer *enclosingRects = [NSMutableArray new];
     for (RoundedRectAttributeTuple *tuple in attributeTuples) {
-        [lineFragments removeAllObjects];
-        [enclosingRects removeAllObjects];
-
         // Destructure the tuple
-        currentRange = [((NSValue *)tuple[0]) rangeValue];
+        NSValue *rangeValue = tuple[0];
+        NSRange currentRange = [rangeValue rangeValue];
         HKWRoundedRectBackgroundAttributeValue *data = tuple[1];
         if (currentRange.location == NSNotFound) {
             continue;
         }
 
+        HKWRoundedRectGeometry *cachedGeometry = self.roundedRectGeometryCache[rangeValue];
+        if (cachesGeometry && cachedGeometry.attributeValue == data) {
+            [finalRectArrays addObject:cachedGeometry.rects];
+            continue;
+        }
+
+        [lineFragments removeAllObjects];
+        [enclosingRects removeAllObjects];
+
         // Get the line fragment rects for the given RRB attribute
         [self enumerateLineFragmentsForGlyphRange:currentRange
                                        usingBlock:^(__unused CGRect rect,
@@ -151,8 +447,9 @@ typedef NSMutableArray RectValuesBuffer;
                                            if (container != textContainer) {
                                                return;
                                            }
-                                           NSString *substr = [[self.textStorage attributedSubstringFromRange:glyphRange] string];
-                                           NSUInteger count = [[self class] numberOfTrailingSpacesInString:substr];
+                                           NSString *string = self.textStorage.string;
+                                           NSUInteger count = [[self class] numberOfTrailingSpacesInString:string
+                                                                                                     range:glyphRange];
                                            if (count == 0) {
                                                [lineFragments addObject:[NSValue valueWithCGRect:usedRect]];
                                            }
@@ -184,85 +481,124 @@ typedef NSMutableArray RectValuesBuffer;
         if (!unionRects) {
             return nil;
         }
+        if (cachesGeometry) {
+            HKWRoundedRectGeometry *geometry = [HKWRoundedRectGeometry new];
+            geometry.attributeValue = data;
+            geometry.rects = unionRects;
+            self.roundedRectGeometryCache[rangeValue] = geometry;
+        }
         [finalRectArrays addObject:unionRects];
     }
     return [NSArray arrayWithArray:finalRectArrays];
 }
 
+/*!
+ Discard the cached geometry of the rounded rect background runs which end at or after the given character index, since
+ the lines they were laid out on may have changed or moved.
+ */
+- (void)invalidateRoundedRectGeometryFromCharacterIndex:(NSUInteger)characterIndex {
+    NSMutableDictionary<NSValue *, HKWRoundedRectGeometry *> *cache = self.roundedRectGeometryCache;
+    if ([cache count] == 0) {
+        return;
+    }
+    NSMutableArray<NSValue *> *invalidatedKeys = [NSMutableArray array];
+    for (NSValue *rangeValue in cache) {
+        if (NSMaxRange([rangeValue rangeValue]) >= characterIndex) {
+            [invalidatedKeys addObject:rangeValue];
+        }
+    }
+    [cache removeObjectsForKeys:invalidatedKeys];
+}
+
+/*!
+ Clip each enclosing rect to the fragment rects it intersects. The fragment rects are sorted by their minimum y, so that
+ the fragment rects which may intersect an enclosing rect are found with a binary search, and only those are visited.
+ */
 - (NSArray *)arrayOfRectsForFragmentRects:(NSArray *)fragmentRects
                            enclosingRects:(NSArray *)enclosingRects
                          rrbAttributeData:(__unused HKWRoundedRectBackgroundAttributeValue *)data {
-    RectValuesBuffer *buffer = [NSMutableArray array];
-    if ([fragmentRects count] == 0) {
+    const NSUInteger fragmentRectsCount = [fragmentRects count];
+    if (fragmentRectsCount == 0) {
         return nil;
     }
 
-    // First, destructure fragmentRects
-    const NSUInteger fragmentRectsCount = [fragmentRects count];
-    CGFloat *rectXArray = malloc(fragmentRectsCount * sizeof(CGFloat));
-    if (!rectXArray) {
-        goto ALLOC_X_FAILED;
-    }
-    CGFloat *rectYArray = malloc(fragmentRectsCount * sizeof(CGFloat));
-    if (!rectYArray) {
-        goto ALLOC_Y_FAILED;
-    }
-    CGFloat *rectWidthArray = malloc(fragmentRectsCount * sizeof(CGFloat));
-    if (!rectWidthArray) {
-        goto ALLOC_WIDTH_FAILED;
-    }
-    CGFloat *rectHeightArray = malloc(fragmentRectsCount * sizeof(CGFloat));
-    if (!rectHeightArray) {
-        goto ALLOC_HEIGHT_FAILED;
+    // Grow the scratch buffer if it can't hold the fragment rects
+    if (fragmentRectsCount > _fragmentScratchCapacity) {
+        NSUInteger capacity = MAX(fragmentRectsCount, 2*_fragmentScratchCapacity);
+        CGFloat *scratch = realloc(_fragmentScratch, capacity * HKWFragmentScratchColumns * sizeof(CGFloat));
+        if (!scratch) {
+            return nil;
+        }
+        _fragmentScratch = scratch;
+        _fragmentScratchCapacity = capacity;
     }
-
+    CGFloat *minXs = _fragmentScratch;
+    CGFloat *minYs = minXs + fragmentRectsCount;
+    CGFloat *maxXs = minYs + fragmentRectsCount;
+    CGFloat *maxYs = maxXs + fragmentRectsCount;
+    CGFloat *runningMaxYs = maxYs + fragmentRectsCount;
+
+    // Destructure the fragment rects, inserting each one in order of its minimum y. Line fragments are enumerated from
+    //  top to bottom, so this is usually just a copy.
     for (NSUInteger i=0; i<fragmentRectsCount; i++) {
         CGRect fragmentRect = [fragmentRects[i] CGRectValue];
-        rectXArray[i] = fragmentRect.origin.x;
-        rectYArray[i] = fragmentRect.origin.y;
-        rectWidthArray[i] = fragmentRect.size.width;
-        rectHeightArray[i] = fragmentRect.size.height;
+        NSUInteger j = i;
+        while (j > 0 && minYs[j-1] > CGRectGetMinY(fragmentRect)) {
+            minXs[j] = minXs[j-1];
+            minYs[j] = minYs[j-1];
+            maxXs[j] = maxXs[j-1];
+            maxYs[j] = maxYs[j-1];
+            j--;
+        }
+        minXs[j] = CGRectGetMinX(fragmentRect);
+        minYs[j] = CGRectGetMinY(fragmentRect);
+        maxXs[j] = CGRectGetMaxX(fragmentRect);
+        maxYs[j] = CGRectGetMaxY(fragmentRect);
+    }
+    for (NSUInteger i=0; i<fragmentRectsCount; i++) {
+        runningMaxYs[i] = (i == 0) ? maxYs[i] : MAX(runningMaxYs[i-1], maxYs[i]);
     }
 
+    RectValuesBuffer *buffer = [NSMutableArray arrayWithCapacity:[enclosingRects count]];
     for (NSValue *value in enclosingRects) {
-        CGRect currentEnclosingRect = [value CGRectValue];
-
-        // Clip the enclosing rect to the bounds of the fragment rects
-        CGRect intersectionRect = currentEnclosingRect;
-        for (NSUInteger i=0; i<fragmentRectsCount; i++) {
-            CGRect currentFragmentRect = CGRectMake(rectXArray[i],
-                                                    rectYArray[i],
-                                                    rectWidthArray[i],
-                                                    rectHeightArray[i]);
+        CGRect intersectionRect = [value CGRectValue];
+
+        // Skip the fragment rects which all end above the enclosing rect
+        NSUInteger low = 0;
+        NSUInteger high = fragmentRectsCount;
+        while (low < high) {
+            NSUInteger mid = low + (high - low)/2;
+            if (runningMaxYs[mid] < CGRectGetMinY(intersectionRect)) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+
+        // Clip the enclosing rect to the bounds of the fragment rects, stopping at the first one below it
+        for (NSUInteger i=low; i<fragmentRectsCount && minYs[i] <= CGRectGetMaxY(intersectionRect); i++) {
+            CGRect currentFragmentRect = CGRectMake(minXs[i], minYs[i], maxXs[i] - minXs[i], maxYs[i] - minYs[i]);
             if (CGRectIntersectsRect(intersectionRect, currentFragmentRect)) {
                 // If the rects intersect, shrink the rect.
                 intersectionRect = CGRectIntersection(intersectionRect, currentFragmentRect);
             }
         }
-        // Add to buffer
         [buffer addObject:[NSValue valueWithCGRect:intersectionRect]];
     }
-    // Clean up and return
-ALLOC_HEIGHT_FAILED:
-    free(rectHeightArray);
-ALLOC_WIDTH_FAILED:
-    free(rectWidthArray);
-ALLOC_Y_FAILED:
-    free(rectYArray);
-ALLOC_X_FAILED:
-    free(rectXArray);
     return [NSArray arrayWithArray:buffer];
 }
 
-+ (NSUInteger)numberOfTrailingSpacesInString:(NSString *)str {
+/*!
+ Return the number of whitespace characters at the end of the given range of \c str, without copying them out.
+ */
++ (NSUInteger)numberOfTrailingSpacesInString:(NSString *)str range:(NSRange)range {
+    HKWCharacterClassifier *classifier = [HKWCharacterClassifier sharedClassifier];
     NSUInteger count = 0;
-    for (NSInteger i=(NSInteger)[str length]-1; i>=0; i--) {
-        if ([[NSCharacterSet whitespaceAndNewlineCharacterSet] characterIsMember:[str characterAtIndex:(NSUInteger)i]]) {
-            count++;
-        }
-        else {
-            break;
-        }
+    while (count < range.length
+           && [classifier character:[str characterAtIndex:NSMaxRange(range) - count - 1]
+                          isInClass:HKWCharacterClassWhitespace]) {
+        count++;
     }
     return count;
 }
@@ -13,4 +13,27 @@
 #import <UIKit/UIKit.h>
 
 @interface HKWLayoutManager : NSLayoutManager
+
+/*!
+ A range of characters which is drawn as highlighted, without the text storage being modified, or
+ \c {NSNotFound, 0} if nothing is highlighted. The highlight is cleared automatically if the text within it is edited,
+ and is shifted if text before it is inserted or deleted.
+ */
+@property (nonatomic, readonly) NSRange highlightedCharacterRange;
+
+/*!
+ The attributes used to draw the highlighted character range. Only attributes which don't affect layout are honored:
+ \c NSForegroundColorAttributeName, \c NSBackgroundColorAttributeName, and \c HKWRoundedRectBackgroundAttributeName.
+ */
+@property (nonatomic, copy, readonly) NSDictionary *highlightAttributes;
+
+/*!
+ Draw the given range of characters with the given attributes layered over their stored attributes, replacing any
+ previous highlight. Only the affected portions of the text view are redrawn; layout is not invalidated.
+
+ \param characterRange    the range of characters to highlight, or \c {NSNotFound, 0} to remove the highlight
+ \param attributes        the attributes to draw the highlighted characters with
+ */
+- (void)setHighlightedCharacterRange:(NSRange)characterRange attributes:(NSDictionary *)attributes;
+
 @end
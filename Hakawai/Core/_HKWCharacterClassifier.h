@@ -0,0 +1,131 @@
+//
+//  _HKWCharacterClassifier.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "_HKWCharacterReader.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ The character classes known to \c HKWCharacterClassifier. Classes may be combined into a mask; a character matches a
+ mask if it is a member of any of the classes in the mask.
+ */
+typedef NS_OPTIONS(NSUInteger, HKWCharacterClass) {
+    HKWCharacterClassNone           = 0,
+    /// Members of \c +[NSCharacterSet whitespaceAndNewlineCharacterSet]
+    HKWCharacterClassWhitespace     = 1 << 0,
+    /// Members of \c +[NSCharacterSet punctuationCharacterSet]
+    HKWCharacterClassPunctuation    = 1 << 1,
+    /// Members of the control character set the classifier was built with
+    HKWCharacterClassControl        = 1 << 2,
+    /// Members of \c +[NSCharacterSet alphanumericCharacterSet]
+    HKWCharacterClassAlphanumeric   = 1 << 3,
+    /// Characters after which a mention may begin: whitespace, newlines and punctuation
+    HKWCharacterClassSeparator      = HKWCharacterClassWhitespace | HKWCharacterClassPunctuation,
+};
+
+/*!
+ An immutable lookup table which answers character class membership questions without consulting \c NSCharacterSet on
+ a per-character basis. Each class is compiled once into a bitmap covering the Basic Multilingual Plane; characters
+ outside of it fall back to the character set the class was built from, but only if that set has any members outside
+ the BMP at all.
+
+ The whitespace, punctuation and alphanumeric tables are built once per process and shared by every classifier. The
+ control table is built when the classifier is created, so owners should create a new classifier only when their
+ control character set changes. Later mutations to a mutable control character set are not reflected by the classifier.
+ */
+@interface HKWCharacterClassifier : NSObject
+
+/*!
+ Return a classifier with no control characters, suitable for whitespace, newline, punctuation and alphanumeric checks.
+ */
++ (instancetype)sharedClassifier;
+
+/*!
+ Return a new classifier whose control class consists of the members of \c controlCharacterSet. A nil set yields a
+ classifier with an empty control class.
+ */
++ (instancetype)classifierWithControlCharacterSet:(nullable NSCharacterSet *)controlCharacterSet;
+
+/*!
+ The control character set the classifier was built from, or nil.
+ */
+@property (nonatomic, readonly, nullable) NSCharacterSet *controlCharacterSet;
+
+/*!
+ Return the mask of every class the UTF-16 code unit \c character belongs to. Unpaired surrogates belong to no class.
+ */
+- (HKWCharacterClass)classOfCharacter:(unichar)character;
+
+/*!
+ Return the mask of every class the Unicode scalar value \c character belongs to.
+ */
+- (HKWCharacterClass)classOfLongCharacter:(UTF32Char)character;
+
+/*!
+ Return whether the UTF-16 code unit \c character is a member of any of the classes in \c characterClass.
+ */
+- (BOOL)character:(unichar)character isInClass:(HKWCharacterClass)characterClass;
+
+/*!
+ Return the index of the first character at or after \c location in the buffer which is a member of any of the classes
+ in \c characterClass, or \c length if there is none. Surrogate pairs are classified as a single character, and are
+ reported at the index of their leading surrogate.
+ */
+- (NSUInteger)nextIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                             inCharacters:(const unichar *)characters
+                                   length:(NSUInteger)length
+                                fromIndex:(NSUInteger)location;
+
+/*!
+ Return the index of the last character within \c searchRange of the buffer which is a member of any of the classes in
+ \c characterClass, or \c NSNotFound if there is none. The search proceeds backwards from the end of the range.
+ */
+- (NSUInteger)previousIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                 inCharacters:(const unichar *)characters
+                                       length:(NSUInteger)length
+                                        range:(NSRange)searchRange;
+
+/*!
+ Equivalent to \c nextIndexOfCharacterInClass:inCharacters:length:fromIndex:, reading the characters of \c string.
+ */
+- (NSUInteger)nextIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                 inString:(NSString *)string
+                                fromIndex:(NSUInteger)location;
+
+/*!
+ Equivalent to \c previousIndexOfCharacterInClass:inCharacters:length:range:, reading the characters of \c string.
+ */
+- (NSUInteger)previousIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                     inString:(NSString *)string
+                                        range:(NSRange)searchRange;
+
+/*!
+ Equivalent to \c nextIndexOfCharacterInClass:inCharacters:length:fromIndex:, reading the characters through
+ \c reader. Callers which make several scans of the same string per keystroke can share one reader between them.
+ */
+- (NSUInteger)nextIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                 inReader:(HKWCharacterReader *)reader
+                                fromIndex:(NSUInteger)location;
+
+/*!
+ Equivalent to \c previousIndexOfCharacterInClass:inCharacters:length:range:, reading the characters through
+ \c reader.
+ */
+- (NSUInteger)previousIndexOfCharacterInClass:(HKWCharacterClass)characterClass
+                                     inReader:(HKWCharacterReader *)reader
+                                        range:(NSRange)searchRange;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,69 @@
+//
+//  _HKWCharacterReader.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#ifndef Hakawai__HKWCharacterReader_h
+#define Hakawai__HKWCharacterReader_h
+
+#import <Foundation/Foundation.h>
+
+/*!
+ A stack-allocated reader for the UTF-16 characters of a string or buffer, used by the character scans which run on
+ every keystroke. Characters are read directly from the string's buffer if it exposes one, and otherwise through a small
+ inline buffer which is refilled with the window of characters around the most recently accessed index. Scanning
+ forwards or backwards from the cursor therefore costs neither a message send per character nor any intermediate string
+ allocation.
+
+ The reader doesn't retain its string. The string must outlive the reader and must not be mutated while it is being
+ read; in particular, this makes the backing string of a text storage (as opposed to the copy returned by
+ \c UITextView's \c text property) a suitable source.
+ */
+typedef struct {
+    const unichar *characters;
+    CFStringInlineBuffer inlineBuffer;
+    NSUInteger length;
+} HKWCharacterReader;
+
+/*!
+ Prepare a reader to read the given string. A nil string is treated as an empty string.
+ */
+NS_INLINE void HKWCharacterReaderInitWithString(HKWCharacterReader *reader, NSString *string) {
+    CFStringRef cfString = (__bridge CFStringRef)(string ?: @"");
+    reader->length = (NSUInteger)CFStringGetLength(cfString);
+    reader->characters = CFStringGetCharactersPtr(cfString);
+    if (!reader->characters) {
+        CFStringInitInlineBuffer(cfString, &reader->inlineBuffer, CFRangeMake(0, (CFIndex)reader->length));
+    }
+}
+
+/*!
+ Prepare a reader to read a buffer of \c length UTF-16 characters.
+ */
+NS_INLINE void HKWCharacterReaderInitWithCharacters(HKWCharacterReader *reader,
+                                                    const unichar *characters,
+                                                    NSUInteger length) {
+    reader->characters = characters;
+    reader->length = length;
+}
+
+/*!
+ Return the character at the given index, or 0 if the index is out of bounds.
+ */
+NS_INLINE unichar HKWCharacterReaderCharacterAtIndex(HKWCharacterReader *reader, NSUInteger location) {
+    if (location >= reader->length) {
+        return (unichar)0;
+    }
+    return (reader->characters
+            ? reader->characters[location]
+            : CFStringGetCharacterFromInlineBuffer(&reader->inlineBuffer, (CFIndex)location));
+}
+
+#endif
@@ -42,6 +42,24 @@
  */
 @property (nonatomic) BOOL transformInProgress;
 
+/*!
+ The nesting depth of \c performBatchTransformations: calls. While this is greater than zero, text transformations are
+ applied directly to the text storage and their side effects are deferred until the outermost batch completes.
+ */
+@property (nonatomic) NSUInteger batchTransformationDepth;
+
+/*!
+ The smallest range, in current coordinates, containing every change made by the in-progress batch of transformations,
+ or a range whose location is \c NSNotFound if nothing has been changed yet.
+ */
+@property (nonatomic) NSRange batchChangedRange;
+
+/*!
+ The original contents of the text covered by \c batchChangedRange, or nil if the external delegate does not need to be
+ notified of the batch's changes.
+ */
+@property (nonatomic, strong) NSMutableAttributedString *batchOriginalText;
+
 /*!
  If running on iOS 7 or greater, this is the line fragment padding of the text container. Here for iOS 6 compatibility.
  */
@@ -19,6 +19,22 @@ NS_ASSUME_NONNULL_BEGIN
                      isWhitespace:(BOOL)isWhitespace
                  controlCharacter:(unichar)character;
 
+/*!
+ Cancel all typeahead requests whose results are still expected, and drop any query waiting to be requested. Called
+ when mention creation ends.
+ */
+- (void)cancelAllRequests;
+
+/*!
+ Request the results for a query ahead of time, and store them in the typeahead cache without showing them, so that
+ they can be shown as soon as the query is made. Does nothing if \c HKWTextView.enableTypeaheadResultsCache isn't set,
+ or if the results are already cached or being prefetched. If the query is made while its prefetch is in flight, no
+ further request is made for it.
+ */
+- (void)prefetchResultsForKeyString:(NSString *)string
+                         searchType:(HKWMentionsSearchType)type
+                   controlCharacter:(unichar)character;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -6,7 +6,14 @@
 #import "_HKWDefaultChooserView.h"
 #import "HKWMentionsAttribute.h"
 #import "HKWMentionDataProvider.h"
+#import "HKWTextView.h"
 #import "_HKWMentionsPrivateConstants.h"
+#import "_HKWMentionsTypeaheadCache.h"
+#import "_HKWMentionsTypeaheadService.h"
+#import "_HKWMentionsResultsDiff.h"
+#import "_HKWMentionsResultsMerger.h"
+#import "HKWMentionsRateLimitPolicy.h"
+#import "HKWMentionsCancellationToken.h"
 
 /*!
  States for the network state subsidiary state machine.
@@ -20,7 +27,8 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
     HKWMentionsCreationNetworkStateTimerCooldown,
 
     // The mentions creation system is ready, the rate-limiting timer is still active, and another request needs to be
-    //  made once it expires.
+    //  made once it expires. If the rate limit policy doesn't send leading edge requests, every query waits in this
+    //  state until the user stops typing.
     HKWMentionsCreationNetworkStatePendingRequestAfterCooldown,
 };
 
@@ -45,24 +53,48 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
 /// sequence number monotonically increases.
 @property (nonatomic) NSUInteger sequenceNumber;
 
+/// A serial queue on which responses are validated and deduplicated, if \c HKWTextView.enableBackgroundResultsProcessing
+/// is set.
+@property (nonatomic, strong) dispatch_queue_t resultsProcessingQueue;
+
 @property (weak, nonatomic) HKWMentionsCreationStateMachine *stateMachine;
 
 /// An array serving as a backing store for the chooser table view; it contains objects representing mentions entities
 /// that the user can select from.
 @property (nonatomic, nullable, readwrite) NSArray *entityArray;
 
-@property (nonatomic, strong) NSTimer *cooldownTimer;
-@property (nonatomic, readonly) NSTimeInterval cooldownPeriod;
+/// The query which the chooser's cells were last configured with, to tell which cells must be updated for a new query.
+@property (nonatomic, copy, nullable) NSString *displayedMatchString;
+
+/// Results returned by the delegate for recent queries, unless the plug-in has a typeahead service, in which case its
+/// cache is used instead. Only used if \c HKWTextView.enableTypeaheadResultsCache is set.
+@property (nonatomic, strong) HKWMentionsTypeaheadCache *resultsCache;
+
+/// Cancellation tokens for the requests whose results are still expected, from oldest to newest.
+@property (nonatomic, strong) NSMutableArray<HKWMentionsCancellationToken *> *openRequestTokens;
+
+/// The number of requests, canceled or not, which haven't received their first response yet.
+@property (nonatomic) NSUInteger requestsAwaitingResponse;
+
+/// The most recent request which was held back because too many requests were awaiting a response.
+@property (nonatomic, copy, nullable) void (^deferredRequest)(void);
+
+/// Cancellation tokens for the prefetch requests in flight, keyed by the typeahead cache key of their query.
+@property (nonatomic, strong) NSMutableDictionary<NSString *, HKWMentionsCancellationToken *> *prefetchTokens;
+
+/// The current query, if it is waiting for a prefetch of the same query to finish rather than making its own request,
+/// and the cache key of that query.
+@property (nonatomic, copy, nullable) void (^queryAwaitingPrefetch)(void);
+@property (nonatomic, copy, nullable) NSString *awaitedPrefetchKey;
+
+/// A one-shot timer which is created once and re-armed for each cooldown, rather than replaced.
+@property (nonatomic, strong, readonly) dispatch_source_t cooldownTimer;
 @property (nonatomic) HKWMentionsCreationNetworkState networkState;
 
 @end
 
 @implementation HKWMentionDataProvider
 
-- (NSTimeInterval)cooldownPeriod {
-    return 0.1;
-}
-
 - (instancetype)initWithStateMachine:(nonnull HKWMentionsCreationStateMachine *)stateMachine
                             delegate:(nonnull id<HKWMentionsCreationStateMachineDelegate>)delegate{
     self = [super init];
@@ -71,96 +103,787 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
         _sequenceNumber = 0;
         _stateMachine = stateMachine;
         _delegate = delegate;
+        _resultsCache = [HKWMentionsTypeaheadCache new];
+        _openRequestTokens = [NSMutableArray array];
+        _prefetchTokens = [NSMutableDictionary dictionary];
+        _resultsProcessingQueue = dispatch_queue_create("com.linkedin.hakawai.mentions-results-processing",
+                                                        DISPATCH_QUEUE_SERIAL);
     }
     return self;
 }
 
+- (void)dealloc {
+    if (_cooldownTimer) {
+        dispatch_source_cancel(_cooldownTimer);
+    }
+    for (HKWMentionsCancellationToken *token in _openRequestTokens) {
+        [token cancel];
+    }
+    for (HKWMentionsCancellationToken *token in [_prefetchTokens allValues]) {
+        [token cancel];
+    }
+}
+
+- (void)cancelAllRequests {
+    [self cancelOpenRequests];
+    self.deferredRequest = nil;
+    self.pendingQuery = nil;
+    self.queryAwaitingPrefetch = nil;
+    if (self.networkState == HKWMentionsCreationNetworkStatePendingRequestAfterCooldown) {
+        self.networkState = HKWMentionsCreationNetworkStateTimerCooldown;
+    }
+}
+
+- (void)prefetchResultsForKeyString:(NSString *)string
+                         searchType:(HKWMentionsSearchType)type
+                   controlCharacter:(unichar)character {
+    if (!HKWTextView.enableTypeaheadResultsCache) {
+        // Prefetched results could never be shown
+        return;
+    }
+    if ([[self.delegate typeaheadSources] count] > 0) {
+        // The results of the default chooser view delegate alone can't be cached as the complete results of a query
+        return;
+    }
+    NSString *prefetchKey = [HKWMentionsTypeaheadCache keyForKeyString:string searchType:type controlCharacter:character];
+    if (self.prefetchTokens[prefetchKey]
+        || [self.resultsCache completeResultsForKeyString:string searchType:type controlCharacter:character]) {
+        // The results are already known, or on their way
+        return;
+    }
+    HKWLOG(@"  DEBUG: prefetching results for '%@'", string);
+    NSString *keyString = [string copy];
+    // Prefetches don't belong to any query, so they aren't rate limited and aren't canceled by later queries
+    HKWMentionsCancellationToken *token = [HKWMentionsCancellationToken new];
+    self.prefetchTokens[prefetchKey] = token;
+    __block NSArray *prefetchedResults = nil;
+    __block BOOL prefetchIsComplete = NO;
+    NSMutableSet<NSString *> *prefetchedUniqueIds = [NSMutableSet set];
+    // Read once, so that all the responses to a prefetch are handled the same way
+    const BOOL processesResponsesInBackground = HKWTextView.enableBackgroundResultsProcessing;
+    dispatch_queue_t resultsProcessingQueue = self.resultsProcessingQueue;
+    __weak typeof(self) weakSelf = self;
+    [self retrieveEntitiesForKeyString:keyString
+                            searchType:type
+                      controlCharacter:character
+                     cancellationToken:token
+                            completion:^(NSArray *results, BOOL dedupe, BOOL isComplete) {
+        // Validates and deduplicates a response, and then hands the finalized results to the main thread to be cached
+        void (^processResponse)(void) = ^{
+            if (prefetchIsComplete || token.cancelled) {
+                // The data source already finalized the results
+                return;
+            }
+            // An empty first page finalizes the results
+            prefetchIsComplete = isComplete || (prefetchedResults == nil && [results count] == 0);
+            NSArray *validResults = [HKWMentionDataProvider validResultsFromResults:results
+                                                                             dedupe:dedupe
+                                                                      seenUniqueIds:prefetchedUniqueIds];
+            prefetchedResults = [(prefetchedResults ?: @[]) arrayByAddingObjectsFromArray:validResults];
+            if (!prefetchIsComplete) {
+                return;
+            }
+            NSArray *allResults = prefetchedResults;
+            void (^publishResponse)(void) = ^{
+                typeof(self) strongSelf = weakSelf;
+                if (strongSelf.prefetchTokens[prefetchKey] != token) {
+                    return;
+                }
+                [strongSelf.prefetchTokens removeObjectForKey:prefetchKey];
+                [strongSelf.resultsCache setResults:allResults
+                                         isComplete:YES
+                                       forKeyString:keyString
+                                         searchType:type
+                                   controlCharacter:character];
+                if (strongSelf.queryAwaitingPrefetch && [strongSelf.awaitedPrefetchKey isEqualToString:prefetchKey]) {
+                    void (^queryAwaitingPrefetch)(void) = strongSelf.queryAwaitingPrefetch;
+                    strongSelf.queryAwaitingPrefetch = nil;
+                    queryAwaitingPrefetch();
+                }
+            };
+            if (processesResponsesInBackground) {
+                dispatch_async(dispatch_get_main_queue(), publishResponse);
+            } else {
+                publishResponse();
+            }
+        };
+        if (processesResponsesInBackground) {
+            // The data source may call back on any thread
+            dispatch_async(resultsProcessingQueue, processResponse);
+        } else {
+            processResponse();
+        }
+    }];
+}
+
 - (void)queryUpdatedWithKeyString:(nonnull NSString *)string
                        searchType:(HKWMentionsSearchType)type
                      isWhitespace:(BOOL)isWhitespace
                  controlCharacter:(unichar)character {
     self.currentQuery = [string copy];
+    self.queryAwaitingPrefetch = nil;
+    if (HKWTextView.enableTypeaheadResultsCache
+        && ([self showCachedResultsForKeyString:string
+                                     searchType:type
+                                   isWhitespace:isWhitespace
+                               controlCharacter:character]
+            || [self awaitPrefetchForKeyString:string
+                                    searchType:type
+                                  isWhitespace:isWhitespace
+                              controlCharacter:character])) {
+        return;
+    }
+    const BOOL sendsLeadingEdgeRequests = [self rateLimitPolicy].sendsLeadingEdgeRequests;
     switch (self.networkState) {
         case HKWMentionsCreationNetworkStateReady: {
-            [self sendQueryWithKeyString:string
-                              searchType:type
-                            isWhitespace:isWhitespace
-                        controlCharacter:character];
-            return;
+            if (sendsLeadingEdgeRequests) {
+                [self sendQueryWithKeyString:string
+                                  searchType:type
+                                isWhitespace:isWhitespace
+                            controlCharacter:character];
+                [self activateCooldownTimerForSearchType:type];
+                return;
+            }
+            break;
         }
         case HKWMentionsCreationNetworkStateTimerCooldown:
-        case HKWMentionsCreationNetworkStatePendingRequestAfterCooldown: {
-            self.pendingQuery = [string copy];
-            self.pendingSearchType = type;
-            self.pendingQueryIsWhitespace = isWhitespace;
-            self.pendingControlCharacter = character;
-            self.networkState = HKWMentionsCreationNetworkStatePendingRequestAfterCooldown;
-        }
+        case HKWMentionsCreationNetworkStatePendingRequestAfterCooldown:
+            break;
+    }
+    self.pendingQuery = [string copy];
+    self.pendingSearchType = type;
+    self.pendingQueryIsWhitespace = isWhitespace;
+    self.pendingControlCharacter = character;
+    if (!sendsLeadingEdgeRequests) {
+        // Every query restarts the delay, so that a request is made only once the user stops typing
+        [self activateCooldownTimerForSearchType:type];
+    }
+    self.networkState = HKWMentionsCreationNetworkStatePendingRequestAfterCooldown;
+}
+
+/*!
+ If complete results for a query are already known, either because they were returned for the query itself or because
+ they can be filtered out of the complete results of a shorter query, show them and return YES. Any request waiting
+ for the cooldown timer is dropped, and responses to requests still in flight are treated as out of date.
+ */
+- (BOOL)showCachedResultsForKeyString:(nonnull NSString *)string
+                           searchType:(HKWMentionsSearchType)type
+                         isWhitespace:(BOOL)isWhitespace
+                     controlCharacter:(unichar)character {
+    NSArray *results = [self.resultsCache completeResultsForKeyString:string
+                                                           searchType:type
+                                                     controlCharacter:character];
+    if (!results) {
+        return NO;
+    }
+    HKWLOG(@"  DEBUG: cached results for '%@' (%lu)", string, (unsigned long)[results count]);
+    [self supersedeOutstandingRequests];
+    self.currentQueryIsComplete = YES;
+    [self showResults:([results count] > 0 ? results : nil) keystringEndsWithWhiteSpace:isWhitespace];
+    return YES;
+}
+
+/*!
+ If a prefetch for a query is in flight, wait for it to finish instead of making another request, and return YES. The
+ query is then updated again, and its results are shown from the cache.
+ */
+- (BOOL)awaitPrefetchForKeyString:(nonnull NSString *)string
+                       searchType:(HKWMentionsSearchType)type
+                     isWhitespace:(BOOL)isWhitespace
+                 controlCharacter:(unichar)character {
+    NSString *prefetchKey = [HKWMentionsTypeaheadCache keyForKeyString:string searchType:type controlCharacter:character];
+    if (!self.prefetchTokens[prefetchKey]) {
+        return NO;
+    }
+    HKWLOG(@"  DEBUG: awaiting prefetched results for '%@'", string);
+    [self supersedeOutstandingRequests];
+    NSString *keyString = [string copy];
+    __weak typeof(self) weakSelf = self;
+    self.awaitedPrefetchKey = prefetchKey;
+    self.queryAwaitingPrefetch = ^{
+        [weakSelf queryUpdatedWithKeyString:keyString
+                                 searchType:type
+                               isWhitespace:isWhitespace
+                           controlCharacter:character];
+    };
+    return YES;
+}
+
+/*!
+ Drop any request waiting for the cooldown timer or for a response to come in, and treat the responses to requests
+ still in flight as out of date.
+ */
+- (void)supersedeOutstandingRequests {
+    if (self.networkState == HKWMentionsCreationNetworkStatePendingRequestAfterCooldown) {
+        self.networkState = HKWMentionsCreationNetworkStateTimerCooldown;
     }
+    self.pendingQuery = nil;
+    self.deferredRequest = nil;
+    [self cancelOpenRequests];
+    self.sequenceNumber += 1;
 }
 
 - (void)sendQueryWithKeyString:(nonnull NSString *)string
                     searchType:(HKWMentionsSearchType)type
                   isWhitespace:(BOOL)isWhitespace
               controlCharacter:(unichar)character {
-    [self activateCooldownTimer];
+    // Whatever happens to this query, the requests for earlier queries are no longer needed
+    [self cancelOpenRequests];
+    const NSUInteger maximumConcurrentRequests = [self maximumConcurrentRequests];
+    if (maximumConcurrentRequests > 0 && self.requestsAwaitingResponse >= maximumConcurrentRequests) {
+        HKWLOG(@"  DEBUG: deferring request for '%@' (%lu awaiting response)",
+               string, (unsigned long)self.requestsAwaitingResponse);
+        __weak typeof(self) weakSelf = self;
+        self.deferredRequest = ^{
+            [weakSelf sendQueryWithKeyString:string
+                                  searchType:type
+                                isWhitespace:isWhitespace
+                            controlCharacter:character];
+        };
+        return;
+    }
+    self.deferredRequest = nil;
     NSLog(@"fire:%@",string);
     // Fire off another request immediately
     self.sequenceNumber += 1;
     NSUInteger sequenceNumber = self.sequenceNumber;
+    NSString *keyString = [string copy];
+    NSArray<id<HKWMentionsTypeaheadSource>> *typeaheadSources = [self.delegate typeaheadSources];
+    if ([typeaheadSources count] > 0) {
+        [self sendFederatedQueryWithKeyString:keyString
+                                   searchType:type
+                                 isWhitespace:isWhitespace
+                             controlCharacter:character
+                               sequenceNumber:sequenceNumber
+                                      sources:typeaheadSources];
+        return;
+    }
+    // All the results returned for this request so far, and their unique IDs, since the data source may return them
+    //  over several pages. Only used while processing responses.
+    __block NSArray *requestResults = nil;
+    __block BOOL requestIsComplete = NO;
+    NSMutableSet<NSString *> *requestUniqueIds = [NSMutableSet set];
+    // Recently mentioned and locally indexed entities which match the query are shown while the request is in flight.
+    //  The results of the request are appended below them without duplicates, so that the rows the user may be about
+    //  to tap don't move.
+    NSArray *localResults = [self localResultsForKeyString:keyString searchType:type];
+    const BOOL showsLocalResults = ([localResults count] > 0);
+    if (showsLocalResults) {
+        requestResults = [HKWMentionDataProvider validResultsFromResults:localResults
+                                                                  dedupe:YES
+                                                           seenUniqueIds:requestUniqueIds];
+    }
+    // The time the request was made, until the first response to it is recorded with the rate limit policy
+    id<HKWMentionsRateLimitPolicy> rateLimitPolicy = [self rateLimitPolicy];
+    __block CFAbsoluteTime requestTime = CFAbsoluteTimeGetCurrent();
+    HKWMentionsCancellationToken *token = [HKWMentionsCancellationToken new];
+    [self.openRequestTokens addObject:token];
+    self.requestsAwaitingResponse += 1;
+    // Read once, so that all the responses to a request are handled the same way
+    const BOOL processesResponsesInBackground = HKWTextView.enableBackgroundResultsProcessing;
+    dispatch_queue_t resultsProcessingQueue = self.resultsProcessingQueue;
+    __weak typeof(self) weakSelf = self;
+    if (showsLocalResults) {
+        [self showResults:requestResults keystringEndsWithWhiteSpace:isWhitespace];
+    }
+    [self retrieveEntitiesForKeyString:keyString
+                            searchType:type
+                      controlCharacter:character
+                     cancellationToken:token
+                            completion:^(NSArray *results, BOOL dedupe, BOOL isComplete) {
+        // Validates and deduplicates a response, and then hands it to the main thread to be shown
+        void (^processResponse)(void) = ^{
+            const BOOL isFirstResponse = (requestTime > 0);
+            const NSTimeInterval responseTime = isFirstResponse ? CFAbsoluteTimeGetCurrent() - requestTime : 0;
+            requestTime = 0;
+            if (requestIsComplete) {
+                // The data source already finalized the results
+                return;
+            }
+            const BOOL isFirstPage = (requestResults == nil);
+            // An empty first response finalizes the results
+            requestIsComplete = isComplete || (isFirstResponse && [results count] == 0);
+            const BOOL isFinalPage = requestIsComplete;
+            // Responses to superseded requests are dropped before any work is done on them
+            const BOOL wasCancelled = token.cancelled;
+            NSArray *validResults = nil;
+            NSArray *allResults = nil;
+            if (!wasCancelled) {
+                validResults = [HKWMentionDataProvider validResultsFromResults:results
+                                                                        dedupe:(dedupe || showsLocalResults)
+                                                                 seenUniqueIds:requestUniqueIds];
+                requestResults = [(requestResults ?: @[]) arrayByAddingObjectsFromArray:validResults];
+                allResults = requestResults;
+            }
+            void (^publishResponse)(void) = ^{
+                typeof(self) strongSelf = weakSelf;
+                if (isFirstResponse) {
+                    if ([rateLimitPolicy respondsToSelector:@selector(recordResponseTime:forSearchType:)]
+                        && !token.cancelled) {
+                        [rateLimitPolicy recordResponseTime:responseTime forSearchType:type];
+                    }
+                    strongSelf.requestsAwaitingResponse -= 1;
+                    // Dispatched, so that the response is handled before the held back request is made
+                    dispatch_async(dispatch_get_main_queue(), ^{
+                        [weakSelf sendDeferredRequestIfPossible];
+                    });
+                }
+                if (isFinalPage) {
+                    [strongSelf.openRequestTokens removeObjectIdenticalTo:token];
+                }
+                if (wasCancelled || token.cancelled) {
+                    return;
+                }
+                if (HKWTextView.enableTypeaheadResultsCache) {
+                    // Results are cached for the query they were requested for
+                    [strongSelf.resultsCache setResults:allResults
+                                             isComplete:isFinalPage
+                                           forKeyString:keyString
+                                             searchType:type
+                                       controlCharacter:character];
+                }
+                // Check for error conditions
+                if (sequenceNumber != strongSelf.sequenceNumber) {
+                    // This is a response to an out-of-date request.
+                    HKWLOG(@"  DEBUG: out-of-date request (seq: %lu, current: %lu)",
+                           (unsigned long)sequenceNumber, (unsigned long)strongSelf.sequenceNumber);
+                    return;
+                }
+                if (isFirstPage) {
+                    strongSelf.currentQueryIsComplete = isFinalPage;
+                    [strongSelf showResults:([results count] > 0 ? validResults : nil)
+                keystringEndsWithWhiteSpace:isWhitespace];
+                } else {
+                    [strongSelf appendResults:validResults isComplete:isFinalPage];
+                }
+            };
+            if (processesResponsesInBackground) {
+                dispatch_async(dispatch_get_main_queue(), publishResponse);
+            } else {
+                publishResponse();
+            }
+        };
+        if (processesResponsesInBackground) {
+            // The data source may call back on any thread
+            dispatch_async(resultsProcessingQueue, processResponse);
+        } else {
+            processResponse();
+        }
+    }];
+}
+
+/*!
+ Request a query from the default chooser view delegate and from every registered typeahead source in parallel, and
+ show their results merged together as each of them answers. Sources are requested after their debounce interval, and
+ dropped if they haven't finalized their results by their deadline. The request counts as a single request awaiting a
+ response until the first source answers.
+ */
+- (void)sendFederatedQueryWithKeyString:(NSString *)keyString
+                             searchType:(HKWMentionsSearchType)type
+                           isWhitespace:(BOOL)isWhitespace
+                       controlCharacter:(unichar)character
+                         sequenceNumber:(NSUInteger)sequenceNumber
+                                sources:(NSArray<id<HKWMentionsTypeaheadSource>> *)sources {
+    // The default chooser view delegate is the first source, with the default priority and no debounce or deadline
+    const NSUInteger sourceCount = [sources count] + 1;
+    NSMutableArray<NSNumber *> *priorities = [NSMutableArray arrayWithCapacity:sourceCount];
+    [priorities addObject:@0];
+    for (id<HKWMentionsTypeaheadSource> source in sources) {
+        [priorities addObject:@([source respondsToSelector:@selector(sourcePriority)] ? source.sourcePriority : 0)];
+    }
+    NSArray *localResults = [self localResultsForKeyString:keyString searchType:type];
+    NSString *(^uniqueIdBlock)(id) = ^NSString *(id entity) {
+        return [HKWMentionDataProvider uniqueIdForEntity:entity];
+    };
+    HKWMentionsResultsMerger *merger = [[HKWMentionsResultsMerger alloc] initWithSourcePriorities:priorities
+                                                                                   leadingResults:localResults
+                                                                                         uniqueId:uniqueIdBlock];
+    id<HKWMentionsRateLimitPolicy> rateLimitPolicy = [self rateLimitPolicy];
+    const CFAbsoluteTime requestTime = CFAbsoluteTimeGetCurrent();
+    __block BOOL awaitingFirstResponse = YES;
+    __block BOOL showsResults = ([localResults count] > 0);
+    self.requestsAwaitingResponse += 1;
+    // Read once, so that all the responses to a request are handled the same way
+    const BOOL processesResponsesInBackground = HKWTextView.enableBackgroundResultsProcessing;
+    dispatch_queue_t resultsProcessingQueue = self.resultsProcessingQueue;
     __weak typeof(self) weakSelf = self;
-    [self.delegate asyncRetrieveEntitiesForKeyString:[string copy]
-                                          searchType:type
-                                    controlCharacter:character
-                                          completion:^(NSArray *results, BOOL dedupe,__unused BOOL isComplete) {
+
+    // Ends the wait for the first response, once a source answers or every source is dropped. Called on the main
+    //  thread.
+    void (^finishAwaitingFirstResponse)(BOOL) = ^(BOOL recordsResponseTime) {
         typeof(self) strongSelf = weakSelf;
-        typeof(HKWMentionsCreationStateMachine) *stateMachine = strongSelf.stateMachine;
-        strongSelf.currentQueryIsComplete = YES;
-        // Check for error conditions
-        if (sequenceNumber != self.sequenceNumber) {
-            // This is a response to an out-of-date request.
-            HKWLOG(@"  DEBUG: out-of-date request (seq: %lu, current: %lu)",
-                   (unsigned long)sequenceNumber, (unsigned long)self.sequenceNumber);
+        if (!awaitingFirstResponse) {
             return;
         }
-        if ([results count] == 0) {
-            // No responses
-            strongSelf.entityArray = nil;
-            [stateMachine dataReturnedWithEmptyResults:YES
-                           keystringEndsWithWhiteSpace:isWhitespace];
+        awaitingFirstResponse = NO;
+        if (recordsResponseTime && [rateLimitPolicy respondsToSelector:@selector(recordResponseTime:forSearchType:)]) {
+            [rateLimitPolicy recordResponseTime:CFAbsoluteTimeGetCurrent() - requestTime forSearchType:type];
+        }
+        strongSelf.requestsAwaitingResponse -= 1;
+        // Dispatched, so that the response is handled before the held back request is made
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf sendDeferredRequestIfPossible];
+        });
+    };
+    // Shows the merged results of the sources which answered so far. Called on the main thread.
+    void (^publishMergedResults)(void) = ^{
+        typeof(self) strongSelf = weakSelf;
+        if (sequenceNumber != strongSelf.sequenceNumber) {
             return;
         }
-        NSUInteger numResults = [results count];
-        NSMutableArray *validResults = [NSMutableArray arrayWithCapacity:numResults];
-        NSMutableSet *uniqueIds = [NSMutableSet setWithCapacity:numResults];
-        for (id entity in results) {
-#ifdef DEBUG
-            // Validate
-            NSAssert([entity conformsToProtocol:@protocol(HKWMentionsEntityProtocol)],
-                     @"Data results array contained at least one object that didn't conform to the protocol. This is a \
-                     serious error. Object: %@",
-                     entity);
-#endif
-            if (dedupe) {
-                // This is the first response; protect against duplicates within this response
-                NSString *uniqueId = [self uniqueIdForEntity:entity];
-                if ([uniqueId length] && ![uniqueIds containsObject:uniqueId]) {
-                    [validResults addObject:entity];
-                    [uniqueIds addObject:uniqueId];
+        NSArray *results = merger.results;
+        const BOOL isComplete = merger.isComplete;
+        if (isComplete && !merger.hasDroppedSources && HKWTextView.enableTypeaheadResultsCache) {
+            [strongSelf.resultsCache setResults:results
+                                     isComplete:YES
+                                   forKeyString:keyString
+                                     searchType:type
+                               controlCharacter:character];
+        }
+        if (!showsResults) {
+            if ([results count] == 0 && !isComplete) {
+                // Wait for a source with results, rather than ending mention creation while others may still have some
+                return;
+            }
+            showsResults = YES;
+            strongSelf.currentQueryIsComplete = isComplete;
+            [strongSelf showResults:([results count] > 0 ? results : nil) keystringEndsWithWhiteSpace:isWhitespace];
+        } else {
+            [strongSelf updateResults:results isComplete:isComplete];
+        }
+        // Results which arrive later are appended below the rows shown now
+        [merger markResultsAsPublished];
+    };
+
+    if (showsResults) {
+        [self showResults:merger.results keystringEndsWithWhiteSpace:isWhitespace];
+        [merger markResultsAsPublished];
+    }
+    for (NSUInteger i = 0; i < sourceCount; i++) {
+        id<HKWMentionsTypeaheadSource> source = (i > 0) ? sources[i - 1] : nil;
+        HKWMentionsCancellationToken *token = [HKWMentionsCancellationToken new];
+        [self.openRequestTokens addObject:token];
+        NSMutableSet<NSString *> *sourceUniqueIds = [NSMutableSet set];
+        __block BOOL sourceResponded = NO;
+
+        // Ends the source's request, once it finalized its results or missed its deadline. Called on the main thread.
+        void (^finishSource)(BOOL) = ^(BOOL missedDeadline) {
+            [weakSelf.openRequestTokens removeObjectIdenticalTo:token];
+            if (missedDeadline) {
+                HKWLOG(@"  DEBUG: dropping typeahead source %lu for '%@'", (unsigned long)i, keyString);
+                [merger dropSourceAtIndex:i];
+                [token cancel];
+            }
+            if (merger.isComplete) {
+                finishAwaitingFirstResponse(NO);
+            }
+        };
+        void (^completion)(NSArray *, BOOL, BOOL) = ^(NSArray *results, __unused BOOL dedupe, BOOL isComplete) {
+            // Validates and deduplicates a response, and then hands it to the main thread to be merged
+            void (^processResponse)(void) = ^{
+                const BOOL wasCancelled = token.cancelled;
+                NSArray *validResults = nil;
+                if (!wasCancelled) {
+                    validResults = [HKWMentionDataProvider validResultsFromResults:results
+                                                                            dedupe:YES
+                                                                     seenUniqueIds:sourceUniqueIds];
                 }
+                void (^publishResponse)(void) = ^{
+                    const BOOL isFirstResponse = !sourceResponded;
+                    sourceResponded = YES;
+                    if ([merger hasFinishedSourceAtIndex:i]) {
+                        // The source already finalized its results, or missed its deadline
+                        return;
+                    }
+                    const BOOL cancelled = (wasCancelled || token.cancelled);
+                    finishAwaitingFirstResponse(!cancelled);
+                    if (cancelled) {
+                        return;
+                    }
+                    // An empty first response finalizes the source's results
+                    const BOOL isFinalPage = isComplete || (isFirstResponse && [results count] == 0);
+                    [merger addResults:validResults fromSourceAtIndex:i isComplete:isFinalPage];
+                    if (isFinalPage) {
+                        finishSource(NO);
+                    }
+                    publishMergedResults();
+                };
+                if (processesResponsesInBackground) {
+                    dispatch_async(dispatch_get_main_queue(), publishResponse);
+                } else {
+                    publishResponse();
+                }
+            };
+            if (processesResponsesInBackground) {
+                // The source may call back on any thread
+                dispatch_async(resultsProcessingQueue, processResponse);
+            } else if ([NSThread isMainThread]) {
+                processResponse();
+            } else {
+                dispatch_async(dispatch_get_main_queue(), processResponse);
+            }
+        };
+        void (^request)(void) = ^{
+            if (token.cancelled) {
+                // A newer query was made while the source was being debounced
+                completion(nil, NO, YES);
+                return;
             }
-            else {
+            if (source) {
+                [source asyncRetrieveEntitiesForKeyString:keyString
+                                               searchType:type
+                                         controlCharacter:character
+                                        cancellationToken:token
+                                               completion:completion];
+            } else {
+                [weakSelf retrieveEntitiesForKeyString:keyString
+                                            searchType:type
+                                      controlCharacter:character
+                                     cancellationToken:token
+                                            completion:completion];
+            }
+        };
+
+        const NSTimeInterval timeout = [source respondsToSelector:@selector(sourceTimeout)] ? source.sourceTimeout : 0;
+        if (timeout > 0) {
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC)),
+                           dispatch_get_main_queue(), ^{
+                if (token.cancelled || [merger hasFinishedSourceAtIndex:i]) {
+                    return;
+                }
+                finishSource(YES);
+                publishMergedResults();
+            });
+        }
+        const NSTimeInterval debounceInterval = ([source respondsToSelector:@selector(sourceDebounceInterval)]
+                                                 ? source.sourceDebounceInterval
+                                                 : 0);
+        if (debounceInterval > 0) {
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(debounceInterval * NSEC_PER_SEC)),
+                           dispatch_get_main_queue(),
+                           request);
+        } else {
+            request();
+        }
+    }
+}
+
+/*!
+ Request a query from the default chooser view delegate, through the plug-in's typeahead service if it has one, so that
+ the request may be shared with other plug-ins making the same query.
+ */
+- (void)retrieveEntitiesForKeyString:(NSString *)keyString
+                          searchType:(HKWMentionsSearchType)type
+                    controlCharacter:(unichar)character
+                   cancellationToken:(HKWMentionsCancellationToken *)token
+                          completion:(HKWMentionsTypeaheadCompletion)completion {
+    HKWMentionsTypeaheadService *typeaheadService = [self.delegate typeaheadService];
+    if (!typeaheadService) {
+        [self.delegate asyncRetrieveEntitiesForKeyString:keyString
+                                              searchType:type
+                                        controlCharacter:character
+                                       cancellationToken:token
+                                              completion:completion];
+        return;
+    }
+    __weak typeof(self) weakSelf = self;
+    void (^request)(HKWMentionsCancellationToken *, HKWMentionsTypeaheadCompletion) =
+    ^(HKWMentionsCancellationToken *sharedToken, HKWMentionsTypeaheadCompletion sharedCompletion) {
+        [weakSelf.delegate asyncRetrieveEntitiesForKeyString:keyString
+                                                  searchType:type
+                                            controlCharacter:character
+                                           cancellationToken:sharedToken
+                                                  completion:sharedCompletion];
+    };
+    [typeaheadService retrieveEntitiesForKeyString:keyString
+                                        searchType:type
+                                  controlCharacter:character
+                                 cancellationToken:token
+                                           request:request
+                                        completion:completion];
+}
+
+/*!
+ Return the entities held on the device which match a query: the recently mentioned ones, most recent first, followed by
+ those in the local entity index. The two may overlap. Returns nil if there are no local sources.
+ */
+- (NSArray *)localResultsForKeyString:(NSString *)keyString searchType:(HKWMentionsSearchType)type {
+    if (type == HKWMentionsSearchTypeInitial) {
+        // The initial results are suggestions chosen by the data source
+        return nil;
+    }
+    NSArray *recentResults = [[self.delegate recentEntitiesStore] entitiesMatchingKeyString:keyString];
+    NSArray *indexResults = [[self.delegate localEntityIndex] entitiesMatchingKeyString:keyString];
+    if (!indexResults) {
+        return recentResults;
+    }
+    return recentResults ? [recentResults arrayByAddingObjectsFromArray:indexResults] : indexResults;
+}
+
+/*!
+ Cancel all the requests whose results are still expected. Their completion blocks are still called, but any results
+ passed to them are ignored.
+ */
+- (void)cancelOpenRequests {
+    if ([self.openRequestTokens count] == 0) {
+        return;
+    }
+    NSArray<HKWMentionsCancellationToken *> *tokens = [self.openRequestTokens copy];
+    [self.openRequestTokens removeAllObjects];
+    for (HKWMentionsCancellationToken *token in tokens) {
+        [token cancel];
+    }
+}
+
+/*!
+ Make the request which was held back because too many requests were awaiting a response, if there is one and that is
+ no longer the case.
+ */
+- (void)sendDeferredRequestIfPossible {
+    void (^deferredRequest)(void) = self.deferredRequest;
+    const NSUInteger maximumConcurrentRequests = [self maximumConcurrentRequests];
+    if (!deferredRequest
+        || (maximumConcurrentRequests > 0 && self.requestsAwaitingResponse >= maximumConcurrentRequests)) {
+        return;
+    }
+    self.deferredRequest = nil;
+    deferredRequest();
+}
+
+/*!
+ Validate the entities returned by the delegate and, if requested, remove duplicates from them. \c seenUniqueIds holds
+ the unique IDs of the results already shown for the request, so that duplicates are also removed across pages, and is
+ updated with the unique IDs of the returned results. Safe to call from any thread.
+ */
++ (NSArray *)validResultsFromResults:(NSArray *)results
+                              dedupe:(BOOL)dedupe
+                       seenUniqueIds:(NSMutableSet<NSString *> *)uniqueIds {
+    NSUInteger numResults = [results count];
+    NSMutableArray *validResults = [NSMutableArray arrayWithCapacity:numResults];
+    for (id entity in results) {
+#ifdef DEBUG
+        // Validate
+        NSAssert([entity conformsToProtocol:@protocol(HKWMentionsEntityProtocol)],
+                 @"Data results array contained at least one object that didn't conform to the protocol. This is a \
+                 serious error. Object: %@",
+                 entity);
+#endif
+        NSString *uniqueId = [self uniqueIdForEntity:entity];
+        if (dedupe) {
+            // Protect against duplicates within this response, and against results of earlier pages
+            if ([uniqueId length] && ![uniqueIds containsObject:uniqueId]) {
                 [validResults addObject:entity];
+                [uniqueIds addObject:uniqueId];
             }
         }
-        self.entityArray = [validResults copy];
+        else {
+            [validResults addObject:entity];
+            if ([uniqueId length]) {
+                [uniqueIds addObject:uniqueId];
+            }
+        }
+    }
+    return [validResults copy];
+}
 
-        [stateMachine dataReturnedWithEmptyResults:NO
-                       keystringEndsWithWhiteSpace:isWhitespace];
+/*!
+ Populate the chooser with results and inform the state machine. Pass nil to indicate that there are no results.
+ */
+- (void)showResults:(nullable NSArray *)results keystringEndsWithWhiteSpace:(BOOL)isWhitespace {
+    HKWMentionsCreationStateMachine *stateMachine = self.stateMachine;
+    self.entityArray = results;
+    [stateMachine dataReturnedWithEmptyResults:(results == nil)
+                   keystringEndsWithWhiteSpace:isWhitespace];
+}
+
+/*!
+ Append a page of results to the chooser, inserting their rows rather than reloading it. If the page is the final one,
+ the loading cell is removed along with it.
+ */
+- (void)appendResults:(NSArray *)results isComplete:(BOOL)isComplete {
+    const NSUInteger firstRow = [self.entityArray count];
+    const NSUInteger numResults = [results count];
+    if (numResults == 0 && isComplete == self.currentQueryIsComplete) {
+        return;
+    }
+    NSMutableArray<NSIndexPath *> *insertedIndexPaths = [NSMutableArray arrayWithCapacity:numResults];
+    for (NSUInteger i = 0; i < numResults; i++) {
+        [insertedIndexPaths addObject:[NSIndexPath indexPathForRow:(NSInteger)(firstRow + i) inSection:0]];
+    }
+    self.currentQueryIsComplete = isComplete;
+    [self batchUpdateEntityArray:[(self.entityArray ?: @[]) arrayByAddingObjectsFromArray:results]
+                      rowChanges:^(UITableView *tableView) {
+        [tableView insertRowsAtIndexPaths:insertedIndexPaths withRowAnimation:UITableViewRowAnimationNone];
     }];
 }
 
-- (NSString *)uniqueIdForEntity:(id<HKWMentionsEntityProtocol>)entity {
+/*!
+ Replace the results shown in the chooser with a superset of them. If the results already shown are kept in place, the
+ new ones are appended; otherwise, the chooser is updated in place.
+ */
+- (void)updateResults:(NSArray *)results isComplete:(BOOL)isComplete {
+    NSArray *entityArray = self.entityArray ?: @[];
+    const NSUInteger shownCount = [entityArray count];
+    if ([results count] >= shownCount
+        && [[results subarrayWithRange:NSMakeRange(0, shownCount)] isEqualToArray:entityArray]) {
+        [self appendResults:[results subarrayWithRange:NSMakeRange(shownCount, [results count] - shownCount)]
+                 isComplete:isComplete];
+        return;
+    }
+    self.currentQueryIsComplete = isComplete;
+    self.entityArray = results;
+}
+
+/*!
+ Replace the backing store and update the chooser's table view in a single batch. The backing store is replaced within
+ the batch, so that the table view sees the previous results until then; the loading section is inserted or deleted as
+ needed to match \c currentQueryIsComplete.
+ */
+- (void)batchUpdateEntityArray:(NSArray *)entityArray rowChanges:(void (^)(UITableView *tableView))rowChanges {
+    NSString *matchString = [self.currentQuery copy];
+    [self.stateMachine updateChooserViewWithBatchUpdates:^(UITableView *tableView) {
+        const NSInteger displayedSections = tableView.numberOfSections;
+        self->_entityArray = entityArray;
+        self.displayedMatchString = matchString;
+        const BOOL showsLoadingSection = [self showsLoadingSection];
+        if (displayedSections > 1 && !showsLoadingSection) {
+            [tableView deleteSections:[NSIndexSet indexSetWithIndex:1] withRowAnimation:UITableViewRowAnimationNone];
+        } else if (displayedSections == 1 && showsLoadingSection) {
+            [tableView insertSections:[NSIndexSet indexSetWithIndex:1] withRowAnimation:UITableViewRowAnimationNone];
+        }
+        rowChanges(tableView);
+    }];
+}
+
+/*!
+ Return the changes to turn the results shown in the chooser into \c entityArray, or nil if the chooser must be reloaded
+ instead. The cells of results that remain are only updated if their name, or the part of it which matches the query,
+ changed.
+ */
+- (HKWMentionsResultsDiff *)diffToEntityArray:(NSArray *)entityArray {
+    NSString *previousMatchString = self.displayedMatchString ?: @"";
+    NSString *matchString = self.currentQuery ?: @"";
+    return [HKWMentionsResultsDiff diffFromResults:self.entityArray
+                                         toResults:entityArray
+                                          uniqueId:^NSString *(id<HKWMentionsEntityProtocol> entity) {
+        return [[self class] uniqueIdForEntity:entity];
+    }
+                                       needsReload:^BOOL(id<HKWMentionsEntityProtocol> oldEntity, id<HKWMentionsEntityProtocol> newEntity) {
+        NSString *oldName = [oldEntity entityName];
+        NSString *newName = [newEntity entityName];
+        if (![oldName isEqualToString:newName]) {
+            return YES;
+        }
+        return !NSEqualRanges([HKWMentionsTypeaheadCache rangeOfKeyString:previousMatchString inName:oldName],
+                              [HKWMentionsTypeaheadCache rangeOfKeyString:matchString inName:newName]);
+    }];
+}
+
+- (BOOL)showsLoadingSection {
+    return self.delegate.loadingCellSupported && !self.currentQueryIsComplete;
+}
+
++ (NSString *)uniqueIdForEntity:(id<HKWMentionsEntityProtocol>)entity {
     if ([entity respondsToSelector:@selector(uniqueId)]) {
         return [entity uniqueId];
     }
@@ -177,49 +900,81 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
     if (!_entityArray && !entityArray) {
         return;
     }
-    _entityArray = entityArray;
-    // Force the entity chooser's table view to update
-    [self.stateMachine reloadChooserView];
+    NSArray *previousEntityArray = _entityArray;
+    HKWMentionsResultsDiff *diff = nil;
+    if ([previousEntityArray count] > 0 && [entityArray count] > 0) {
+        diff = [self diffToEntityArray:entityArray];
+    }
+    if (!diff) {
+        _entityArray = entityArray;
+        self.displayedMatchString = self.currentQuery;
+        // Force the entity chooser's table view to update
+        [self.stateMachine reloadChooserView];
+        return;
+    }
+    // Keep the scroll position if the user would still see the same top result; otherwise, show the new top result
+    const BOOL topResultChanged = ![[[self class] uniqueIdForEntity:previousEntityArray[0]]
+                                    isEqualToString:[[self class] uniqueIdForEntity:entityArray[0]]];
+    [self batchUpdateEntityArray:entityArray rowChanges:^(UITableView *tableView) {
+        [diff applyToTableView:tableView section:0];
+        if (topResultChanged) {
+            [tableView setContentOffset:CGPointMake(0, 0) animated:NO];
+        }
+    }];
 }
 
-/*!
- Configure and activate the cooldown timer. If the cooldown timer was already active, restarts it.
- */
-- (void)activateCooldownTimer {
-    // Remove any pre-existing timers.
-    [self.cooldownTimer invalidate];
+- (HKWMentionsTypeaheadCache *)resultsCache {
+    // Plug-ins sharing a typeahead service share its cache
+    return [self.delegate typeaheadService].resultsCache ?: _resultsCache;
+}
 
-    // Advance state
-    switch (self.networkState) {
-        case HKWMentionsCreationNetworkStateReady:
-            self.networkState = HKWMentionsCreationNetworkStateTimerCooldown;
-            break;
-        case HKWMentionsCreationNetworkStateTimerCooldown:
-            NSAssert(NO, @"Timer should never be activated when state machine is waiting for timer cooldown.");
-            break;
-        case HKWMentionsCreationNetworkStatePendingRequestAfterCooldown:
-            // Valid state transition. This happens if a new request is fired as soon as the timer times out.
-            self.networkState = HKWMentionsCreationNetworkStateTimerCooldown;
-            break;
+- (id<HKWMentionsRateLimitPolicy>)rateLimitPolicy {
+    return [self.delegate rateLimitPolicy] ?: [HKWMentionsDefaultRateLimitPolicy defaultPolicy];
+}
+
+- (NSUInteger)maximumConcurrentRequests {
+    id<HKWMentionsRateLimitPolicy> rateLimitPolicy = [self rateLimitPolicy];
+    if ([rateLimitPolicy respondsToSelector:@selector(maximumConcurrentRequests)]) {
+        return rateLimitPolicy.maximumConcurrentRequests;
     }
+    return 0;
+}
 
-    // Add and activate the timer
-    NSTimer *timer = [NSTimer timerWithTimeInterval:self.cooldownPeriod
-                                             target:self
-                                           selector:@selector(cooldownTimerFired:)
-                                           userInfo:nil
-                                            repeats:NO];
-    self.cooldownTimer = timer;
-    [[NSRunLoop mainRunLoop] addTimer:timer forMode:NSDefaultRunLoopMode];
+- (dispatch_source_t)cooldownTimer {
+    if (!_cooldownTimer) {
+        _cooldownTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+        __weak typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(_cooldownTimer, ^{
+            [weakSelf cooldownTimerFired];
+        });
+        dispatch_source_set_timer(_cooldownTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(_cooldownTimer);
+    }
+    return _cooldownTimer;
 }
 
+/*!
+ Arm the cooldown timer with the delay the rate limit policy chooses for the given search type. If the cooldown timer
+ was already armed, restarts it.
+ */
+- (void)activateCooldownTimerForSearchType:(HKWMentionsSearchType)type {
+    const NSTimeInterval delay = MAX([[self rateLimitPolicy] delayForSearchType:type], 0);
+    dispatch_source_set_timer(self.cooldownTimer,
+                              dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                              DISPATCH_TIME_FOREVER,
+                              NSEC_PER_MSEC);
+    if (self.networkState == HKWMentionsCreationNetworkStateReady) {
+        self.networkState = HKWMentionsCreationNetworkStateTimerCooldown;
+    }
+    [self.delegate typeaheadRequestDelayedBy:delay forSearchType:type];
+}
 
 /*!
  Handle actions and state transitions after the cooldown timer fires. If the user has queued up another request, this
  method may fire another typeahead request to the server immediately. Otherwise, the firing of the timer indicates that
  it is acceptable to send another request at any time.
  */
-- (void)cooldownTimerFired:(__unused NSTimer *)timer {
+- (void)cooldownTimerFired {
     switch (self.networkState) {
         case HKWMentionsCreationNetworkStateReady:
             NSAssert(NO, @"Timer should never be active when state machine is in the 'ready' state.");
@@ -227,18 +982,23 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
         case HKWMentionsCreationNetworkStateTimerCooldown:
             self.networkState = HKWMentionsCreationNetworkStateReady;
             break;
-        case HKWMentionsCreationNetworkStatePendingRequestAfterCooldown:
+        case HKWMentionsCreationNetworkStatePendingRequestAfterCooldown: {
             self.networkState = HKWMentionsCreationNetworkStateReady;
             NSString *pendingQuery = self.pendingQuery;
-            if (pendingQuery) {
-                [self sendQueryWithKeyString:[pendingQuery copy]
-                                  searchType:self.pendingSearchType
-                                isWhitespace:self.pendingQueryIsWhitespace
-                            controlCharacter:self.pendingControlCharacter];
-            } else {
+            if (!pendingQuery) {
                 NSAssert(NO, @"pending query is nil.");
+                break;
+            }
+            HKWMentionsSearchType pendingSearchType = self.pendingSearchType;
+            [self sendQueryWithKeyString:[pendingQuery copy]
+                              searchType:pendingSearchType
+                            isWhitespace:self.pendingQueryIsWhitespace
+                        controlCharacter:self.pendingControlCharacter];
+            if ([self rateLimitPolicy].sendsLeadingEdgeRequests) {
+                [self activateCooldownTimerForSearchType:pendingSearchType];
             }
             break;
+        }
     }
 }
 
@@ -266,7 +1026,7 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
 }
 
 - (NSInteger)numberOfSectionsInTableView:(__unused UITableView *)tableView {
-    return (self.delegate.loadingCellSupported && !self.currentQueryIsComplete) ? 2 : 1;
+    return [self showsLoadingSection] ? 2 : 1;
 }
 
 - (NSInteger)tableView:(__unused UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
@@ -290,7 +1050,43 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationNetworkState) {
     NSAssert(indexPath.row >= 0 && (NSUInteger)indexPath.row < [self.entityArray count],
              @"Entity chooser table view requested a cell with an out-of-bounds index path row.");
     id<HKWMentionsEntityProtocol> entity = self.entityArray[(NSUInteger)indexPath.row];
-    return [delegate heightForCellForMentionsEntity:entity tableView:tableView];
+    HKWMentionsCellHeightCache *cellHeightCache = [delegate cellHeightCache];
+    NSNumber *cachedHeight = [cellHeightCache heightForEntity:entity inTableView:tableView];
+    if (cachedHeight) {
+        return (CGFloat)[cachedHeight doubleValue];
+    }
+    CGFloat height = [delegate heightForCellForMentionsEntity:entity tableView:tableView];
+    if (height != UITableViewAutomaticDimension) {
+        // Self-sizing cells are cached once they are displayed, and their size is known
+        [cellHeightCache setHeight:height forEntity:entity inTableView:tableView];
+    }
+    return height;
+}
+
+- (CGFloat)tableView:(UITableView *)tableView estimatedHeightForRowAtIndexPath:(NSIndexPath *)indexPath {
+    __strong __auto_type delegate = self.delegate;
+    if (indexPath.section == 1) {
+        // Loading cell
+        return [delegate heightForLoadingCellInTableView:tableView];
+    }
+    if (indexPath.row < 0 || (NSUInteger)indexPath.row >= [self.entityArray count]) {
+        return [delegate cellHeightCache].defaultEstimatedHeight;
+    }
+    id<HKWMentionsEntityProtocol> entity = self.entityArray[(NSUInteger)indexPath.row];
+    return [[delegate cellHeightCache] estimatedHeightForEntity:entity inTableView:tableView];
+}
+
+- (void)tableView:(UITableView *)tableView
+  willDisplayCell:(UITableViewCell *)cell
+forRowAtIndexPath:(NSIndexPath *)indexPath {
+    if (indexPath.section != 0 || indexPath.row < 0 || (NSUInteger)indexPath.row >= [self.entityArray count]) {
+        return;
+    }
+    id<HKWMentionsEntityProtocol> entity = self.entityArray[(NSUInteger)indexPath.row];
+    HKWMentionsCellHeightCache *cellHeightCache = [self.delegate cellHeightCache];
+    if (![cellHeightCache heightForEntity:entity inTableView:tableView]) {
+        [cellHeightCache setHeight:CGRectGetHeight(cell.bounds) forEntity:entity inTableView:tableView];
+    }
 }
 
 - (void)tableView:(UITableView *)tableView didSelectRowAtIndexPath:(NSIndexPath *)indexPath {
@@ -0,0 +1,46 @@
+//
+//  HKWMentionsCancellationToken.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ An object passed along with a typeahead request, which the mentions plug-in cancels once the results of the request are
+ no longer needed: either because the user changed the query, or because mention creation ended. Data sources can use
+ it to stop network requests and other work for queries the user has moved on from.
+
+ Cancellation is advisory. The data source must still call the completion block of a canceled request, typically with
+ nil, and the plug-in ignores any results passed to it.
+ */
+@interface HKWMentionsCancellationToken : NSObject
+
+/*!
+ Whether the request has been canceled. May be checked from any thread.
+ */
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/*!
+ Register a block to be called when the request is canceled. The block is called on the thread which cancels the
+ request, which is the main thread if the plug-in cancels it. If the request was already canceled, the block is called
+ immediately.
+ */
+- (void)addCancellationHandler:(void(^)(void))handler;
+
+/*!
+ Cancel the request, and call any registered cancellation handlers. Has no effect if the request was already canceled.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,63 @@
+//
+//  HKWMentionsCancellationToken.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "HKWMentionsCancellationToken.h"
+
+@interface HKWMentionsCancellationToken ()
+
+@property (atomic, readwrite, getter=isCancelled) BOOL cancelled;
+
+/// Handlers waiting for the request to be canceled; nil once it has been.
+@property (nonatomic, strong, nullable) NSMutableArray<void(^)(void)> *cancellationHandlers;
+
+@end
+
+@implementation HKWMentionsCancellationToken
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _cancellationHandlers = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)addCancellationHandler:(void (^)(void))handler {
+    if (!handler) {
+        return;
+    }
+    @synchronized (self) {
+        if (!self.cancelled) {
+            [self.cancellationHandlers addObject:[handler copy]];
+            return;
+        }
+    }
+    // Called outside the lock, so that the handler may use the token
+    handler();
+}
+
+- (void)cancel {
+    NSArray<void(^)(void)> *handlers;
+    @synchronized (self) {
+        if (self.cancelled) {
+            return;
+        }
+        self.cancelled = YES;
+        handlers = self.cancellationHandlers;
+        self.cancellationHandlers = nil;
+    }
+    for (void(^handler)(void) in handlers) {
+        handler();
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  HKWMentionsCellHeightCache.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <UIKit/UIKit.h>
+
+#import "HKWMentionsEntityProtocol.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ A cache of the heights of the chooser cells for mentions entities, keyed by the entity's unique ID (or entity ID, if it
+ has none) and the width and content size category of the table view, so that table views of different widths can share
+ a cache. The cache holds a bounded number of heights, discarding the least recently used ones first, and discards all
+ of them when the preferred content size category changes.
+
+ The mentions plug-in uses its cache for the default chooser view, and custom chooser views can share it through the
+ plug-in's \c cellHeightCache property.
+ */
+@interface HKWMentionsCellHeightCache : NSObject
+
+/*!
+ Initialize a cache holding at most \c capacity heights. \c init uses a capacity of 256.
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+
+/*!
+ The maximum number of heights the cache holds.
+ */
+@property (nonatomic, readonly) NSUInteger capacity;
+
+/*!
+ The number of heights currently cached.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ The height used as an estimate when nothing is known about a cell. Defaults to 44.
+ */
+@property (nonatomic) CGFloat defaultEstimatedHeight;
+
+/*!
+ Return the cached height of the cell for an entity in a table view, or nil if it isn't known.
+ */
+- (nullable NSNumber *)heightForEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView;
+
+/*!
+ Cache the height of the cell for an entity in a table view.
+ */
+- (void)setHeight:(CGFloat)height forEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView;
+
+/*!
+ Return an estimate of the height of the cell for an entity in a table view: its cached height if known, otherwise the
+ average of the cached heights, or \c defaultEstimatedHeight if no heights are cached.
+ */
+- (CGFloat)estimatedHeightForEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView;
+
+/*!
+ Discard all cached heights, for example after the chooser cells change appearance.
+ */
+- (void)removeAllHeights;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,130 @@
+//
+//  HKWMentionsCellHeightCache.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "HKWMentionsCellHeightCache.h"
+
+@interface HKWMentionsCellHeightCache ()
+
+@property (nonatomic, readwrite) NSUInteger capacity;
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *heights;
+
+/// The keys of \c heights, ordered from least to most recently used.
+@property (nonatomic, strong) NSMutableOrderedSet<NSString *> *recentKeys;
+
+/// The sum of the cached heights, for estimates.
+@property (nonatomic) CGFloat totalHeight;
+
+@end
+
+@implementation HKWMentionsCellHeightCache
+
+- (instancetype)init {
+    return [self initWithCapacity:256];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _capacity = MAX(capacity, (NSUInteger)1);
+        _heights = [NSMutableDictionary dictionaryWithCapacity:_capacity];
+        _recentKeys = [NSMutableOrderedSet orderedSetWithCapacity:_capacity];
+        _defaultEstimatedHeight = 44;
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(contentSizeCategoryDidChange:)
+                                                     name:UIContentSizeCategoryDidChangeNotification
+                                                   object:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark - API
+
+- (NSUInteger)count {
+    return [self.heights count];
+}
+
+- (NSNumber *)heightForEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView {
+    NSString *key = [self keyForEntity:entity inTableView:tableView];
+    NSNumber *height = key ? self.heights[key] : nil;
+    if (height) {
+        [self markKeyAsRecentlyUsed:key];
+    }
+    return height;
+}
+
+- (void)setHeight:(CGFloat)height forEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView {
+    NSString *key = [self keyForEntity:entity inTableView:tableView];
+    if (!key || height < 0) {
+        return;
+    }
+    NSNumber *previousHeight = self.heights[key];
+    if (previousHeight) {
+        self.totalHeight -= (CGFloat)[previousHeight doubleValue];
+    }
+    self.heights[key] = @(height);
+    self.totalHeight += height;
+    [self markKeyAsRecentlyUsed:key];
+    while ([self.recentKeys count] > self.capacity) {
+        NSString *leastRecentlyUsedKey = [self.recentKeys firstObject];
+        [self.recentKeys removeObjectAtIndex:0];
+        self.totalHeight -= (CGFloat)[self.heights[leastRecentlyUsedKey] doubleValue];
+        [self.heights removeObjectForKey:leastRecentlyUsedKey];
+    }
+}
+
+- (CGFloat)estimatedHeightForEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView {
+    NSNumber *height = [self heightForEntity:entity inTableView:tableView];
+    if (height) {
+        return (CGFloat)[height doubleValue];
+    }
+    NSUInteger count = [self.heights count];
+    return count > 0 ? self.totalHeight / (CGFloat)count : self.defaultEstimatedHeight;
+}
+
+- (void)removeAllHeights {
+    [self.heights removeAllObjects];
+    [self.recentKeys removeAllObjects];
+    self.totalHeight = 0;
+}
+
+#pragma mark - Private
+
+/*!
+ Return the key for the height of an entity's cell in a table view, or nil if the entity has no ID.
+ */
+- (NSString *)keyForEntity:(id<HKWMentionsEntityProtocol>)entity inTableView:(UITableView *)tableView {
+    NSString *uniqueId = ([entity respondsToSelector:@selector(uniqueId)] ? [entity uniqueId] : [entity entityId]);
+    if ([uniqueId length] == 0) {
+        return nil;
+    }
+    // The unique ID comes last, so that it can't be confused with the fixed-format fields before it
+    return [NSString stringWithFormat:@"%g:%@:%@",
+            (double)CGRectGetWidth(tableView.bounds),
+            tableView.traitCollection.preferredContentSizeCategory,
+            uniqueId];
+}
+
+- (void)markKeyAsRecentlyUsed:(NSString *)key {
+    [self.recentKeys removeObject:key];
+    [self.recentKeys addObject:key];
+}
+
+- (void)contentSizeCategoryDidChange:(__unused NSNotification *)notification {
+    [self removeAllHeights];
+}
+
+@end
@@ -18,6 +18,7 @@
 
 #import "_HKWMentionsPrivateConstants.h"
 #import "HKWMentionDataProvider.h"
+#import "HKWMentionsCancellationToken.h"
 
 /*!
  States for the master state machine.
@@ -89,6 +90,9 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
 
 @property (nonatomic, readwrite) BOOL chooserViewDidSetup;
 
+/// The cancellation token passed along with the last key string given directly to a custom chooser view delegate.
+@property (nonatomic, strong, nullable) HKWMentionsCancellationToken *customChooserViewRequestToken;
+
 @end
 
 @implementation HKWMentionsCreationStateMachine
@@ -176,8 +180,7 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
                                                 controlCharacter:self.explicitSearchControlCharacter];
                 } else {
                     // If we do not have a data provider, just pass the updated query directly to the mention plugin
-                    [delegate didUpdateKeyString:[self.stringBuffer copy]
-                                controlCharacter:self.explicitSearchControlCharacter];
+                    [self updateCustomChooserViewWithKeyString:[self.stringBuffer copy]];
                 }
             }
             break;
@@ -282,8 +285,7 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
                                             controlCharacter:self.explicitSearchControlCharacter];
             } else {
                 // If we do not have a data provider, just pass the updated query directly to the mention plugin
-                [delegate didUpdateKeyString:[self.stringBuffer copy]
-                            controlCharacter:self.explicitSearchControlCharacter];
+                [self updateCustomChooserViewWithKeyString:[self.stringBuffer copy]];
             }
             break;
     }
@@ -333,8 +335,7 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
                                     controlCharacter:self.explicitSearchControlCharacter];
     } else {
         // If we do not have a data provider, just pass the updated query directly to the mention plugin
-        [self.delegate didUpdateKeyString:prefix
-                         controlCharacter:self.explicitSearchControlCharacter];
+        [self updateCustomChooserViewWithKeyString:prefix];
     }
 }
 
@@ -374,11 +375,52 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
                                     controlCharacter:self.explicitSearchControlCharacter];
     } else {
         // If we do not have a data provider, just pass the updated query directly to the mention plugin
-        [self.delegate didUpdateKeyString:@""
-                         controlCharacter:self.explicitSearchControlCharacter];
+        [self updateCustomChooserViewWithKeyString:@""];
+    }
+}
+
+- (void)prefetchInitialResultsForControlCharacter:(unichar)character {
+    if (!self.dataProvider || !HKWTextView.enableTypeaheadResultsCache) {
+        return;
+    }
+    // Create and lay out the (hidden) chooser view now, rather than while the first query is being made
+    [self setupChooserViewIfNeeded];
+    [self.entityChooserView layoutIfNeeded];
+    [self.dataProvider prefetchResultsForKeyString:@""
+                                        searchType:HKWMentionsSearchTypeExplicit
+                                  controlCharacter:character];
+}
+
+- (void)prefetchInitialResultsForControlCharacters:(NSCharacterSet *)controlCharacters {
+    // Scan the bitmap representation rather than testing every code point of the plane for membership
+    NSData *bitmap = [controlCharacters bitmapRepresentation];
+    const uint8_t *bytes = [bitmap bytes];
+    const NSUInteger length = MIN([bitmap length], (NSUInteger)8192);
+    for (NSUInteger i = 0; i < length; i++) {
+        if (bytes[i] == 0) {
+            continue;
+        }
+        for (NSUInteger bit = 0; bit < 8; bit++) {
+            if (bytes[i] & (1 << bit)) {
+                [self prefetchInitialResultsForControlCharacter:(unichar)(i * 8 + bit)];
+            }
+        }
     }
 }
 
+/*!
+ Pass an updated key string directly to the delegate, for a custom chooser view. The request for the previous key
+ string, if any, is canceled.
+ */
+- (void)updateCustomChooserViewWithKeyString:(NSString *)keyString {
+    [self.customChooserViewRequestToken cancel];
+    HKWMentionsCancellationToken *token = [HKWMentionsCancellationToken new];
+    self.customChooserViewRequestToken = token;
+    [self.delegate didUpdateKeyString:keyString
+                     controlCharacter:self.explicitSearchControlCharacter
+                    cancellationToken:token];
+}
+
 #pragma mark - Chooser View Frame
 
 + (BOOL)modeConfiguresArrowPointingUp:(HKWMentionsChooserPositionMode)mode {
@@ -477,6 +519,17 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
     [self.entityChooserView reloadData];
 }
 
+- (void)updateChooserViewWithBatchUpdates:(void (^)(UITableView *))updates {
+    UIView<HKWChooserViewProtocol> *chooserView = self.entityChooserView;
+    if ([chooserView respondsToSelector:@selector(performBatchUpdates:)]) {
+        [chooserView performBatchUpdates:updates];
+    } else {
+        // Let the block update the results data, and then reload everything
+        updates(nil);
+        [chooserView reloadData];
+    }
+}
+
 - (void)hideChooserView {
     __strong __auto_type delegate = self.delegate;
     [delegate accessoryViewStateWillChange:NO];
@@ -638,6 +691,10 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
     }
     _state = state;
     if (state == HKWMentionsCreationStateQuiescent) {
+        // Results for the mention being created are no longer needed
+        [self.dataProvider cancelAllRequests];
+        [self.customChooserViewRequestToken cancel];
+        self.customChooserViewRequestToken = nil;
         // Reset the buffer
         self.stringBuffer = [NSMutableString string];
         // Hide the chooser view
@@ -705,6 +762,8 @@ typedef NS_ENUM(NSInteger, HKWMentionsCreationAction) {
     self.state = HKWMentionsCreationStateQuiescent;
     __strong __auto_type delegate = self.delegate;
 
+    // Record the entity itself before the mention is created, so that the store keeps it rather than the mention
+    [[delegate recentEntitiesStore] recordEntity:entity];
     [delegate createMention:mention cursorLocation:self.startingLocation];
     [delegate selected:entity atIndexPath:indexPath];
 }
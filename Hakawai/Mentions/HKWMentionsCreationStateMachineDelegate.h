@@ -72,4 +72,40 @@
  */
 - (CGFloat)positionForChooserCursorRelativeToView:(UIView *)view atLocation:(NSUInteger)location;
 
+/*!
+ Return the policy to follow when making typeahead requests.
+ */
+- (id<HKWMentionsRateLimitPolicy>)rateLimitPolicy;
+
+/*!
+ Inform the delegate that a delay chosen by the rate limit policy was applied before or after a typeahead request.
+ */
+- (void)typeaheadRequestDelayedBy:(NSTimeInterval)delay forSearchType:(HKWMentionsSearchType)type;
+
+/*!
+ Return the cache of chooser cell heights.
+ */
+- (HKWMentionsCellHeightCache *)cellHeightCache;
+
+/*!
+ Return the store of recently mentioned entities, or nil if they aren't tracked.
+ */
+- (HKWMentionsRecentEntitiesStore *)recentEntitiesStore;
+
+/*!
+ Return the index of entities held on the device, or nil if there is none.
+ */
+- (HKWMentionsEntityIndex *)localEntityIndex;
+
+/*!
+ Return the sources of typeahead results to query in addition to the default chooser view delegate, or nil if there are
+ none.
+ */
+- (NSArray<id<HKWMentionsTypeaheadSource>> *)typeaheadSources;
+
+/*!
+ Return the typeahead service shared with other plug-ins, or nil if there is none.
+ */
+- (HKWMentionsTypeaheadService *)typeaheadService;
+
 @end
@@ -1,3 +1,5 @@
+#import "HKWMentionsCancellationToken.h"
+
 /*!
  This is being used for consumer of the library that wants to provide its own custom chooser view.
  The consumer is responsible for data processing, cool down logic and UI setup.
@@ -25,4 +27,15 @@
  */
 - (BOOL)entityCanBeTrimmed:(id<HKWMentionsEntityProtocol> _Null_unspecified)entity;
 
+/*!
+ If implemented, this method is called instead of \c didUpdateKeyString:controlCharacter:, and additionally receives a
+ cancellation token. The plug-in cancels the token once a newer key string is passed to the delegate or mention
+ creation ends, so that the delegate can stop fetching results for a query the user has moved on from.
+
+ \param cancellationToken    a token which is canceled once the results for the key string are no longer needed
+ */
+- (void)didUpdateKeyString:(nonnull NSString *)keyString
+          controlCharacter:(unichar)character
+         cancellationToken:(nonnull HKWMentionsCancellationToken *)cancellationToken;
+
 @end
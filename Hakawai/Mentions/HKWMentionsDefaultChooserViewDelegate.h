@@ -1,4 +1,5 @@
 #import "HKWMentionsEntityProtocol.h"
+#import "HKWMentionsCancellationToken.h"
 
 typedef NS_ENUM(NSInteger, HKWMentionsSearchType) {
     HKWMentionsSearchTypeImplicit,
@@ -27,7 +28,9 @@ typedef NS_ENUM(NSInteger, HKWMentionsSearchType) {
  locally stored results, and after a network request returns append additional results. As long as you have NOT called
  the block with 'YES', you may call the block repeatedly to append additional results to the end of the mentions list.
  If the search string changes or you have called the block previously with 'YES' to finalize the results, the mentions
- plug-in will silently ignore additional calls to the block.
+ plug-in will silently ignore additional calls to the block. Appended results are inserted into the chooser without
+ reloading the results already shown and, if 'dedupe' is YES, results already returned for the query are skipped. The
+ loading cell, if supported, is shown until the results are finalized.
 
  \warning The block must be called the first time with data in order to be allowed to append additional data. Returning
  an initial result set that is empty will cause the plug-in to treat the request as having been completed.
@@ -92,4 +95,18 @@ typedef NS_ENUM(NSInteger, HKWMentionsSearchType) {
  */
 - (CGFloat)heightForLoadingCellInTableView:(UITableView *_Null_unspecified)tableView;
 
+/*!
+ If implemented, this method is called instead of \c asyncRetrieveEntitiesForKeyString:searchType:controlCharacter:completion:
+ and behaves the same way, but additionally receives a cancellation token. The plug-in cancels the token once the
+ results of the request are no longer needed, because a newer query was made or mention creation ended; the delegate
+ should then stop any work for the request, and call the completion block with nil.
+
+ \param cancellationToken    a token which is canceled once the results of the request are no longer needed
+ */
+- (void)asyncRetrieveEntitiesForKeyString:(nonnull NSString *)keyString
+                               searchType:(HKWMentionsSearchType)type
+                         controlCharacter:(unichar)character
+                        cancellationToken:(nonnull HKWMentionsCancellationToken *)cancellationToken
+                               completion:(void(^_Null_unspecified)(NSArray *_Null_unspecified results, BOOL dedupe, BOOL isComplete))completionBlock;
+
 @end
@@ -0,0 +1,63 @@
+//
+//  HKWMentionsEntityIndex.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "HKWMentionsEntityProtocol.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ An in-memory index of mentions entities which answers prefix queries against the words of their names, ignoring case
+ and diacritics, without scanning every entity.
+
+ The words of each name are folded and kept in a single sorted array, so that the words beginning with a prefix are
+ found with a binary search. Entities are indexed on a background queue, and may be added in batches while the index is
+ already being queried; queries see the entities of all the batches indexed so far.
+
+ If the mentions plug-in has an index, the entities in it which match a query are shown as soon as the query is
+ requested, and the results of the default chooser view delegate, if there is one, are appended below them.
+ */
+@interface HKWMentionsEntityIndex : NSObject
+
+/*!
+ The number of entities indexed so far.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ The maximum number of entities returned for a query. Defaults to 20.
+ */
+@property (nonatomic) NSUInteger maximumResults;
+
+/*!
+ Index a batch of entities in the background, after any batches added before it. Entities are ranked in the order they
+ are added, so the most relevant ones should be added first.
+
+ \param completion    called on the main queue once the entities can be found by queries
+ */
+- (void)addEntities:(NSArray<id<HKWMentionsEntityProtocol>> *)entities completion:(nullable void (^)(void))completion;
+
+/*!
+ Return the indexed entities which match a query, in the order they were added. An entity matches if every word of the
+ query begins a word of its name, ignoring case and diacritics. An empty query matches all entities.
+ */
+- (NSArray<id<HKWMentionsEntityProtocol>> *)entitiesMatchingKeyString:(NSString *)keyString;
+
+/*!
+ Remove all entities from the index, including those of batches still being indexed.
+ */
+- (void)removeAllEntities;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,264 @@
+//
+//  HKWMentionsEntityIndex.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "HKWMentionsEntityIndex.h"
+
+#import "_HKWCharacterClassifier.h"
+
+/*!
+ An immutable state of the index. Queries read whichever snapshot is current, while batches are indexed into the next.
+ */
+@interface HKWMentionsEntityIndexSnapshot : NSObject
+
+/// The indexed entities, in the order they were added.
+@property (nonatomic, copy) NSArray<id<HKWMentionsEntityProtocol>> *entities;
+
+/// The folded words of each entity's name, parallel to \c entities.
+@property (nonatomic, copy) NSArray<NSArray<NSString *> *> *entityWords;
+
+/// The folded words of all names, sorted by UTF-16 code unit, so that the words beginning with a prefix are adjacent.
+@property (nonatomic, copy) NSArray<NSString *> *words;
+
+/// The index into \c entities of the entity each word of \c words belongs to, as \c NSUInteger values.
+@property (nonatomic, copy) NSData *wordEntityIndexes;
+
+@end
+
+@implementation HKWMentionsEntityIndexSnapshot
+@end
+
+@interface HKWMentionsEntityIndex ()
+
+@property (atomic, strong) HKWMentionsEntityIndexSnapshot *snapshot;
+
+/// Incremented whenever the index is emptied, so that batches begun before then are discarded.
+@property (nonatomic) NSUInteger generation;
+
+/// A serial queue on which batches are indexed, one after the other.
+@property (nonatomic, strong) dispatch_queue_t indexingQueue;
+
+@end
+
+@implementation HKWMentionsEntityIndex
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _snapshot = [[self class] emptySnapshot];
+        _maximumResults = 20;
+        _indexingQueue = dispatch_queue_create("com.linkedin.hakawai.mentions-entity-index", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark - API
+
+- (NSUInteger)count {
+    return [self.snapshot.entities count];
+}
+
+- (void)addEntities:(NSArray<id<HKWMentionsEntityProtocol>> *)entities completion:(void (^)(void))completion {
+    NSArray<id<HKWMentionsEntityProtocol>> *batch = [entities copy];
+    NSUInteger generation;
+    @synchronized (self) {
+        generation = self.generation;
+    }
+    dispatch_async(self.indexingQueue, ^{
+        HKWMentionsEntityIndexSnapshot *snapshot = [[self class] snapshotByAddingEntities:batch
+                                                                               toSnapshot:self.snapshot];
+        @synchronized (self) {
+            if (generation == self.generation) {
+                self.snapshot = snapshot;
+            }
+        }
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), completion);
+        }
+    });
+}
+
+- (NSArray<id<HKWMentionsEntityProtocol>> *)entitiesMatchingKeyString:(NSString *)keyString {
+    HKWMentionsEntityIndexSnapshot *snapshot = self.snapshot;
+    const NSUInteger maximumResults = self.maximumResults;
+    NSArray<NSString *> *queryWords = [[self class] foldedWordsInString:keyString];
+    if ([queryWords count] == 0) {
+        NSUInteger count = MIN([snapshot.entities count], maximumResults);
+        return [snapshot.entities subarrayWithRange:NSMakeRange(0, count)];
+    }
+    // Find the candidates through the first word of the query, and check the rest of the words against each of them
+    NSString *firstWord = queryWords[0];
+    NSArray<NSString *> *words = snapshot.words;
+    const NSUInteger *wordEntityIndexes = [snapshot.wordEntityIndexes bytes];
+    NSMutableIndexSet *matchingIndexes = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = [[self class] firstIndexOfWordNotBefore:firstWord inWords:words];
+         i < [words count] && [words[i] hasPrefix:firstWord];
+         i++) {
+        NSUInteger entityIndex = wordEntityIndexes[i];
+        if ([matchingIndexes containsIndex:entityIndex]) {
+            continue;
+        }
+        if ([queryWords count] == 1
+            || [[self class] words:snapshot.entityWords[entityIndex] matchQueryWords:queryWords]) {
+            [matchingIndexes addIndex:entityIndex];
+        }
+    }
+    // Rank the matches in the order the entities were added
+    NSMutableArray<id<HKWMentionsEntityProtocol>> *results = [NSMutableArray arrayWithCapacity:maximumResults];
+    [matchingIndexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [results addObject:snapshot.entities[idx]];
+        if ([results count] >= maximumResults) {
+            *stop = YES;
+        }
+    }];
+    return [results copy];
+}
+
+- (void)removeAllEntities {
+    @synchronized (self) {
+        self.generation += 1;
+        self.snapshot = [[self class] emptySnapshot];
+    }
+}
+
+#pragma mark - Private
+
++ (HKWMentionsEntityIndexSnapshot *)emptySnapshot {
+    HKWMentionsEntityIndexSnapshot *snapshot = [HKWMentionsEntityIndexSnapshot new];
+    snapshot.entities = @[];
+    snapshot.entityWords = @[];
+    snapshot.words = @[];
+    snapshot.wordEntityIndexes = [NSData data];
+    return snapshot;
+}
+
+/*!
+ Return a new snapshot with the entities of a batch added to those of \c snapshot. The words of the batch are sorted on
+ their own, and then merged with the already sorted words of the snapshot.
+ */
++ (HKWMentionsEntityIndexSnapshot *)snapshotByAddingEntities:(NSArray<id<HKWMentionsEntityProtocol>> *)batch
+                                                  toSnapshot:(HKWMentionsEntityIndexSnapshot *)snapshot {
+    const NSUInteger firstEntityIndex = [snapshot.entities count];
+    NSMutableArray<NSArray<NSString *> *> *batchEntityWords = [NSMutableArray arrayWithCapacity:[batch count]];
+    NSMutableArray<NSString *> *batchWords = [NSMutableArray array];
+    NSMutableData *batchWordEntityIndexes = [NSMutableData data];
+    for (NSUInteger i = 0; i < [batch count]; i++) {
+        NSArray<NSString *> *entityWords = [self foldedWordsInString:[batch[i] entityName]];
+        [batchEntityWords addObject:entityWords];
+        const NSUInteger entityIndex = firstEntityIndex + i;
+        for (NSString *word in entityWords) {
+            [batchWords addObject:word];
+            [batchWordEntityIndexes appendBytes:&entityIndex length:sizeof(NSUInteger)];
+        }
+    }
+    // Sort the positions of the batch's words, rather than the words, so that their entity indexes can follow them
+    const NSUInteger batchWordCount = [batchWords count];
+    NSMutableArray<NSNumber *> *order = [NSMutableArray arrayWithCapacity:batchWordCount];
+    for (NSUInteger i = 0; i < batchWordCount; i++) {
+        [order addObject:@(i)];
+    }
+    [order sortUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+        return [batchWords[[a unsignedIntegerValue]] compare:batchWords[[b unsignedIntegerValue]]
+                                                     options:NSLiteralSearch];
+    }];
+
+    NSArray<NSString *> *words = snapshot.words;
+    const NSUInteger *wordEntityIndexes = [snapshot.wordEntityIndexes bytes];
+    const NSUInteger *batchIndexes = [batchWordEntityIndexes bytes];
+    const NSUInteger wordCount = [words count];
+    NSMutableArray<NSString *> *mergedWords = [NSMutableArray arrayWithCapacity:wordCount + batchWordCount];
+    NSMutableData *mergedIndexes = [NSMutableData dataWithCapacity:(wordCount + batchWordCount) * sizeof(NSUInteger)];
+    NSUInteger i = 0;
+    NSUInteger j = 0;
+    while (i < wordCount || j < batchWordCount) {
+        const NSUInteger batchPosition = (j < batchWordCount) ? [order[j] unsignedIntegerValue] : 0;
+        const BOOL takesExistingWord = (j == batchWordCount
+                                        || (i < wordCount
+                                            && [words[i] compare:batchWords[batchPosition]
+                                                         options:NSLiteralSearch] != NSOrderedDescending));
+        if (takesExistingWord) {
+            [mergedWords addObject:words[i]];
+            [mergedIndexes appendBytes:&wordEntityIndexes[i] length:sizeof(NSUInteger)];
+            i++;
+        } else {
+            [mergedWords addObject:batchWords[batchPosition]];
+            [mergedIndexes appendBytes:&batchIndexes[batchPosition] length:sizeof(NSUInteger)];
+            j++;
+        }
+    }
+
+    HKWMentionsEntityIndexSnapshot *newSnapshot = [HKWMentionsEntityIndexSnapshot new];
+    newSnapshot.entities = [snapshot.entities arrayByAddingObjectsFromArray:batch];
+    newSnapshot.entityWords = [snapshot.entityWords arrayByAddingObjectsFromArray:batchEntityWords];
+    newSnapshot.words = mergedWords;
+    newSnapshot.wordEntityIndexes = mergedIndexes;
+    return newSnapshot;
+}
+
+/*!
+ Split a string into the words separated by whitespace and punctuation, folded to ignore case and diacritics.
+ */
++ (NSArray<NSString *> *)foldedWordsInString:(NSString *)string {
+    NSMutableArray<NSString *> *words = [NSMutableArray array];
+    HKWCharacterClassifier *classifier = [HKWCharacterClassifier sharedClassifier];
+    const NSUInteger length = [string length];
+    NSUInteger location = 0;
+    while (location < length) {
+        NSUInteger end = [classifier nextIndexOfCharacterInClass:HKWCharacterClassSeparator
+                                                        inString:string
+                                                       fromIndex:location];
+        if (end > location) {
+            NSString *word = [string substringWithRange:NSMakeRange(location, end - location)];
+            [words addObject:[word stringByFoldingWithOptions:(NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch)
+                                                       locale:nil]];
+        }
+        location = end + 1;
+    }
+    return [words copy];
+}
+
+/*!
+ Return the index of the first word which doesn't sort before \c word, or the number of words if there is none.
+ */
++ (NSUInteger)firstIndexOfWordNotBefore:(NSString *)word inWords:(NSArray<NSString *> *)words {
+    NSUInteger low = 0;
+    NSUInteger high = [words count];
+    while (low < high) {
+        const NSUInteger middle = low + (high - low) / 2;
+        if ([words[middle] compare:word options:NSLiteralSearch] == NSOrderedAscending) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*!
+ Return whether every word of a query begins one of the given words.
+ */
++ (BOOL)words:(NSArray<NSString *> *)words matchQueryWords:(NSArray<NSString *> *)queryWords {
+    for (NSString *queryWord in queryWords) {
+        BOOL found = NO;
+        for (NSString *word in words) {
+            if ([word hasPrefix:queryWord]) {
+                found = YES;
+                break;
+            }
+        }
+        if (!found) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+@end
@@ -0,0 +1,287 @@
+//
+//  HKWMentionsIntervalIndex.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "_HKWMentionsIntervalIndex.h"
+
+#import "HKWMentionsAttribute.h"
+#import "HKWMentionsPlugin.h"
+
+@interface HKWMentionsIntervalIndex ()
+
+@property (nonatomic, readwrite) BOOL isValid;
+
+/// A packed, ascending array of \c NSRange structs, one per span. See \c pendingShift.
+@property (nonatomic, strong) NSMutableData *spanRanges;
+/// The mention objects for each span, parallel to \c spanRanges.
+@property (nonatomic, strong) NSMutableArray<HKWMentionsAttribute *> *spanMentions;
+/// The length of the backing text the index was last synchronized with.
+@property (nonatomic) NSUInteger textLength;
+/*!
+ The amount by which the stored location of every span at or after \c pendingShiftIndex has yet to be shifted. Edits
+ only settle the shift for the spans between the previous edit and the current one, so consecutive edits near the same
+ place (such as typing) don't each have to walk every span which follows them.
+ */
+@property (nonatomic) NSInteger pendingShift;
+@property (nonatomic) NSUInteger pendingShiftIndex;
+
+@end
+
+@implementation HKWMentionsIntervalIndex
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) { return nil; }
+
+    self.spanRanges = [NSMutableData data];
+    self.spanMentions = [NSMutableArray array];
+    self.isValid = NO;
+
+    return self;
+}
+
+#pragma mark - API
+
+- (NSUInteger)count {
+    return [self.spanMentions count];
+}
+
+- (void)rebuildFromAttributedString:(NSAttributedString *)attributedString {
+    [self.spanRanges setLength:0];
+    [self.spanMentions removeAllObjects];
+    self.pendingShift = 0;
+    self.pendingShiftIndex = 0;
+    NSUInteger length = [attributedString length];
+    [self insertSpansFromAttributedString:attributedString inRange:NSMakeRange(0, length) atIndex:0];
+    self.textLength = length;
+    self.isValid = YES;
+}
+
+- (void)invalidate {
+    [self.spanRanges setLength:0];
+    [self.spanMentions removeAllObjects];
+    self.pendingShift = 0;
+    self.pendingShiftIndex = 0;
+    self.isValid = NO;
+}
+
+- (void)updateForEditedRange:(NSRange)editedRange
+              changeInLength:(NSInteger)delta
+          inAttributedString:(NSAttributedString *)attributedString {
+    if (!self.isValid) {
+        return;
+    }
+    NSUInteger length = [attributedString length];
+    NSInteger oldEditEnd = (NSInteger)NSMaxRange(editedRange) - delta;
+    if (editedRange.location == NSNotFound
+        || oldEditEnd < (NSInteger)editedRange.location
+        || (NSInteger)self.textLength + delta != (NSInteger)length
+        || NSMaxRange(editedRange) > length) {
+        // The edit doesn't line up with the text the index was built from. Start over.
+        [self rebuildFromAttributedString:attributedString];
+        return;
+    }
+
+    // Remove every span that intersects or touches the edited text, since the edit may have split, merged, or
+    //  destroyed them. Spans that merely touch the edit must be rescanned in case the edit extended them.
+    NSUInteger first = (editedRange.location == 0
+                        ? 0
+                        : [self indexOfFirstSpanEndingAfterLocation:editedRange.location - 1]);
+    NSUInteger last = [self indexOfFirstSpanStartingAfterLocation:(NSUInteger)oldEditEnd];
+    NSUInteger scanStart = editedRange.location;
+    NSInteger oldScanEnd = oldEditEnd;
+    [self movePendingShiftToIndex:first];
+    if (first < last) {
+        scanStart = MIN(scanStart, [self spanRangeAtIndex:first].location);
+        oldScanEnd = MAX(oldScanEnd, (NSInteger)NSMaxRange([self spanRangeAtIndex:last - 1]));
+        [self.spanRanges replaceBytesInRange:NSMakeRange(first * sizeof(NSRange), (last - first) * sizeof(NSRange))
+                                   withBytes:NULL
+                                      length:0];
+        [self.spanMentions removeObjectsInRange:NSMakeRange(first, last - first)];
+    }
+
+    // Every span that follows the edit now starts at 'first'; defer shifting them
+    self.pendingShift += delta;
+
+    // Rescan only the neighborhood of the edit. The new spans are stored unshifted, ahead of the pending shift.
+    NSUInteger scanEnd = MIN((NSUInteger)(oldScanEnd + delta), length);
+    if (scanEnd > scanStart) {
+        NSUInteger inserted = [self insertSpansFromAttributedString:attributedString
+                                                            inRange:NSMakeRange(scanStart, scanEnd - scanStart)
+                                                            atIndex:first];
+        self.pendingShiftIndex = first + inserted;
+    }
+    self.textLength = length;
+}
+
+- (HKWMentionsAttribute *)mentionAtLocation:(NSUInteger)location range:(NSRangePointer)range {
+    NSUInteger idx = [self indexOfFirstSpanEndingAfterLocation:location];
+    if (idx == [self.spanMentions count]) {
+        return nil;
+    }
+    NSRange spanRange = [self spanRangeAtIndex:idx];
+    if (spanRange.location > location) {
+        return nil;
+    }
+    if (range != NULL) {
+        *range = spanRange;
+    }
+    return self.spanMentions[idx];
+}
+
+- (void)enumerateMentionsIntersectingRange:(NSRange)range
+                                usingBlock:(void (^)(HKWMentionsAttribute *, NSRange, BOOL *))block {
+    if (!block || range.location == NSNotFound || range.length == 0) {
+        return;
+    }
+    NSUInteger count = [self.spanMentions count];
+    BOOL stop = NO;
+    for (NSUInteger i = [self indexOfFirstSpanEndingAfterLocation:range.location]; i < count && !stop; i++) {
+        NSRange spanRange = [self spanRangeAtIndex:i];
+        if (spanRange.location >= NSMaxRange(range)) {
+            break;
+        }
+        block(self.spanMentions[i], spanRange, &stop);
+    }
+}
+
+- (void)enumerateMentionsUsingBlock:(void (^)(HKWMentionsAttribute *, NSRange, BOOL *))block {
+    if (!block) {
+        return;
+    }
+    NSUInteger count = [self.spanMentions count];
+    BOOL stop = NO;
+    for (NSUInteger i = 0; i < count && !stop; i++) {
+        block(self.spanMentions[i], [self spanRangeAtIndex:i], &stop);
+    }
+}
+
+#pragma mark - Private
+
+/*!
+ Return the range of the span at the given index, with any pending shift applied.
+ */
+- (NSRange)spanRangeAtIndex:(NSUInteger)index {
+    NSRange range = ((const NSRange *)[self.spanRanges bytes])[index];
+    if (index >= self.pendingShiftIndex) {
+        range.location += (NSUInteger)self.pendingShift;
+    }
+    return range;
+}
+
+/*!
+ Move the boundary past which spans have yet to be shifted to the given index, settling the shift for the spans which
+ lie between the old boundary and the new one. Spans past the boundary are only ever read back with the pending shift
+ applied, so their stored locations are allowed to wrap around.
+ */
+- (void)movePendingShiftToIndex:(NSUInteger)index {
+    NSRange *ranges = (NSRange *)[self.spanRanges mutableBytes];
+    NSUInteger shift = (NSUInteger)self.pendingShift;
+    if (shift != 0) {
+        for (NSUInteger i = self.pendingShiftIndex; i < index; i++) {
+            ranges[i].location += shift;
+        }
+        for (NSUInteger i = index; i < self.pendingShiftIndex; i++) {
+            ranges[i].location -= shift;
+        }
+    }
+    self.pendingShiftIndex = index;
+}
+
+/*!
+ Return the index of the first span whose end lies strictly after the given location, or \c count if there is none.
+ Since spans are sorted and disjoint, their ends are sorted as well.
+ */
+- (NSUInteger)indexOfFirstSpanEndingAfterLocation:(NSUInteger)location {
+    NSUInteger low = 0;
+    NSUInteger high = [self.spanMentions count];
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (NSMaxRange([self spanRangeAtIndex:mid]) > location) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+/*!
+ Return the index of the first span which starts strictly after the given location, or \c count if there is none.
+ */
+- (NSUInteger)indexOfFirstSpanStartingAfterLocation:(NSUInteger)location {
+    NSUInteger low = 0;
+    NSUInteger high = [self.spanMentions count];
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if ([self spanRangeAtIndex:mid].location > location) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+/*!
+ Scan a portion of an attributed string for mention attributes and insert the resulting spans, in order, starting at
+ the given index. Touching runs with equal mention objects are coalesced into a single span. Return the number of spans
+ inserted.
+ */
+- (NSUInteger)insertSpansFromAttributedString:(NSAttributedString *)attributedString
+                                inRange:(NSRange)range
+                                atIndex:(NSUInteger)index {
+    if (range.length == 0) {
+        return 0;
+    }
+    NSMutableData *newRanges = [NSMutableData data];
+    NSMutableArray *newMentions = [NSMutableArray array];
+    __block NSRange pendingRange = NSMakeRange(NSNotFound, 0);
+    __block HKWMentionsAttribute *pendingMention = nil;
+    void (^flush)(void) = ^{
+        if (pendingMention) {
+            [newRanges appendBytes:&pendingRange length:sizeof(NSRange)];
+            [newMentions addObject:pendingMention];
+        }
+        pendingMention = nil;
+    };
+    [attributedString enumerateAttribute:HKWMentionAttributeName
+                                 inRange:range
+                                 options:0
+                              usingBlock:^(id value, NSRange runRange, __unused BOOL *stop) {
+                                  if (![value isKindOfClass:[HKWMentionsAttribute class]]) {
+                                      flush();
+                                      return;
+                                  }
+                                  if (pendingMention
+                                      && NSMaxRange(pendingRange) == runRange.location
+                                      && [pendingMention isEqual:value]) {
+                                      pendingRange.length += runRange.length;
+                                      return;
+                                  }
+                                  flush();
+                                  pendingMention = (HKWMentionsAttribute *)value;
+                                  pendingRange = runRange;
+                              }];
+    flush();
+
+    if ([newMentions count] == 0) {
+        return 0;
+    }
+    [self.spanRanges replaceBytesInRange:NSMakeRange(index * sizeof(NSRange), 0)
+                               withBytes:[newRanges bytes]
+                                  length:[newRanges length]];
+    [self.spanMentions insertObjects:newMentions
+                           atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(index, [newMentions count])]];
+    return [newMentions count];
+}
+
+@end
@@ -17,6 +17,12 @@
 #import "HKWChooserViewProtocol.h"
 #import "HKWMentionsDefaultChooserViewDelegate.h"
 #import "HKWMentionsCustomChooserViewDelegate.h"
+#import "HKWMentionsRateLimitPolicy.h"
+#import "HKWMentionsCellHeightCache.h"
+#import "HKWMentionsRecentEntitiesStore.h"
+#import "HKWMentionsEntityIndex.h"
+#import "HKWMentionsTypeaheadSource.h"
+#import "HKWMentionsTypeaheadService.h"
 
 static NSString* _Nonnull const HKWMentionAttributeName = @"HKWMentionAttributeName";
 
@@ -134,6 +140,26 @@ typedef NS_ENUM(NSInteger, HKWMentionsPluginState) {
         deletedMention:(id<HKWMentionsEntityProtocol> _Null_unspecified)entity
             atLocation:(NSUInteger)location;
 
+/*!
+ Inform the delegate that the specified mentions plug-in destroyed a number of mentions in a single operation as a
+ result of user input, for example because the user deleted a selection spanning them. This is sent once for the entire
+ operation rather than once per mention.
+
+ \param mentions    the destroyed mentions, in the order in which they appeared in the text
+ \param range       the range of text which was deleted, prior to the deletion
+ */
+- (void)mentionsPlugin:(id<HKWMentionsPlugin> _Null_unspecified)plugin
+       deletedMentions:(NSArray<id<HKWMentionsEntityProtocol>> *_Null_unspecified)mentions
+               inRange:(NSRange)range;
+
+/*!
+ Inform the delegate that the specified mentions plug-in applied a delay before or after a typeahead request, as chosen
+ by its rate limit policy. This is intended for instrumentation.
+ */
+- (void)mentionsPlugin:(id<HKWMentionsPlugin> _Null_unspecified)plugin
+    appliedTypeaheadDelay:(NSTimeInterval)delay
+            forSearchType:(HKWMentionsSearchType)type;
+
 /*!
  Inform the delegate an entity was selected as a result of user input.
  */
@@ -239,6 +265,57 @@ typedef NS_ENUM(NSInteger, HKWMentionsPluginState) {
  */
 @property (nonatomic) BOOL resumeMentionsCreationEnabled;
 
+/*!
+ The policy which spaces out the typeahead requests made to the default chooser view delegate while the user is typing.
+ Setting this to nil restores the default policy, which makes a request immediately and then at most one more request
+ every 0.1 seconds.
+ */
+@property (nonatomic, strong, null_resettable) id<HKWMentionsRateLimitPolicy> rateLimitPolicy;
+
+/*!
+ The heights of the chooser cells for mentions entities, as measured by the default chooser view delegate. Custom
+ chooser views can use the same cache to avoid measuring cells again.
+ */
+@property (nonatomic, strong, readonly, nonnull) HKWMentionsCellHeightCache *cellHeightCache;
+
+/*!
+ Whether or not to prepare the chooser view, and request the results for an explicit mention with an empty prefix,
+ before the user starts a mention: when the text view begins editing, and when the user types a control character.
+ The chooser then opens with the cached results rather than waiting for a request. Only takes effect for the default
+ chooser view delegate, and if \c HKWTextView.enableTypeaheadResultsCache is set. Defaults to NO.
+ */
+@property (nonatomic) BOOL prefetchesInitialResults;
+
+/*!
+ A store of the entities the user recently mentioned, or nil if they aren't tracked. If set, entities selected from the
+ chooser and mentions created through the plug-in are recorded in it. The stored entities which match a query are shown
+ as soon as the query is requested from the default chooser view delegate, and the results of the request are appended
+ below them, without those already shown. Defaults to nil.
+ */
+@property (nonatomic, strong, nullable) HKWMentionsRecentEntitiesStore *recentEntitiesStore;
+
+/*!
+ An index of entities held on the device, such as the user's connections, or nil if there is none. If set, the indexed
+ entities which match a query are shown as soon as the query is requested, after any recently mentioned entities, and
+ the results of the default chooser view delegate are appended below them. The index may be the only source of results
+ if there is no default chooser view delegate. Defaults to nil.
+ */
+@property (nonatomic, strong, nullable) HKWMentionsEntityIndex *localEntityIndex;
+
+/*!
+ Additional sources of typeahead results, which are queried in parallel with the default chooser view delegate. Their
+ results are merged with those of the default chooser view delegate as each of them answers; see
+ \c HKWMentionsTypeaheadSource. Results aren't prefetched while there are additional sources. Defaults to nil.
+ */
+@property (nonatomic, copy, nullable) NSArray<id<HKWMentionsTypeaheadSource>> *typeaheadSources;
+
+/*!
+ A typeahead service shared with other plug-ins, such as \c +[HKWMentionsTypeaheadService sharedService], or nil. If
+ set, queries the default chooser view delegate is already answering for another plug-in sharing the service aren't
+ requested again, and the typeahead cache is shared with those plug-ins. Defaults to nil.
+ */
+@property (nonatomic, strong, nullable) HKWMentionsTypeaheadService *typeaheadService;
+
 /*!
  Whether or not we should continue searching for an explicit mention after we get back empty results. If this
  is off, empty results will return the mentions creation state to \c HKWMentionsPluginStateQuiescent. If this is
@@ -22,6 +22,7 @@
 
 #import "HKWMentionsAttribute.h"
 
+#import "_HKWCharacterClassifier.h"
 #import "_HKWMentionsStartDetectionStateMachine.h"
 #import "_HKWMentionsCreationStateMachine.h"
 #import "_HKWMentionsCreationStateMachine.h"
@@ -65,6 +66,12 @@
 @property (nonatomic) BOOL nextInsertionShouldBeIgnored;
 
 @property (nonatomic, strong) HKWMentionsStartDetectionStateMachine *startDetectionStateMachine;
+
+/*!
+ A precompiled classifier for whitespace, punctuation and the members of \c controlCharacterSet. It is discarded
+ whenever the control character set is replaced, and lazily rebuilt the next time it is needed.
+ */
+@property (nonatomic, strong, null_resettable) HKWCharacterClassifier *characterClassifier;
 @property (nonatomic, strong) HKWMentionsCreationStateMachine *creationStateMachine;
 
 /*!
@@ -471,15 +478,11 @@
         return YES;
     }
 
-    NSCharacterSet *invalidChars = [NSCharacterSet whitespaceAndNewlineCharacterSet];
-    for (NSUInteger i=0; i<[string length]; i++) {
-        unichar c = [string characterAtIndex:i];
-        if ([invalidChars characterIsMember:c]) { return NO; }
-        if (self.controlCharacterSet && [self.controlCharacterSet characterIsMember:c]) {
-            return NO;
-        }
-    }
-    return YES;
+    const HKWCharacterClass invalidClasses = HKWCharacterClassWhitespace | HKWCharacterClassControl;
+    NSUInteger invalidCharLocation = [self.characterClassifier nextIndexOfCharacterInClass:invalidClasses
+                                                                                 inString:string
+                                                                                fromIndex:0];
+    return invalidCharLocation == [string length];
 }
 
 /*!
@@ -567,48 +570,74 @@
 
 /*!
  'Bleach' all mentions that fall within a certain range. This is used when multiple characters' worth of text must be
- deleted; mentions formatting is stripped if part or all of a mention is part of the excised text. This method returns
- the number of mentions that were bleached.
+ deleted; mentions formatting is stripped if part or all of a mention is part of the excised text. All of the affected
+ mentions are stripped in a single transformation of the text. This method returns the mentions that were bleached, in
+ the order they appeared in the text.
  */
-- (NSUInteger)bleachMentionsWithinRange:(NSRange)bleachRange {
-    if (bleachRange.location == NSNotFound || bleachRange.length == 0) {
-        return 0;
-    }
-    NSMutableArray *ranges = [NSMutableArray array];
+- (NSArray<HKWMentionsAttribute *> *)bleachMentionsWithinRange:(NSRange)bleachRange {
+    NSMutableArray<HKWMentionsAttribute *> *bleachedMentions = [NSMutableArray array];
     __strong __auto_type parentTextView = self.parentTextView;
-    [parentTextView.attributedText enumerateAttributesInRange:HKW_FULL_RANGE(parentTextView.attributedText)
-                                                      options:0
-                                                   usingBlock:^(NSDictionary *attrs, NSRange range, __unused BOOL *stop) {
-                                                       // Find all attributes in the string subsection.
-                                                       if (NSIntersectionRange(range, bleachRange).length == 0) {
-                                                           // We only care about attributes whose effective ranges
-                                                           //  lie within bleachRange
-                                                           return;
-                                                       }
-                                                       HKWMentionsAttribute *value = attrs[HKWMentionAttributeName];
-                                                       if (value) {
-                                                           [ranges addObject:[NSValue valueWithRange:range]];
-                                                       }
-                                                   }];
+    NSAttributedString *parentText = parentTextView.attributedText;
+    if (bleachRange.location == NSNotFound || bleachRange.length == 0 || NSMaxRange(bleachRange) > [parentText length]) {
+        return bleachedMentions;
+    }
+    // Mentions straddling either end of the range must be bleached in their entirety, so widen the range to cover them.
+    NSRange startMentionRange;
+    id startMention = [parentText attribute:HKWMentionAttributeName
+                                    atIndex:bleachRange.location
+                      longestEffectiveRange:&startMentionRange
+                                    inRange:HKW_FULL_RANGE(parentText)];
+    NSRange endMentionRange;
+    id endMention = [parentText attribute:HKWMentionAttributeName
+                                  atIndex:NSMaxRange(bleachRange) - 1
+                    longestEffectiveRange:&endMentionRange
+                                  inRange:HKW_FULL_RANGE(parentText)];
+    NSUInteger hullStart = startMention ? MIN(bleachRange.location, startMentionRange.location) : bleachRange.location;
+    NSUInteger hullEnd = endMention ? MAX(NSMaxRange(bleachRange), NSMaxRange(endMentionRange)) : NSMaxRange(bleachRange);
+    NSRange hullRange = NSMakeRange(hullStart, hullEnd - hullStart);
+
+    [parentText enumerateAttribute:HKWMentionAttributeName
+                           inRange:hullRange
+                           options:0
+                        usingBlock:^(id value, __unused NSRange range, __unused BOOL *stop) {
+                            if ([value isKindOfClass:[HKWMentionsAttribute class]]
+                                && ![[bleachedMentions lastObject] isEqual:value]) {
+                                [bleachedMentions addObject:(HKWMentionsAttribute *)value];
+                            }
+                        }];
+    if ([bleachedMentions count] == 0) {
+        return bleachedMentions;
+    }
+
     NSDictionary *selectedAttributes = self.mentionSelectedAttributes;
     NSDictionary *unselectedAttributes = self.mentionUnselectedAttributes;
-    for (NSValue *v in ranges) {
-        [parentTextView transformTextAtRange:[v rangeValue]
-                             withTransformer:^NSAttributedString *(NSAttributedString *input) {
-                                 NSMutableAttributedString *buffer = [input mutableCopy];
-                                 [buffer removeAttribute:HKWMentionAttributeName range:HKW_FULL_RANGE(input)];
-                                 // NOTE: We may need to add support for capturing and restoring any attributes
-                                 //  overwritten by applying the special mentions attributes in the future.
-                                 for (NSString *key in unselectedAttributes) {
-                                     [buffer removeAttribute:key range:HKW_FULL_RANGE(input)];
-                                 }
-                                 for (NSString *key in selectedAttributes) {
-                                     [buffer removeAttribute:key range:HKW_FULL_RANGE(input)];
-                                 }
-                                 return [buffer copy];
-                             }];
-    }
-    return [ranges count];
+    [parentTextView transformTextAtRange:hullRange
+                         withTransformer:^NSAttributedString *(NSAttributedString *input) {
+                             NSMutableAttributedString *buffer = [input mutableCopy];
+                             [buffer beginEditing];
+                             // Only the mention runs are stripped; plain text between mentions keeps its attributes.
+                             [input enumerateAttribute:HKWMentionAttributeName
+                                               inRange:HKW_FULL_RANGE(input)
+                                               options:0
+                                            usingBlock:^(id value, NSRange range, __unused BOOL *stop) {
+                                                if (!value) {
+                                                    return;
+                                                }
+                                                [buffer removeAttribute:HKWMentionAttributeName range:range];
+                                                // NOTE: We may need to add support for capturing and restoring any
+                                                //  attributes overwritten by applying the special mentions attributes
+                                                //  in the future.
+                                                for (NSString *key in unselectedAttributes) {
+                                                    [buffer removeAttribute:key range:range];
+                                                }
+                                                for (NSString *key in selectedAttributes) {
+                                                    [buffer removeAttribute:key range:range];
+                                                }
+                                            }];
+                             [buffer endEditing];
+                             return [buffer copy];
+                         }];
+    return bleachedMentions;
 }
 
 /*!
@@ -843,7 +872,7 @@
         case HKWMentionsStateQuiescent: {
             // Word following typed character would be used to trigger matching mentions menu when possible.
             NSString *wordFollowingTypedCharacter;
-            wordFollowingTypedCharacter = [HKWMentionsStartDetectionStateMachine wordAfterLocation:location text:parentTextView.text];
+            wordFollowingTypedCharacter = [HKWMentionsStartDetectionStateMachine wordAfterLocation:location text:parentTextView.textStorage.string];
             // Inform the start detection state machine that a character was inserted. Also, override the double space
             //  to period auto-substitution if the substitution would place a period right after a preceding mention.
             [self.startDetectionStateMachine characterTyped:newChar
@@ -933,7 +962,7 @@
             [self.startDetectionStateMachine deleteTypedCharacter:deletedChar
                                   withCharacterNowPrecedingCursor:precedingChar
                                                          location:location
-                                                     textViewText:parentTextView.text];
+                                                     textViewText:parentTextView.textStorage.string];
             self.nextSelectionChangeShouldBeIgnored = YES;
 
             // Look for a mention
@@ -955,22 +984,17 @@
                     if ([whitespaceSet characterIsMember:deletedChar] && ![whitespaceSet characterIsMember:precedingChar]) {
                         // Capture the previous word that the cursor has encountered. Start by grabbing the left side of
                         // the string starting from 0 to the deleted character's index
-                        NSString *leftString = [parentTextView.text substringToIndex:location];
-                        if ([leftString length] > 0) {
-                            NSInteger index = (NSInteger)[leftString length] - 1;
+                        NSString *text = parentTextView.textStorage.string;
+                        if (location > 0 && location <= [text length]) {
                             // Grab the start index of word to the left of the cursor by walking backwards through the string
                             // until a whitespace char is hit or the beginning of the string
-                            for (; index >= 0; index--) {
-                                unichar c = [leftString characterAtIndex:(NSUInteger)index];
-                                if ([whitespaceSet characterIsMember:c]) {
-                                    break;
-                                }
-                            }
-                            index++; // Advance the index to avoid capturing the space or -1 when hitting the lower bound
-
-                            // it is safe to convert the signed integer to unsigned at this point since it is now non-negative
-                            const NSUInteger stringIndex = (NSUInteger)index;
-                            NSString *adjacentWord = [leftString substringFromIndex:stringIndex];
+                            HKWCharacterClassifier *classifier = self.characterClassifier;
+                            NSUInteger whitespaceLocation = [classifier previousIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                                                                               inString:text
+                                                                                                  range:NSMakeRange(0, location)];
+                            // Advance past the space, if there was one
+                            const NSUInteger stringIndex = (whitespaceLocation == NSNotFound ? 0 : whitespaceLocation + 1);
+                            NSString *adjacentWord = [text substringWithRange:NSMakeRange(stringIndex, location - stringIndex)];
                             if ([adjacentWord length] > 0) {
                                 unichar firstChar = [adjacentWord characterAtIndex:0];
                                 BOOL usesControlChar = [self.controlCharacterSet characterIsMember:firstChar];
@@ -1243,7 +1267,7 @@
                                deletedString:(NSString *)deletedString
                           precedingCharacter:(unichar)precedingCharacter {
     // Remove all mentions within the selection range before continuing
-    NSUInteger numberOfMentionsDestroyed = [self bleachMentionsWithinRange:range];
+    NSArray<HKWMentionsAttribute *> *destroyedMentions = [self bleachMentionsWithinRange:range];
     switch (self.state) {
         case HKWMentionsStateQuiescent:
             [self.startDetectionStateMachine cursorMovedWithCharacterNowPrecedingCursor:precedingCharacter];
@@ -1270,10 +1294,16 @@
     __strong __auto_type parentTextView = self.parentTextView;
     __strong __auto_type externalDelegate = parentTextView.externalDelegate;
     if (self.notifyTextViewDelegateOnMentionDeletion
-        && numberOfMentionsDestroyed > 0
+        && [destroyedMentions count] > 0
         && [externalDelegate respondsToSelector:@selector(textViewDidChange:)]) {
         [externalDelegate textViewDidChange:parentTextView];
     }
+    // Report all of the destroyed mentions to the state change delegate at once
+    __strong __auto_type strongStateChangeDelegate = self.stateChangeDelegate;
+    if ([destroyedMentions count] > 0
+        && [strongStateChangeDelegate respondsToSelector:@selector(mentionsPlugin:deletedMentions:inRange:)]) {
+        [strongStateChangeDelegate mentionsPlugin:self deletedMentions:destroyedMentions inRange:range];
+    }
 
     return YES;
 }
@@ -1553,6 +1583,9 @@
 }
 
 - (void)textViewDidBeginEditing:(__unused UITextView *)textView {
+    if (self.prefetchesInitialResults) {
+        [self.creationStateMachine prefetchInitialResultsForControlCharacters:self.controlCharacterSet];
+    }
     // Bring the text view back to a known good state
     __strong __auto_type parentTextView = self.parentTextView;
     NSUInteger currentLength = [parentTextView.text length];
@@ -1701,6 +1734,12 @@
                                                        location:location];
 }
 
+- (void)controlCharacterTyped:(unichar)character {
+    if (self.prefetchesInitialResults) {
+        [self.creationStateMachine prefetchInitialResultsForControlCharacter:character];
+    }
+}
+
 #pragma mark - Mentions creation state machine protocol
 
 - (CGRect)boundsForParentEditorView {
@@ -1715,17 +1754,43 @@
                                searchType:(HKWMentionsSearchType)type
                          controlCharacter:(unichar)character
                                completion:(void (^)(NSArray *, BOOL, BOOL))completionBlock {
+    [self asyncRetrieveEntitiesForKeyString:keyString
+                                 searchType:type
+                           controlCharacter:character
+                          cancellationToken:[HKWMentionsCancellationToken new]
+                                 completion:completionBlock];
+}
+
+- (void)asyncRetrieveEntitiesForKeyString:(NSString *)keyString
+                               searchType:(HKWMentionsSearchType)type
+                         controlCharacter:(unichar)character
+                        cancellationToken:(HKWMentionsCancellationToken *)cancellationToken
+                               completion:(void (^)(NSArray *, BOOL, BOOL))completionBlock {
     // set up the chooser view prior to data request in order to support fully customized view
     [self.creationStateMachine setupChooserViewIfNeeded];
     __strong __auto_type strongCustomChooserViewDelegate = self.customChooserViewDelegate;
     if (strongCustomChooserViewDelegate) {
-        [strongCustomChooserViewDelegate didUpdateKeyString:keyString
-                                           controlCharacter:character];
-    } else {
-        [self.defaultChooserViewDelegate asyncRetrieveEntitiesForKeyString:keyString
-                                                                searchType:type
-                                                          controlCharacter:character
-                                                                completion:completionBlock];
+        [self notifyCustomChooserViewDelegate:strongCustomChooserViewDelegate
+                           ofUpdatedKeyString:keyString
+                             controlCharacter:character
+                            cancellationToken:cancellationToken];
+        return;
+    }
+    __strong __auto_type strongDefaultChooserViewDelegate = self.defaultChooserViewDelegate;
+    if ([strongDefaultChooserViewDelegate respondsToSelector:@selector(asyncRetrieveEntitiesForKeyString:searchType:controlCharacter:cancellationToken:completion:)]) {
+        [strongDefaultChooserViewDelegate asyncRetrieveEntitiesForKeyString:keyString
+                                                                 searchType:type
+                                                           controlCharacter:character
+                                                          cancellationToken:cancellationToken
+                                                                 completion:completionBlock];
+    } else if (strongDefaultChooserViewDelegate) {
+        [strongDefaultChooserViewDelegate asyncRetrieveEntitiesForKeyString:keyString
+                                                                 searchType:type
+                                                           controlCharacter:character
+                                                                 completion:completionBlock];
+    } else if (self.localEntityIndex || [self.typeaheadSources count] > 0) {
+        // The local entity index and the additional typeahead sources are the only sources of results
+        completionBlock(@[], YES, YES);
     }
 }
 
@@ -1799,6 +1864,7 @@
     if (self.state != HKWMentionsStartDetectionStateCreatingMention || !mention) {
         return;
     }
+    [self.recentEntitiesStore recordMention:mention];
     // If you create a mention, you MUST do something before the next mention can be created.
     [self performMentionCreationEndCleanup:NO];
 
@@ -1817,7 +1883,7 @@
     // When control character is inserted before word and user selects mention for that word,
     // we want to replace word after control character with mention text.
     // e.g "hey @|john" will be replaced as "hey John Doe". '|' indicates cursor.
-    NSString *const wordAfterCurrentLocation = [HKWMentionsStartDetectionStateMachine wordAfterLocation:currentLocation text:parentTextView.text];
+    NSString *const wordAfterCurrentLocation = [HKWMentionsStartDetectionStateMachine wordAfterLocation:currentLocation text:parentTextView.textStorage.string];
     rangeToTransform = NSMakeRange(location, currentLocation + wordAfterCurrentLocation.length - location);
 
     /*
@@ -2072,6 +2138,13 @@
     return correctedPoint.x + rect.size.width/2;
 }
 
+- (void)typeaheadRequestDelayedBy:(NSTimeInterval)delay forSearchType:(HKWMentionsSearchType)type {
+    __strong __auto_type strongStateChangeDelegate = self.stateChangeDelegate;
+    if ([strongStateChangeDelegate respondsToSelector:@selector(mentionsPlugin:appliedTypeaheadDelay:forSearchType:)]) {
+        [strongStateChangeDelegate mentionsPlugin:self appliedTypeaheadDelay:delay forSearchType:type];
+    }
+}
+
 #pragma mark - Properties
 
 - (void)setState:(HKWMentionsState)state {
@@ -2204,12 +2277,40 @@
 
 - (void)didUpdateKeyString:(nonnull NSString *)keyString
           controlCharacter:(unichar)character {
+    [self didUpdateKeyString:keyString
+            controlCharacter:character
+           cancellationToken:[HKWMentionsCancellationToken new]];
+}
+
+- (void)didUpdateKeyString:(nonnull NSString *)keyString
+          controlCharacter:(unichar)character
+         cancellationToken:(nonnull HKWMentionsCancellationToken *)cancellationToken {
     // set up the chooser view prior to data request in order to support fully customized view
     [self.creationStateMachine setupChooserViewIfNeeded];
     __strong __auto_type strongCustomChooserViewDelegate = self.customChooserViewDelegate;
     NSAssert(strongCustomChooserViewDelegate != nil, @"Must have a custom chooser view if the query is being updated directly via this method");
-    [strongCustomChooserViewDelegate didUpdateKeyString:keyString
-                                       controlCharacter:character];
+    [self notifyCustomChooserViewDelegate:strongCustomChooserViewDelegate
+                       ofUpdatedKeyString:keyString
+                         controlCharacter:character
+                        cancellationToken:cancellationToken];
+}
+
+/*!
+ Pass an updated key string to a custom chooser view delegate, along with its cancellation token if the delegate
+ supports it.
+ */
+- (void)notifyCustomChooserViewDelegate:(id<HKWMentionsCustomChooserViewDelegate>)customChooserViewDelegate
+                     ofUpdatedKeyString:(NSString *)keyString
+                       controlCharacter:(unichar)character
+                      cancellationToken:(HKWMentionsCancellationToken *)cancellationToken {
+    if ([customChooserViewDelegate respondsToSelector:@selector(didUpdateKeyString:controlCharacter:cancellationToken:)]) {
+        [customChooserViewDelegate didUpdateKeyString:keyString
+                                     controlCharacter:character
+                                    cancellationToken:cancellationToken];
+    } else {
+        [customChooserViewDelegate didUpdateKeyString:keyString
+                                     controlCharacter:character];
+    }
 }
 
 #pragma mark - Developer
@@ -2231,6 +2332,21 @@ NSString * _Nonnull nameForMentionsState(HKWMentionsState s) {
 
 @synthesize controlCharacterSet;
 
+- (void)setControlCharacterSet:(NSCharacterSet *)characterSet {
+    if (controlCharacterSet == characterSet) {
+        return;
+    }
+    controlCharacterSet = characterSet;
+    self.characterClassifier = nil;
+}
+
+- (HKWCharacterClassifier *)characterClassifier {
+    if (!_characterClassifier) {
+        _characterClassifier = [HKWCharacterClassifier classifierWithControlCharacterSet:self.controlCharacterSet];
+    }
+    return _characterClassifier;
+}
+
 @synthesize defaultChooserViewDelegate;
 
 @synthesize customChooserViewDelegate;
@@ -2253,6 +2369,31 @@ NSString * _Nonnull nameForMentionsState(HKWMentionsState s) {
 
 @synthesize stateChangeDelegate;
 
+@synthesize rateLimitPolicy;
+
+@synthesize prefetchesInitialResults;
+
+@synthesize recentEntitiesStore;
+@synthesize localEntityIndex;
+@synthesize typeaheadSources;
+@synthesize typeaheadService;
+
+- (id<HKWMentionsRateLimitPolicy>)rateLimitPolicy {
+    if (!rateLimitPolicy) {
+        rateLimitPolicy = [HKWMentionsDefaultRateLimitPolicy defaultPolicy];
+    }
+    return rateLimitPolicy;
+}
+
+@synthesize cellHeightCache;
+
+- (HKWMentionsCellHeightCache *)cellHeightCache {
+    if (!cellHeightCache) {
+        cellHeightCache = [HKWMentionsCellHeightCache new];
+    }
+    return cellHeightCache;
+}
+
 @synthesize shouldEnableEnhancedMentionReplacementRules;
 
 @end
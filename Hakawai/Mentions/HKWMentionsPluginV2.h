@@ -10,8 +10,43 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/*!
+ The reasons for which a mention passed to \c addMentions:rejectedMentions: may be rejected.
+ */
+typedef NS_ENUM(NSInteger, HKWMentionsRejectionReason) {
+    /// The object is not an \c HKWMentionsAttribute
+    HKWMentionsRejectionReasonInvalidObject = 0,
+    /// The mention's range is \c NSNotFound, empty, or extends past the end of the text
+    HKWMentionsRejectionReasonInvalidRange,
+    /// The text within the mention's range doesn't match the mention's \c mentionText
+    HKWMentionsRejectionReasonTextMismatch,
+    /// The mention's range overlaps the range of another mention in the same call that was accepted
+    HKWMentionsRejectionReasonOverlap
+};
+
 @interface HKWMentionsPluginV2 : NSObject <HKWMentionsPlugin>
 
+/*!
+ Add multiple mentions to the parent text view's text in a single edit. The mentions are sorted by location and
+ validated in one pass, and all of the accepted mentions (and any existing mentions they displace) are applied to the
+ text together.
+
+ Overlaps are resolved deterministically: the mention which starts first is kept, and if two mentions start at the same
+ location the one which appears first in \c mentions is kept. Mentions which are rejected for any other reason never
+ cause another mention to be rejected, and don't bleach the existing mentions they overlap.
+
+ \note This behaves differently from \c addMentions:, which adds each mention in turn through \c addMention:. There, a
+ later mention which overlaps an earlier one replaces it, and a mention whose text doesn't match still bleaches the
+ existing mentions it overlaps.
+
+ \param mentions            an array of \c HKWMentionsAttribute objects, each with its \c range property set
+ \param rejectedMentions    an optional pointer which will be populated with a dictionary mapping the index within
+                            \c mentions of each rejected object to an \c NSNumber holding its
+                            \c HKWMentionsRejectionReason; the dictionary is empty if every mention was added
+ */
+- (void)addMentions:(NSArray *)mentions
+   rejectedMentions:(NSDictionary<NSNumber *, NSNumber *> *_Nullable __autoreleasing *_Nullable)rejectedMentions;
+
 /*!
  Instantiate a mentions plug-in with the specified chooser mode, no control characters, and a default search length of
  3 characters.
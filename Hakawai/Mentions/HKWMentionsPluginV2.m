@@ -21,9 +21,12 @@
 #import "HKWTextView+Plugins.h"
 
 #import "HKWMentionsAttribute.h"
+#import "_HKWLayoutManager.h"
+#import "_HKWCharacterClassifier.h"
 
 #import "_HKWMentionsCreationStateMachine.h"
 #import "_HKWMentionsCreationStateMachine.h"
+#import "_HKWMentionsIntervalIndex.h"
 
 #import "_HKWMentionsPrivateConstants.h"
 
@@ -36,6 +39,12 @@
 
 @property (nonatomic, strong, nullable) NSCharacterSet *controlCharactersToPrepend;
 
+/*!
+ A precompiled classifier for whitespace, punctuation and the members of \c controlCharacterSet. It is discarded
+ whenever the control character set is replaced, and lazily rebuilt the next time it is needed.
+ */
+@property (nonatomic, strong, null_resettable) HKWCharacterClassifier *characterClassifier;
+
 @property (nonatomic, readwrite) HKWMentionsChooserPositionMode chooserPositionMode;
 
 @property (nonatomic, readonly) BOOL viewportLocksToTopUponMentionCreation;
@@ -49,6 +58,23 @@
  */
 @property (nonatomic) NSRange currentlyHighlightedMentionRange;
 
+/**
+ A sorted index of the mention spans in the parent text view's text storage. It is kept up to date as the text storage
+ processes edits, so that mention lookups don't need to scan the entire document.
+ */
+@property (nonatomic, strong) HKWMentionsIntervalIndex *mentionsIndex;
+
+/**
+ The text storage whose edits are currently being observed in order to maintain \c mentionsIndex.
+ */
+@property (nonatomic, weak) NSTextStorage *observedTextStorage;
+
+/**
+ The part of the observed text storage's pending \c changeInLength which \c mentionsIndex already reflects, because the
+ index was queried, and brought up to date, while the text storage was in the middle of a batch of edits.
+ */
+@property (nonatomic) NSInteger mentionsIndexBatchChangeInLength;
+
 @end
 
 @implementation HKWMentionsPluginV2
@@ -189,36 +215,24 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     self.notifyTextViewDelegateOnMentionCreation = NO;
     self.notifyTextViewDelegateOnMentionTrim = NO;
     self.notifyTextViewDelegateOnMentionDeletion = NO;
+    self.mentionsIndex = [HKWMentionsIntervalIndex new];
 
     return self;
 }
 
+- (void)dealloc {
+    [self stopObservingTextStorage];
+}
+
 // Return an array of mentions objects corresponding to the mentions currently in the text view.
 - (NSArray *)mentions {
     NSMutableArray *buffer = [NSMutableArray array];
-    __block HKWMentionsAttribute *previousMention;
-
-    __strong __auto_type parentTextView = self.parentTextView;
-    [parentTextView.attributedText enumerateAttributesInRange:HKW_FULL_RANGE(parentTextView.attributedText)
-                                                      options:0 usingBlock:^(NSDictionary *attrs, NSRange range, __unused BOOL *stop) {
-                                                          id mentionObject = attrs[HKWMentionAttributeName];
-                                                          if (![mentionObject isKindOfClass:[HKWMentionsAttribute class]]) {
-                                                              return;
-                                                          }
-
-                                                          HKWMentionsAttribute *attr = [mentionObject copy];
-                                                          // If two attribute dicts have same mention object and the ranges are touching
-                                                          // they are the same mention and should be combined
-                                                          BOOL isGap = ((previousMention.range.location + previousMention.range.length) < range.location);
-                                                          if ([previousMention isEqual:attr] && !isGap) {
-                                                              previousMention.range = NSMakeRange(previousMention.range.location, previousMention.range.length + range.length);
-                                                          } else {
-                                                              attr.range = range;
-                                                              [buffer addObject:attr];
-                                                              previousMention = attr;
-                                                          }
-                                                      }];
-
+    // Touching runs with equal mention objects are already combined into a single span by the index
+    [[self validMentionsIndex] enumerateMentionsUsingBlock:^(HKWMentionsAttribute *mention, NSRange range, __unused BOOL *stop) {
+        HKWMentionsAttribute *attr = [mention copy];
+        attr.range = range;
+        [buffer addObject:attr];
+    }];
     return [buffer copy];
 }
 
@@ -246,17 +260,7 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
             // In order to perform the transformation, the plaintext must be the same as the mention text
             return input;
         }
-        NSMutableAttributedString *buffer = [input mutableCopy];
-        [buffer addAttribute:HKWMentionAttributeName value:mention range:HKW_FULL_RANGE(input)];
-        for (NSString *attributeName in mentionAttributes) {
-            id const attributeValue = mentionAttributes[attributeName];
-            if (!attributeValue) {
-                NSAssert(NO, @"Internal error");
-                continue;
-            }
-            [buffer addAttribute:attributeName value:attributeValue range:HKW_FULL_RANGE(input)];
-        }
-        return buffer;
+        return [HKWMentionsPluginV2 attributedString:input byApplyingMention:mention attributes:mentionAttributes];
     }];
     parentTextView.selectedRange = originalRange;
     [self stripCustomAttributesFromTypingAttributes];
@@ -271,6 +275,92 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     }
 }
 
+- (void)addMentions:(NSArray *)mentions
+   rejectedMentions:(NSDictionary<NSNumber *, NSNumber *> * __autoreleasing *)rejectedMentions {
+    NSMutableDictionary<NSNumber *, NSNumber *> *rejections = [NSMutableDictionary dictionary];
+    __strong __auto_type parentTextView = self.parentTextView;
+    NSString *text = parentTextView.textStorage.string ?: @"";
+    NSUInteger textLength = [text length];
+
+    // Sort the candidates by location. Ties are broken by the order in which they were passed in, so that overlaps are
+    //  always resolved the same way.
+    NSMutableArray<NSNumber *> *candidateIndices = [NSMutableArray arrayWithCapacity:[mentions count]];
+    [mentions enumerateObjectsUsingBlock:^(id object, NSUInteger idx, __unused BOOL *stop) {
+        if (![object isKindOfClass:[HKWMentionsAttribute class]]) {
+            rejections[@(idx)] = @(HKWMentionsRejectionReasonInvalidObject);
+            return;
+        }
+        NSRange range = ((HKWMentionsAttribute *)object).range;
+        if (range.location == NSNotFound || range.length == 0 || NSMaxRange(range) > textLength) {
+            rejections[@(idx)] = @(HKWMentionsRejectionReasonInvalidRange);
+            return;
+        }
+        [candidateIndices addObject:@(idx)];
+    }];
+    [candidateIndices sortUsingComparator:^NSComparisonResult(NSNumber *first, NSNumber *second) {
+        NSUInteger firstLocation = ((HKWMentionsAttribute *)mentions[[first unsignedIntegerValue]]).range.location;
+        NSUInteger secondLocation = ((HKWMentionsAttribute *)mentions[[second unsignedIntegerValue]]).range.location;
+        if (firstLocation != secondLocation) {
+            return firstLocation < secondLocation ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return [first compare:second];
+    }];
+
+    // Sweep through the sorted candidates, validating each one's text and rejecting any that overlap the previously
+    //  accepted mention. Existing mentions intersecting an accepted mention are collected so they can be bleached.
+    HKWMentionsIntervalIndex *existingMentions = [self validMentionsIndex];
+    NSMutableArray<HKWMentionsAttribute *> *acceptedMentions = [NSMutableArray array];
+    NSMutableArray<NSValue *> *rangesToBleach = [NSMutableArray array];
+    __block NSUInteger bleachedEnd = 0;
+    NSUInteger acceptedEnd = 0;
+    for (NSNumber *idx in candidateIndices) {
+        HKWMentionsAttribute *mention = mentions[[idx unsignedIntegerValue]];
+        NSRange range = mention.range;
+        if ([text compare:mention.mentionText ?: @"" options:NSLiteralSearch range:range] != NSOrderedSame) {
+            rejections[idx] = @(HKWMentionsRejectionReasonTextMismatch);
+            continue;
+        }
+        if ([acceptedMentions count] > 0 && range.location < acceptedEnd) {
+            rejections[idx] = @(HKWMentionsRejectionReasonOverlap);
+            continue;
+        }
+        [acceptedMentions addObject:mention];
+        acceptedEnd = NSMaxRange(range);
+        [existingMentions enumerateMentionsIntersectingRange:range
+                                       usingBlock:^(__unused HKWMentionsAttribute *existing, NSRange existingRange, __unused BOOL *stop) {
+                                           // Consecutive mentions may intersect the same existing mention
+                                           if ([rangesToBleach count] > 0 && existingRange.location < bleachedEnd) {
+                                               return;
+                                           }
+                                           [rangesToBleach addObject:[NSValue valueWithRange:existingRange]];
+                                           bleachedEnd = NSMaxRange(existingRange);
+                                       }];
+    }
+
+    if (rejectedMentions != NULL) {
+        *rejectedMentions = [rejections copy];
+    }
+    if ([acceptedMentions count] == 0) {
+        return;
+    }
+
+    [self.creationStateMachine cancelMentionCreation];
+    NSRange originalRange = NSMakeRange(parentTextView.selectedRange.location, 0);
+    NSDictionary *mentionAttributes = self.mentionUnhighlightedAttributes;
+    // Mentions cannot overlap, so existing mentions that intrude upon the new mentions are bleached before the new
+    //  mentions are applied. None of these changes alter the length of the text, so the ranges remain valid throughout.
+    [parentTextView performBatchTransformations:^{
+        [self stripMentionAttributesAtRanges:rangesToBleach];
+        for (HKWMentionsAttribute *mention in acceptedMentions) {
+            [parentTextView transformTextAtRange:mention.range withTransformer:^NSAttributedString *(NSAttributedString *input) {
+                return [HKWMentionsPluginV2 attributedString:input byApplyingMention:mention attributes:mentionAttributes];
+            }];
+        }
+    }];
+    parentTextView.selectedRange = originalRange;
+    [self stripCustomAttributesFromTypingAttributes];
+}
+
 - (void)performInitialSetup {
     __strong __auto_type parentTextView = self.parentTextView;
     NSAssert(parentTextView != nil, @"Internal error: parent text view is nil; it should have been set already");
@@ -290,6 +380,12 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 
     // Restore the parent text view's spell checking
     [parentTextView restoreOriginalSpellChecking:NO];
+
+    // Remove any highlight drawn on behalf of the plug-in by the layout manager
+    [[self highlightingLayoutManager] setHighlightedCharacterRange:NSMakeRange(NSNotFound, 0) attributes:nil];
+
+    // The index can't be kept up to date once the plug-in is detached
+    [self stopObservingTextStorage];
 }
 
 #pragma mark - Utility
@@ -323,19 +419,37 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     return [buffer copy];
 }
 
-+ (nullable NSString *)wordAfterLocation:(NSUInteger)location text:(nonnull NSString *)text {
-    NSMutableString *const word = [[NSMutableString alloc] init];
-    for(NSUInteger i = location; i < text.length ; i++) {
-        const unichar character = [text characterAtIndex:i];
-        if ([[NSCharacterSet whitespaceAndNewlineCharacterSet] characterIsMember:character]) {
-            break;
+/*!
+ Return a copy of an attributed string with the given mention, and the attributes used to format it, applied to the
+ entire string.
+ */
++ (NSAttributedString *)attributedString:(NSAttributedString *)input
+                       byApplyingMention:(HKWMentionsAttribute *)mention
+                              attributes:(NSDictionary *)mentionAttributes {
+    NSMutableAttributedString *buffer = [input mutableCopy];
+    [buffer addAttribute:HKWMentionAttributeName value:mention range:HKW_FULL_RANGE(input)];
+    for (NSString *attributeName in mentionAttributes) {
+        id const attributeValue = mentionAttributes[attributeName];
+        if (!attributeValue) {
+            NSAssert(NO, @"Internal error");
+            continue;
         }
-        [word appendString:[NSString stringWithCharacters:&character length:1]];
+        [buffer addAttribute:attributeName value:attributeValue range:HKW_FULL_RANGE(input)];
     }
-    if (word.length == 0) {
+    return buffer;
+}
+
++ (nullable NSString *)wordAfterLocation:(NSUInteger)location text:(nonnull NSString *)text {
+    if (location >= [text length]) {
         return nil;
     }
-    return [word copy];
+    NSUInteger end = [[HKWCharacterClassifier sharedClassifier] nextIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                                                                   inString:text
+                                                                                  fromIndex:location];
+    if (end == location) {
+        return nil;
+    }
+    return [text substringWithRange:NSMakeRange(location, end - location)];
 }
 
 #pragma mark - UI
@@ -389,15 +503,11 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
         return YES;
     }
 
-    NSCharacterSet *invalidChars = [NSCharacterSet whitespaceAndNewlineCharacterSet];
-    for (NSUInteger i=0; i<[string length]; i++) {
-        unichar c = [string characterAtIndex:i];
-        if ([invalidChars characterIsMember:c]) { return NO; }
-        if (self.controlCharacterSet && [self.controlCharacterSet characterIsMember:c]) {
-            return NO;
-        }
-    }
-    return YES;
+    const HKWCharacterClass invalidClasses = HKWCharacterClassWhitespace | HKWCharacterClassControl;
+    NSUInteger invalidCharLocation = [self.characterClassifier nextIndexOfCharacterInClass:invalidClasses
+                                                                                 inString:string
+                                                                                fromIndex:0];
+    return invalidCharLocation == [string length];
 }
 
 - (NSDictionary *)defaultTextAttributes {
@@ -440,9 +550,23 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 /*!
  Toggle mentions-related formatting for a given portion of text. Mentions can either be 'highlighted' (annotation
  background, light text color), or 'unhighlighted' (no background, dark text color)
+
+ If rendering-only highlighting is enabled, the highlighted state is drawn by the parent text view's layout manager as
+ an overlay and the text storage is left untouched. Only highlighted attributes which don't affect layout are drawn.
  */
 - (void)toggleMentionsFormattingIfNeededAtRange:(NSRange)range
                                     highlighted:(BOOL)highlighted {
+    HKWLayoutManager *layoutManager = [self highlightingLayoutManager];
+    if (layoutManager) {
+        if (!highlighted) {
+            // There is only one highlight, and the layout manager moves it along with the text as the text before it is
+            //  edited, so it may no longer be at the range the plug-in last highlighted
+            [layoutManager setHighlightedCharacterRange:NSMakeRange(NSNotFound, 0) attributes:nil];
+        } else if (range.location != NSNotFound && range.length > 0) {
+            [layoutManager setHighlightedCharacterRange:range attributes:self.mentionHighlightedAttributes];
+        }
+        return;
+    }
     if (range.location == NSNotFound || range.length == 0) {
         return;
     }
@@ -494,39 +618,46 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     parentTextView.selectedRange = previousSelectedRange;
 }
 
+/*!
+ Return the parent text view's layout manager if mention highlighting should be drawn as a rendering overlay rather
+ than applied to the text storage, or nil otherwise.
+ */
+- (HKWLayoutManager *)highlightingLayoutManager {
+    if (!HKWTextView.enableRenderingOnlyMentionHighlighting) {
+        return nil;
+    }
+    __strong __auto_type parentTextView = self.parentTextView;
+    NSLayoutManager *layoutManager = parentTextView.layoutManager;
+    return [layoutManager isKindOfClass:[HKWLayoutManager class]] ? (HKWLayoutManager *)layoutManager : nil;
+}
+
 /*!
  'Bleach' all mentions that fall within a certain range. This is used when multiple characters' worth of text must be
- deleted; mentions formatting is stripped if part or all of a mention is part of the excised text. This method returns
- the number of mentions that were bleached.
+ deleted; mentions formatting is stripped if part or all of a mention is part of the excised text. All of the affected
+ mentions are stripped in a single transformation of the text. This method returns the mentions that were bleached, in
+ the order they appeared in the text.
  */
-- (NSUInteger)bleachMentionsWithinRange:(NSRange)bleachRange {
+- (NSArray<HKWMentionsAttribute *> *)bleachMentionsWithinRange:(NSRange)bleachRange {
+    NSMutableArray<HKWMentionsAttribute *> *bleachedMentions = [NSMutableArray array];
     if (bleachRange.location == NSNotFound || bleachRange.length == 0) {
-        return 0;
+        return bleachedMentions;
     }
-    NSMutableArray *ranges = [NSMutableArray array];
+    NSMutableArray<NSValue *> *ranges = [NSMutableArray array];
     __strong __auto_type parentTextView = self.parentTextView;
     // Save cursor selection range before bleaching, so we can restore it afterwards, because transformTextAtRange reset it
     NSRange previousSelectedRange = parentTextView.selectedRange;
-    [parentTextView.attributedText enumerateAttributesInRange:HKW_FULL_RANGE(parentTextView.attributedText)
-                                                      options:0
-                                                   usingBlock:^(NSDictionary *attrs, NSRange range, __unused BOOL *stop) {
-                                                       // Find all attributes in the string subsection.
-                                                       if (NSIntersectionRange(range, bleachRange).length == 0) {
-                                                           // We only care about attributes whose effective ranges
-                                                           //  lie within bleachRange
-                                                           return;
-                                                       }
-                                                       HKWMentionsAttribute *value = attrs[HKWMentionAttributeName];
-                                                       if (value) {
+    [[self validMentionsIndex] enumerateMentionsIntersectingRange:bleachRange
+                                                       usingBlock:^(HKWMentionsAttribute *mention, NSRange range, __unused BOOL *stop) {
+                                                           [bleachedMentions addObject:mention];
                                                            [ranges addObject:[NSValue valueWithRange:range]];
-                                                       }
-                                                   }];
-    for (NSValue *v in ranges) {
-        [self stripMentionAttributesAtRange:[v rangeValue]];
+                                                       }];
+    if ([ranges count] == 0) {
+        return bleachedMentions;
     }
+    [self stripMentionAttributesAtRanges:ranges];
     // Restore previously selected cursor range
     parentTextView.selectedRange = previousSelectedRange;
-    return [ranges count];
+    return bleachedMentions;
 }
 
 /*!
@@ -562,25 +693,46 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 }
 
 - (void)stripMentionAttributesAtRange:(NSRange)range {
+    [self stripMentionAttributesAtRanges:@[[NSValue valueWithRange:range]]];
+}
+
+/*!
+ Remove the mention attribute and all mentions-specific formatting from each of the given ranges, which must be sorted
+ and must not overlap. The text spanning all of the ranges is transformed once, and text lying between the ranges keeps
+ its attributes.
+ */
+- (void)stripMentionAttributesAtRanges:(NSArray<NSValue *> *)ranges {
+    if ([ranges count] == 0) {
+        return;
+    }
     __strong __auto_type parentTextView = self.parentTextView;
     NSDictionary *unhighlightedAttributes = self.mentionUnhighlightedAttributes;
     NSDictionary *highlightedAttributes = self.mentionHighlightedAttributes;
-    [parentTextView transformTextAtRange:range withTransformer:^NSAttributedString *(NSAttributedString *input) {
+    NSDictionary *defaultAttributes = self.defaultTextAttributes;
+    NSUInteger hullStart = [[ranges firstObject] rangeValue].location;
+    NSRange hullRange = NSMakeRange(hullStart, NSMaxRange([[ranges lastObject] rangeValue]) - hullStart);
+    [parentTextView transformTextAtRange:hullRange withTransformer:^NSAttributedString *(NSAttributedString *input) {
         NSMutableAttributedString *buffer = [input mutableCopy];
-        [buffer removeAttribute:HKWMentionAttributeName range:HKW_FULL_RANGE(input)];
-        // NOTE: We may need to add support for capturing and restoring any attributes overwritten by applying the
-        //  special mentions attributes in the future.
-        for (NSString *key in highlightedAttributes) {
-            [buffer removeAttribute:key range:HKW_FULL_RANGE(input)];
-        }
-        for (NSString *key in unhighlightedAttributes) {
-            [buffer removeAttribute:key range:HKW_FULL_RANGE(input)];
-        }
-        // Restore default attributes to text
-        for (NSString *key in self.defaultTextAttributes) {
-            __strong id attributeValue = self.defaultTextAttributes[key];
-            [buffer addAttribute:key value:attributeValue range:HKW_FULL_RANGE(input)];
+        [buffer beginEditing];
+        for (NSValue *value in ranges) {
+            NSRange range = [value rangeValue];
+            range.location -= hullStart;
+            [buffer removeAttribute:HKWMentionAttributeName range:range];
+            // NOTE: We may need to add support for capturing and restoring any attributes overwritten by applying the
+            //  special mentions attributes in the future.
+            for (NSString *key in highlightedAttributes) {
+                [buffer removeAttribute:key range:range];
+            }
+            for (NSString *key in unhighlightedAttributes) {
+                [buffer removeAttribute:key range:range];
+            }
+            // Restore default attributes to text
+            for (NSString *key in defaultAttributes) {
+                __strong id attributeValue = defaultAttributes[key];
+                [buffer addAttribute:key value:attributeValue range:range];
+            }
         }
+        [buffer endEditing];
         return [buffer copy];
     }];
 }
@@ -628,43 +780,26 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 
 - (HKWMentionsAttribute *)mentionAttributeAtLocation:(NSUInteger)location
                                                range:(NSRangePointer)range {
+    // Read the length from the text storage, since the text view's attributed text is a copy
     __strong __auto_type parentTextView = self.parentTextView;
-    if (location == [parentTextView.attributedText length]) {
+    NSUInteger textLength = [parentTextView.textStorage length];
+    if (location == textLength) {
         return nil;
-    } else if (location > [parentTextView.attributedText length]) {
+    } else if (location > textLength) {
         NSAssert(NO, @"Can't have a location beyond bounds of parent view");
         return nil;
     }
-    NSAttributedString *parentText = parentTextView.attributedText;
-    id value = [parentText attribute:HKWMentionAttributeName
-                             atIndex:location
-               longestEffectiveRange:range
-                             inRange:HKW_FULL_RANGE(parentText)];
-    if ([value isKindOfClass:[HKWMentionsAttribute class]]) {
-        // Typechecking
-        return (HKWMentionsAttribute *)value;
-    }
-    return nil;
+    return [[self validMentionsIndex] mentionAtLocation:location range:range];
 }
 
 - (HKWMentionsAttribute *)mentionAttributePrecedingLocation:(NSUInteger)location
                                                       range:(NSRangePointer)range {
     __strong __auto_type parentTextView = self.parentTextView;
-    if (location < 1 || location > [parentTextView.attributedText length]) {
+    if (location < 1 || location > [parentTextView.textStorage length]) {
         // No mention can precede the beginning of the text view.
         return nil;
     }
-    NSAttributedString *parentText = parentTextView.attributedText;
-    id value = [parentText attribute:HKWMentionAttributeName
-                             atIndex:location - 1
-               longestEffectiveRange:range
-                             inRange:HKW_FULL_RANGE(parentText)];
-    if ([value isKindOfClass:[HKWMentionsAttribute class]]) {
-        // Typechecking
-        return (HKWMentionsAttribute *)value;
-    }
-    NSAssert(value == nil, @"The value for a LIMentionAttribute must be an HKWMentionsAttribute object.");
-    return nil;
+    return [[self validMentionsIndex] mentionAtLocation:location - 1 range:range];
 }
 
 /*!
@@ -689,24 +824,102 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     // CASE 1: zero-length range (e.g. insertion point)
     if (range.length == 0) {
         if ([self mentionAttributePrecedingLocation:range.location range:NULL]
-            || ((range.location + 1) <= [parentTextView.text length] && [self mentionAttributePrecedingLocation:(range.location + 1) range:NULL])) {
+            || ((range.location + 1) <= [parentTextView.textStorage length] && [self mentionAttributePrecedingLocation:(range.location + 1) range:NULL])) {
             // Mention exists either before the location, or right after the location
             return YES;
         }
         return NO;
     }
     // CASE 2: selection range
-    for (NSUInteger i = 0; i < range.length + 1; i++) {
-        NSUInteger currentLocation = range.location + i;
-        if (currentLocation > [parentTextView.text length]) {
-            // Out of bounds
-            return NO;
-        }
-        if ([self mentionAttributePrecedingLocation:currentLocation range:NULL] != nil) {
-            return YES;
+    // A mention touches the range if it covers any character from the one preceding the range through the range's last
+    //  character.
+    NSUInteger textLength = [parentTextView.textStorage length];
+    if (range.location > textLength) {
+        // Out of bounds
+        return NO;
+    }
+    NSUInteger searchStart = (range.location > 0 ? range.location - 1 : 0);
+    NSUInteger searchEnd = MIN(NSMaxRange(range), textLength);
+    if (searchEnd <= searchStart) {
+        return NO;
+    }
+    __block BOOL touchesMention = NO;
+    [[self validMentionsIndex] enumerateMentionsIntersectingRange:NSMakeRange(searchStart, searchEnd - searchStart)
+                                                       usingBlock:^(__unused HKWMentionsAttribute *mention, __unused NSRange mentionRange, BOOL *stop) {
+                                                           touchesMention = YES;
+                                                           *stop = YES;
+                                                       }];
+    return touchesMention;
+}
+
+#pragma mark - Mentions index
+
+/*!
+ Return the mentions index, first making sure it is observing the parent text view's text storage and rebuilding it if
+ it has become stale.
+ */
+- (HKWMentionsIntervalIndex *)validMentionsIndex {
+    NSTextStorage *textStorage = self.parentTextView.textStorage;
+    if (textStorage != self.observedTextStorage) {
+        [self stopObservingTextStorage];
+        if (textStorage) {
+            [[NSNotificationCenter defaultCenter] addObserver:self
+                                                     selector:@selector(textStorageDidProcessEditing:)
+                                                         name:NSTextStorageDidProcessEditingNotification
+                                                       object:textStorage];
+            self.observedTextStorage = textStorage;
         }
     }
-    return NO;
+    if (!self.mentionsIndex.isValid || !textStorage) {
+        [self.mentionsIndex rebuildFromAttributedString:textStorage ?: [NSAttributedString new]];
+        self.mentionsIndexBatchChangeInLength = (textStorage.editedMask != 0 ? textStorage.changeInLength : 0);
+    }
+    else if (textStorage.editedMask != 0) {
+        // The text storage is in the middle of a batch of edits that haven't been processed yet. Everything the batch
+        //  has changed so far lies within its edited range, so only that range needs to be rescanned.
+        [self updateMentionsIndexForEditsToTextStorage:textStorage];
+        self.mentionsIndexBatchChangeInLength = textStorage.changeInLength;
+    }
+    return self.mentionsIndex;
+}
+
+/*!
+ Bring the mentions index up to date with the edits the text storage has accumulated since it last processed its
+ edits, less any the index was already brought up to date with during the same batch.
+ */
+- (void)updateMentionsIndexForEditsToTextStorage:(NSTextStorage *)textStorage {
+    if ((textStorage.editedMask & (NSTextStorageEditedCharacters | NSTextStorageEditedAttributes)) == 0) {
+        return;
+    }
+    [self.mentionsIndex updateForEditedRange:textStorage.editedRange
+                              changeInLength:textStorage.changeInLength - self.mentionsIndexBatchChangeInLength
+                          inAttributedString:textStorage];
+}
+
+- (void)stopObservingTextStorage {
+    NSTextStorage *textStorage = self.observedTextStorage;
+    if (textStorage) {
+        [[NSNotificationCenter defaultCenter] removeObserver:self
+                                                        name:NSTextStorageDidProcessEditingNotification
+                                                      object:textStorage];
+    }
+    self.observedTextStorage = nil;
+    self.mentionsIndexBatchChangeInLength = 0;
+    [self.mentionsIndex invalidate];
+}
+
+/*!
+ Shift the mentions index to account for an edit. This covers both edits typed by the user (which are vetted by
+ \c textView:shouldChangeTextInRange:replacementText: before they land) and the programmatic transformations the plug-in
+ performs on the text.
+ */
+- (void)textStorageDidProcessEditing:(NSNotification *)notification {
+    NSTextStorage *textStorage = notification.object;
+    if (textStorage != self.observedTextStorage) {
+        return;
+    }
+    [self updateMentionsIndexForEditsToTextStorage:textStorage];
+    self.mentionsIndexBatchChangeInLength = 0;
 }
 
 // TODO: Make all utils static
@@ -724,15 +937,19 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     if (text.length <= 0) {
         return nil;
     }
+    // Both searches read the text through the same reader; the only string allocated is the query itself
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, text);
     // Search starting from the given location, and return first control character
-    NSUInteger mostRecentValidControlCharacterLocation = [self mostRecentValidControlCharacterLocation:text beforeLocation:location];
+    NSUInteger mostRecentValidControlCharacterLocation = [self mostRecentValidControlCharacterLocationInReader:&reader
+                                                                                                beforeLocation:location];
     if (mostRecentValidControlCharacterLocation != NSNotFound) {
         // Query until end of word in which cursor is present (or until cursor if it is at end of word)
-        NSUInteger endOfValidWordAfterLocation = [self endOfValidWordInText:text afterLocation:location];
-        if (endOfValidWordAfterLocation != NSNotFound) {
-            NSString *substringUntilEndOfWord = [text substringToIndex:endOfValidWordAfterLocation];
+        NSUInteger endOfValidWordAfterLocation = [self endOfValidWordInReader:&reader afterLocation:location];
+        if (endOfValidWordAfterLocation != NSNotFound && endOfValidWordAfterLocation >= mostRecentValidControlCharacterLocation) {
             // Return the string, including the control char as the query
-            return [substringUntilEndOfWord substringFromIndex:mostRecentValidControlCharacterLocation];
+            return [text substringWithRange:NSMakeRange(mostRecentValidControlCharacterLocation,
+                                                        endOfValidWordAfterLocation - mostRecentValidControlCharacterLocation)];
         }
     }
     return nil;
@@ -747,30 +964,35 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
  @return location of end of next word, start at @c location
  */
 - (NSUInteger)endOfValidWordInText:(nonnull NSString *)text afterLocation:(NSUInteger)location {
-    NSUInteger i;
-    
-    // Combine punctuation and whitespace/newline characters
-    NSMutableCharacterSet *stoppingCharacterSet = [[NSCharacterSet whitespaceAndNewlineCharacterSet] mutableCopy];
-    // If enabled, stops at the punctuation characters as well.
-    if (self.shouldEnableEnhancedMentionReplacementRules) {
-        [stoppingCharacterSet formUnionWithCharacterSet:[NSCharacterSet punctuationCharacterSet]];
-    }
-
-    for (i = location; i < text.length; i++) {
-        // If there is a mentions attribute, this is not a valid word
-        HKWMentionsAttribute *mentionAttribute = [self mentionAttributeAtLocation:i range:nil];
-        if (mentionAttribute) {
-            return NSNotFound;
-        }
-        
-        unichar character = [text characterAtIndex:i];
-        if ([stoppingCharacterSet characterIsMember:character]) {
-            return i;
-        }
-    }
-    return i;
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, text);
+    return [self endOfValidWordInReader:&reader afterLocation:location];
 }
 
+/**
+ Equivalent to @c endOfValidWordInText:afterLocation:, reading the text through @c reader.
+ */
+- (NSUInteger)endOfValidWordInReader:(HKWCharacterReader *)reader afterLocation:(NSUInteger)location {
+    if (location >= reader->length) {
+        return location;
+    }
+    const HKWCharacterClass stoppingClasses = (self.shouldEnableEnhancedMentionReplacementRules
+                                               ? HKWCharacterClassSeparator
+                                               : HKWCharacterClassWhitespace);
+    NSUInteger endOfWord = [self.characterClassifier nextIndexOfCharacterInClass:stoppingClasses
+                                                                        inReader:reader
+                                                                       fromIndex:location];
+
+    // If there is a mentions attribute anywhere up to and including the stopping character, this is not a valid word
+    NSRange wordRange = NSMakeRange(location, MIN(endOfWord + 1, reader->length) - location);
+    __block BOOL wordContainsMention = NO;
+    [[self validMentionsIndex] enumerateMentionsIntersectingRange:wordRange
+                                                       usingBlock:^(__unused HKWMentionsAttribute *mention, __unused NSRange mentionRange, BOOL *stop) {
+                                                           wordContainsMention = YES;
+                                                           *stop = YES;
+                                                       }];
+    return wordContainsMention ? NSNotFound : endOfWord;
+}
 
 /**
  Search backwards in a string for a character in the control character set
@@ -780,26 +1002,44 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
  @returns Location for most recent control character in a @c text
  */
 - (NSUInteger)mostRecentControlCharacterLocationInText:(NSString *)text locationOffsetInOriginalText:(NSUInteger)locationOffsetInOriginalText {
-    if (text.length == 0) {
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, text);
+    return [self mostRecentControlCharacterLocationInReader:&reader
+                                                searchRange:NSMakeRange(0, reader.length)
+                               locationOffsetInOriginalText:locationOffsetInOriginalText];
+}
+
+/**
+ Search backwards within a range of a string for a character in the control character set, without copying any part of
+ the string.
+
+ @param reader The reader for the text in which to perform a backwards search for a control character
+ @param searchRange The range of the text to search; the search begins at the end of the range
+ @param locationOffsetInOriginalText The offset of the text within the text view's text
+ @returns Location within the text of the most recent control character in @c searchRange, or @c NSNotFound
+ */
+- (NSUInteger)mostRecentControlCharacterLocationInReader:(HKWCharacterReader *)reader
+                                             searchRange:(NSRange)searchRange
+                            locationOffsetInOriginalText:(NSUInteger)locationOffsetInOriginalText {
+    NSUInteger controlCharLocation = [self.characterClassifier previousIndexOfCharacterInClass:HKWCharacterClassControl
+                                                                                     inReader:reader
+                                                                                        range:searchRange];
+    if (controlCharLocation == NSNotFound) {
         return NSNotFound;
     }
-    int endOfTextIndex = (int)text.length - 1;
-    for (int index = endOfTextIndex; index >= 0; index--) {
-        NSUInteger unsignedIndex = (unsigned long)index;
-        unichar character = [text characterAtIndex:unsignedIndex];
-        if ([self.controlCharacterSet characterIsMember:character]) {
-            // If the most recent control character has mention attribute, return NSNotFound
-            // Note that here we need to add back the locationOffsetInOriginalText which represents `originalText.length - trimmedText.length`.
-            NSUInteger location = HKWTextView.enableControlCharacterMaxLengthFix ? (unsignedIndex + locationOffsetInOriginalText) : unsignedIndex;
-            if (HKWTextView.enableControlCharactersToPrepend
-                && [self.controlCharactersToPrepend characterIsMember:character]
-                && [self mentionAttributeAtLocation:location range:nil]) {
-                return NSNotFound;
-            }
-            return unsignedIndex;
-        }
+    // If the most recent control character has mention attribute, return NSNotFound
+    // Note that without the max length fix, the location used to look up the mention attribute is relative to the
+    //  start of the search range rather than to the text view's text.
+    unichar character = HKWCharacterReaderCharacterAtIndex(reader, controlCharLocation);
+    NSUInteger location = (HKWTextView.enableControlCharacterMaxLengthFix
+                           ? (controlCharLocation + locationOffsetInOriginalText)
+                           : (controlCharLocation - searchRange.location));
+    if (HKWTextView.enableControlCharactersToPrepend
+        && [self.controlCharactersToPrepend characterIsMember:character]
+        && [self mentionAttributeAtLocation:location range:nil]) {
+        return NSNotFound;
     }
-    return NSNotFound;
+    return controlCharLocation;
 }
 
 /**
@@ -810,22 +1050,32 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
  @returns The location, if any, for the control character
  */
 - (NSUInteger)mostRecentValidControlCharacterLocation:(NSString *)text beforeLocation:(NSUInteger)location {
-    NSString *substringUntilLocation = [text substringToIndex:location];
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, text);
+    return [self mostRecentValidControlCharacterLocationInReader:&reader beforeLocation:location];
+}
+
+/**
+ Equivalent to @c mostRecentValidControlCharacterLocation:beforeLocation:, reading the text through @c reader.
+ */
+- (NSUInteger)mostRecentValidControlCharacterLocationInReader:(HKWCharacterReader *)reader
+                                               beforeLocation:(NSUInteger)location {
     // Search back MAX_MENTION_QUERY_LENGTH for a control character
     NSUInteger maximumSearchIndex = (NSUInteger)MAX((int)location-MAX_MENTION_QUERY_LENGTH, 0);
-    NSString *substringToSearchForControlChar = [substringUntilLocation substringFromIndex:maximumSearchIndex];
     // Find control character location
-    NSUInteger controlCharLocation = [self mostRecentControlCharacterLocationInText:substringToSearchForControlChar
-                                                       locationOffsetInOriginalText:maximumSearchIndex];
-    if (controlCharLocation != NSNotFound) {
-        // If it exists, offset it by the search index to get actual location in the parent text view
-        controlCharLocation = controlCharLocation + maximumSearchIndex;
+    NSUInteger controlCharLocation = [self mostRecentControlCharacterLocationInReader:reader
+                                                                          searchRange:NSMakeRange(maximumSearchIndex, location - maximumSearchIndex)
+                                                         locationOffsetInOriginalText:0];
+    if (controlCharLocation == NSNotFound) {
+        return NSNotFound;
     }
 
     // If there's a non-mentions alphanumeric before the control char, then it's invalid
-    unichar charPrecidingControlChar = [self.parentTextView characterPrecedingLocation:(NSInteger)controlCharLocation];
+    unichar charPrecidingControlChar = (controlCharLocation > 0
+                                        ? HKWCharacterReaderCharacterAtIndex(reader, controlCharLocation - 1)
+                                        : (unichar)0);
     if (charPrecidingControlChar
-        && [[NSCharacterSet alphanumericCharacterSet] characterIsMember:charPrecidingControlChar]
+        && [self.characterClassifier character:charPrecidingControlChar isInClass:HKWCharacterClassAlphanumeric]
         && ![self mentionAttributeAtLocation:controlCharLocation-1
                                        range:nil]) {
         return NSNotFound;
@@ -935,6 +1185,7 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 
     // If there is no mention intersecting the start or the end of the range, allow the text view to handle it
     if (!doesStartOfRangeIntersectWithMention && !doesEndOfRangeIntersectWithMention) {
+        [self notifyDelegateOfMentionsDeletedInRange:range excludingMentionsAtRanges:nil];
         return YES;
     }
 
@@ -952,6 +1203,18 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
         [self mentionCanBeTrimmed:mentionAtEndOfRange trimmedString:&trimmedMentionAtEndOfRange];
     }
 
+    // Trimmed mentions survive the deletion, so they are not reported as deleted. They are identified by their ranges,
+    //  since mentions of the same entity compare as equal.
+    NSMutableArray<NSValue *> *survivingMentionRanges = [NSMutableArray array];
+    if (trimmedMentionAtStartOfRange) {
+        [survivingMentionRanges addObject:[NSValue valueWithRange:mentionRangeAtStartOfRange]];
+    }
+    if (trimmedMentionAtEndOfRange
+        && !(trimmedMentionAtStartOfRange && NSEqualRanges(mentionRangeAtStartOfRange, mentionRangeAtEndOfRange))) {
+        [survivingMentionRanges addObject:[NSValue valueWithRange:mentionRangeAtEndOfRange]];
+    }
+    [self notifyDelegateOfMentionsDeletedInRange:deletionRange excludingMentionsAtRanges:survivingMentionRanges];
+
     [parentTextView transformTextAtRange:deletionRange
                          withTransformer:^NSAttributedString *(NSAttributedString *input) {
         NSMutableAttributedString *returnString = nil;
@@ -989,6 +1252,28 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     return NO;
 }
 
+/*!
+ Inform the state change delegate, in a single call, of every mention intersecting a range of text that is about to be
+ deleted, other than the mentions spanning \c excludedRanges.
+ */
+- (void)notifyDelegateOfMentionsDeletedInRange:(NSRange)range
+                     excludingMentionsAtRanges:(nullable NSArray<NSValue *> *)excludedRanges {
+    __strong __auto_type strongStateChangeDelegate = self.stateChangeDelegate;
+    if (![strongStateChangeDelegate respondsToSelector:@selector(mentionsPlugin:deletedMentions:inRange:)]) {
+        return;
+    }
+    NSMutableArray<HKWMentionsAttribute *> *deletedMentions = [NSMutableArray array];
+    [[self validMentionsIndex] enumerateMentionsIntersectingRange:range
+                                                       usingBlock:^(HKWMentionsAttribute *mention, NSRange mentionRange, __unused BOOL *stop) {
+                                                           if (![excludedRanges containsObject:[NSValue valueWithRange:mentionRange]]) {
+                                                               [deletedMentions addObject:mention];
+                                                           }
+                                                       }];
+    if ([deletedMentions count] > 0) {
+        [strongStateChangeDelegate mentionsPlugin:self deletedMentions:deletedMentions inRange:range];
+    }
+}
+
 #pragma mark - Plug-in protocol
 
 - (void)dataReturnedWithEmptyResults:(BOOL)isEmptyResults
@@ -1008,14 +1293,11 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     }
 
     NSRange range;
-    id attribute = [parentTextView.attributedText attribute:HKWMentionAttributeName
-                                                    atIndex:cursorLocation
-                                      longestEffectiveRange:&range
-                                                    inRange:HKW_FULL_RANGE(parentTextView.attributedText)];;
+    HKWMentionsAttribute *mention = [self mentionAttributeAtLocation:cursorLocation range:&range];
 
     // If there is a mention at the given location, highlight it
     // - unless the cursor is right at the beginning of the mention. We only want to highlight if the cursor is within it
-    if ([attribute isKindOfClass:[HKWMentionsAttribute class]] && range.location != cursorLocation) {
+    if (mention && range.location != cursorLocation) {
         // We don't need to update if we're already in the currently highlighted range
         if (!(NSEqualRanges(range, self.currentlyHighlightedMentionRange))) {
             [self toggleMentionsFormattingIfNeededAtRange:self.currentlyHighlightedMentionRange highlighted:NO];
@@ -1050,6 +1332,11 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
         }
     // Insertion
     } else {
+        if (self.prefetchesInitialResults && text.length == 1
+            && [self.controlCharacterSet characterIsMember:[text characterAtIndex:0]]) {
+            // Get the initial results on their way before the control character begins a mention
+            [self.creationStateMachine prefetchInitialResultsForControlCharacter:[text characterAtIndex:0]];
+        }
         //  If a character is inserted within a mention then bleach the mention.
         if (range.length == 0 && self.currentlyHighlightedMentionRange.location != NSNotFound) {
             const NSRange highlightedMentionInternalTextRange = NSMakeRange(self.currentlyHighlightedMentionRange.location + 1,
@@ -1106,7 +1393,8 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 
     // If we are not currently long pressing, handle mentions creation. This to avoid querying for mentions when the selection change is due to a long press
     if (![self.parentTextView isCurrentlyLongPressing]) {
-        [self handleMentionsCreationInText:textView.text atLocation:cursorLocation];
+        // Scan the text storage's backing string, rather than the copy returned by the text view's text property
+        [self handleMentionsCreationInText:textView.textStorage.string atLocation:cursorLocation];
     }
 }
 
@@ -1139,6 +1427,12 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     }
 }
 
+- (void)textViewDidBeginEditing:(__unused UITextView *)textView {
+    if (self.prefetchesInitialResults) {
+        [self.creationStateMachine prefetchInitialResultsForControlCharacters:self.controlCharacterSet];
+    }
+}
+
 - (void)textViewDidEndEditing:(__unused UITextView *)textView {
     [self.creationStateMachine cancelMentionCreation];
     if (self.viewportLocksUponMentionCreation) {
@@ -1174,29 +1468,83 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
                                searchType:(HKWMentionsSearchType)type
                          controlCharacter:(unichar)character
                                completion:(void (^)(NSArray *, BOOL, BOOL))completionBlock {
+    [self asyncRetrieveEntitiesForKeyString:keyString
+                                 searchType:type
+                           controlCharacter:character
+                          cancellationToken:[HKWMentionsCancellationToken new]
+                                 completion:completionBlock];
+}
+
+- (void)asyncRetrieveEntitiesForKeyString:(NSString *)keyString
+                               searchType:(HKWMentionsSearchType)type
+                         controlCharacter:(unichar)character
+                        cancellationToken:(HKWMentionsCancellationToken *)cancellationToken
+                               completion:(void (^)(NSArray *, BOOL, BOOL))completionBlock {
     // set up the chooser view prior to data request in order to support fully customized view
     [self.creationStateMachine setupChooserViewIfNeeded];
     // Remove this after directlyUpdateQueryWithCustomDelegate is ramped, because async vs. didUpdate should be totally separate
     __strong __auto_type strongCustomChooserViewDelegate = self.customChooserViewDelegate;
     if (strongCustomChooserViewDelegate) {
-        [strongCustomChooserViewDelegate didUpdateKeyString:keyString
-                                           controlCharacter:character];
-    } else {
-        [self.defaultChooserViewDelegate asyncRetrieveEntitiesForKeyString:keyString
-                                                                searchType:type
-                                                          controlCharacter:character
-                                                                completion:completionBlock];
+        [self notifyCustomChooserViewDelegate:strongCustomChooserViewDelegate
+                           ofUpdatedKeyString:keyString
+                             controlCharacter:character
+                            cancellationToken:cancellationToken];
+        return;
+    }
+    __strong __auto_type strongDefaultChooserViewDelegate = self.defaultChooserViewDelegate;
+    if ([strongDefaultChooserViewDelegate respondsToSelector:@selector(asyncRetrieveEntitiesForKeyString:searchType:controlCharacter:cancellationToken:completion:)]) {
+        [strongDefaultChooserViewDelegate asyncRetrieveEntitiesForKeyString:keyString
+                                                                 searchType:type
+                                                           controlCharacter:character
+                                                          cancellationToken:cancellationToken
+                                                                 completion:completionBlock];
+    } else if (strongDefaultChooserViewDelegate) {
+        [strongDefaultChooserViewDelegate asyncRetrieveEntitiesForKeyString:keyString
+                                                                 searchType:type
+                                                           controlCharacter:character
+                                                                 completion:completionBlock];
+    } else if (self.localEntityIndex || [self.typeaheadSources count] > 0) {
+        // The local entity index and the additional typeahead sources are the only sources of results
+        completionBlock(@[], YES, YES);
     }
 }
 
 - (void)didUpdateKeyString:(nonnull NSString *)keyString
           controlCharacter:(unichar)character {
+    [self didUpdateKeyString:keyString
+            controlCharacter:character
+           cancellationToken:[HKWMentionsCancellationToken new]];
+}
+
+- (void)didUpdateKeyString:(nonnull NSString *)keyString
+          controlCharacter:(unichar)character
+         cancellationToken:(nonnull HKWMentionsCancellationToken *)cancellationToken {
     // set up the chooser view prior to data request in order to support fully customized view
     [self.creationStateMachine setupChooserViewIfNeeded];
     __strong __auto_type strongCustomChooserViewDelegate = self.customChooserViewDelegate;
     NSAssert(strongCustomChooserViewDelegate != nil, @"Must have a custom chooser view if the query is being updated directly via this method");
-    [strongCustomChooserViewDelegate didUpdateKeyString:keyString
-                                       controlCharacter:character];
+    [self notifyCustomChooserViewDelegate:strongCustomChooserViewDelegate
+                       ofUpdatedKeyString:keyString
+                         controlCharacter:character
+                        cancellationToken:cancellationToken];
+}
+
+/*!
+ Pass an updated key string to a custom chooser view delegate, along with its cancellation token if the delegate
+ supports it.
+ */
+- (void)notifyCustomChooserViewDelegate:(id<HKWMentionsCustomChooserViewDelegate>)customChooserViewDelegate
+                     ofUpdatedKeyString:(NSString *)keyString
+                       controlCharacter:(unichar)character
+                      cancellationToken:(HKWMentionsCancellationToken *)cancellationToken {
+    if ([customChooserViewDelegate respondsToSelector:@selector(didUpdateKeyString:controlCharacter:cancellationToken:)]) {
+        [customChooserViewDelegate didUpdateKeyString:keyString
+                                     controlCharacter:character
+                                    cancellationToken:cancellationToken];
+    } else {
+        [customChooserViewDelegate didUpdateKeyString:keyString
+                                     controlCharacter:character];
+    }
 }
 
 - (UITableViewCell *)cellForMentionsEntity:(id<HKWMentionsEntityProtocol>)entity
@@ -1253,6 +1601,7 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     if (!mention) {
         return;
     }
+    [self.recentEntitiesStore recordMention:mention];
     [self performMentionCreationEndCleanup];
 
     // Actually create the mention
@@ -1265,12 +1614,15 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     NSDictionary *unhighlightedAttributes = self.mentionUnhighlightedAttributes;
 
     NSRange rangeToTransform;
+    HKWCharacterReader reader;
+    HKWCharacterReaderInitWithString(&reader, parentTextView.textStorage.string);
     // Find where previous control character was, and replace mention at that point
-    NSString *substringUntilCursor = [parentTextView.text substringToIndex:cursorLocation];
-    NSUInteger controlCharLocation = [self mostRecentControlCharacterLocationInText:substringUntilCursor locationOffsetInOriginalText:0];
+    NSUInteger controlCharLocation = [self mostRecentControlCharacterLocationInReader:&reader
+                                                                          searchRange:NSMakeRange(0, MIN(cursorLocation, reader.length))
+                                                         locationOffsetInOriginalText:0];
     // Prepend control character to mentionText if needed
     if (HKWTextView.enableControlCharactersToPrepend && controlCharLocation != NSNotFound) {
-        unichar controlCharacter = [parentTextView.text characterAtIndex:controlCharLocation];
+        unichar controlCharacter = HKWCharacterReaderCharacterAtIndex(&reader, controlCharLocation);
         BOOL shouldPrependControlCharacter = [self.controlCharactersToPrepend characterIsMember:controlCharacter];
         if (shouldPrependControlCharacter) {
             // Use %C instead of %c for unichar
@@ -1279,7 +1631,7 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     }
     NSString *mentionText = mention.mentionText;
     // Replace until the end of the word at the current cursor location
-    NSUInteger endOfWordToReplace = [self endOfValidWordInText:parentTextView.text afterLocation:cursorLocation];
+    NSUInteger endOfWordToReplace = [self endOfValidWordInReader:&reader afterLocation:cursorLocation];
     rangeToTransform = NSMakeRange(controlCharLocation, endOfWordToReplace - controlCharLocation);
 
     [parentTextView transformTextAtRange:rangeToTransform
@@ -1307,9 +1659,10 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     if (self.shouldEnableEnhancedMentionReplacementRules) {
         // Check if the mention ends at the end of paragraph. If yes, then add a space.
         NSUInteger insertionEndLocation = controlCharLocation + [mentionText length];
-        BOOL isAtEndOfParagraph = (insertionEndLocation == parentTextView.text.length ||
-                                   (insertionEndLocation < parentTextView.text.length &&
-                                    [parentTextView.text characterAtIndex:insertionEndLocation] == '\n'));
+        NSString *textAfterInsertion = parentTextView.textStorage.string;
+        BOOL isAtEndOfParagraph = (insertionEndLocation == textAfterInsertion.length ||
+                                   (insertionEndLocation < textAfterInsertion.length &&
+                                    [textAfterInsertion characterAtIndex:insertionEndLocation] == '\n'));
         if (isAtEndOfParagraph) {
             NSMutableAttributedString *mutableText = [parentTextView.attributedText mutableCopy];
             NSAttributedString *space = [[NSAttributedString alloc] initWithString:@" " attributes:parentTextView.typingAttributes];
@@ -1503,6 +1856,13 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
     return correctedPoint.x + rect.size.width/2;
 }
 
+- (void)typeaheadRequestDelayedBy:(NSTimeInterval)delay forSearchType:(HKWMentionsSearchType)type {
+    __strong __auto_type strongStateChangeDelegate = self.stateChangeDelegate;
+    if ([strongStateChangeDelegate respondsToSelector:@selector(mentionsPlugin:appliedTypeaheadDelay:forSearchType:)]) {
+        [strongStateChangeDelegate mentionsPlugin:self appliedTypeaheadDelay:delay forSearchType:type];
+    }
+}
+
 #pragma mark - Properties
 
 - (BOOL)loadingCellSupported {
@@ -1604,6 +1964,21 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 
 @synthesize controlCharacterSet;
 
+- (void)setControlCharacterSet:(NSCharacterSet *)characterSet {
+    if (controlCharacterSet == characterSet) {
+        return;
+    }
+    controlCharacterSet = characterSet;
+    self.characterClassifier = nil;
+}
+
+- (HKWCharacterClassifier *)characterClassifier {
+    if (!_characterClassifier) {
+        _characterClassifier = [HKWCharacterClassifier classifierWithControlCharacterSet:self.controlCharacterSet];
+    }
+    return _characterClassifier;
+}
+
 @synthesize defaultChooserViewDelegate;
 
 @synthesize customChooserViewDelegate;
@@ -1626,6 +2001,31 @@ static int MAX_MENTION_QUERY_LENGTH = 100;
 
 @synthesize stateChangeDelegate;
 
+@synthesize rateLimitPolicy;
+
+@synthesize prefetchesInitialResults;
+
+@synthesize recentEntitiesStore;
+@synthesize localEntityIndex;
+@synthesize typeaheadSources;
+@synthesize typeaheadService;
+
+- (id<HKWMentionsRateLimitPolicy>)rateLimitPolicy {
+    if (!rateLimitPolicy) {
+        rateLimitPolicy = [HKWMentionsDefaultRateLimitPolicy defaultPolicy];
+    }
+    return rateLimitPolicy;
+}
+
+@synthesize cellHeightCache;
+
+- (HKWMentionsCellHeightCache *)cellHeightCache {
+    if (!cellHeightCache) {
+        cellHeightCache = [HKWMentionsCellHeightCache new];
+    }
+    return cellHeightCache;
+}
+
 @synthesize shouldEnableEnhancedMentionReplacementRules;
 
 @end
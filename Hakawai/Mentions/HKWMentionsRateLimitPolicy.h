@@ -0,0 +1,117 @@
+//
+//  HKWMentionsRateLimitPolicy.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <UIKit/UIKit.h>
+
+#import "HKWMentionsDefaultChooserViewDelegate.h"
+
+/*!
+ A protocol describing how the mentions plug-in spaces out the typeahead requests it makes to its default chooser view
+ delegate while the user is typing.
+ */
+@protocol HKWMentionsRateLimitPolicy <NSObject>
+
+/*!
+ Whether a query made while no delay is in effect should be requested immediately. If YES, the delay is applied after
+ the request, and only the most recent query made during it is requested once it expires. If NO, every query restarts
+ the delay, and a request is only made once the user stops typing for its duration.
+ */
+@property (nonatomic, readonly) BOOL sendsLeadingEdgeRequests;
+
+/*!
+ Return the delay to apply for a query of the given search type.
+ */
+- (NSTimeInterval)delayForSearchType:(HKWMentionsSearchType)type;
+
+@optional
+
+/*!
+ Inform the policy of the time that passed between a request and the first response to it.
+ */
+- (void)recordResponseTime:(NSTimeInterval)responseTime forSearchType:(HKWMentionsSearchType)type;
+
+/*!
+ The maximum number of requests which may await their first response at once, or 0 for no limit. While the limit is
+ reached, the most recent query is held back until a response arrives. Requests which were canceled count towards the
+ limit until the data source calls their completion block, so the limit must only be used with data sources which call
+ the completion block for every request.
+ */
+@property (nonatomic, readonly) NSUInteger maximumConcurrentRequests;
+
+@end
+
+/*!
+ An enum describing the behavior of a built-in rate limit policy.
+
+ \c HKWMentionsRateLimitModeFixed waits until the user has stopped typing for a fixed delay before making a request.
+
+ \c HKWMentionsRateLimitModeLeadingAndTrailingEdge makes a request immediately, and then at most one more request, for
+ the most recent query, once a fixed cooldown expires. This is the plug-in's default behavior.
+
+ \c HKWMentionsRateLimitModeAdaptive behaves like \c HKWMentionsRateLimitModeLeadingAndTrailingEdge, but uses an
+ exponentially weighted moving average of the observed response times for each search type as its cooldown, so that
+ requests are made as quickly as the data source can answer them.
+ */
+typedef NS_ENUM(NSInteger, HKWMentionsRateLimitMode) {
+    HKWMentionsRateLimitModeFixed = 0,
+    HKWMentionsRateLimitModeLeadingAndTrailingEdge,
+    HKWMentionsRateLimitModeAdaptive
+};
+
+/*!
+ The built-in rate limit policies.
+ */
+@interface HKWMentionsDefaultRateLimitPolicy : NSObject <HKWMentionsRateLimitPolicy>
+
+@property (nonatomic, readonly) HKWMentionsRateLimitMode mode;
+
+/*!
+ The weight given to each new response time when updating the moving average of an adaptive policy, between 0 and 1.
+ Defaults to 0.3.
+ */
+@property (nonatomic) double smoothingFactor;
+
+/*!
+ The maximum number of requests which may await their first response at once, or 0 for no limit. Defaults to 0.
+ */
+@property (nonatomic, readwrite) NSUInteger maximumConcurrentRequests;
+
+/*!
+ Return a policy which makes a request once the user has stopped typing for \c delay seconds.
+ */
++ (nonnull instancetype)fixedPolicyWithDelay:(NSTimeInterval)delay;
+
+/*!
+ Return a policy which makes a request immediately, and then waits \c cooldown seconds before making another.
+ */
++ (nonnull instancetype)leadingAndTrailingEdgePolicyWithCooldown:(NSTimeInterval)cooldown;
+
+/*!
+ Return a policy which makes a request immediately, and then waits for as long as requests of the same search type
+ have recently taken to answer before making another. The wait is clamped between \c minimumDelay and
+ \c maximumDelay, and is \c minimumDelay until a response time has been observed.
+ */
++ (nonnull instancetype)adaptivePolicyWithMinimumDelay:(NSTimeInterval)minimumDelay
+                                          maximumDelay:(NSTimeInterval)maximumDelay;
+
+/*!
+ Return the policy used by the plug-in if no other policy is set: a leading and trailing edge policy with a cooldown of
+ 0.1 seconds.
+ */
++ (nonnull instancetype)defaultPolicy;
+
+/*!
+ Return the moving average of the response times recorded for the given search type, or 0 if none have been recorded.
+ */
+- (NSTimeInterval)averageResponseTimeForSearchType:(HKWMentionsSearchType)type;
+
+@end
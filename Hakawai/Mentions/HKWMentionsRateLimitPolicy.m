@@ -0,0 +1,88 @@
+//
+//  HKWMentionsRateLimitPolicy.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "HKWMentionsRateLimitPolicy.h"
+
+@interface HKWMentionsDefaultRateLimitPolicy ()
+
+@property (nonatomic, readwrite) HKWMentionsRateLimitMode mode;
+@property (nonatomic) NSTimeInterval minimumDelay;
+@property (nonatomic) NSTimeInterval maximumDelay;
+
+/// The moving average of the response times for each search type, keyed by boxed search type.
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, NSNumber *> *averageResponseTimes;
+
+@end
+
+@implementation HKWMentionsDefaultRateLimitPolicy
+
++ (instancetype)policyWithMode:(HKWMentionsRateLimitMode)mode
+                  minimumDelay:(NSTimeInterval)minimumDelay
+                  maximumDelay:(NSTimeInterval)maximumDelay {
+    HKWMentionsDefaultRateLimitPolicy *policy = [[self class] new];
+    policy.mode = mode;
+    policy.minimumDelay = MAX(minimumDelay, 0);
+    policy.maximumDelay = MAX(maximumDelay, policy.minimumDelay);
+    policy.smoothingFactor = 0.3;
+    policy.averageResponseTimes = [NSMutableDictionary dictionary];
+    return policy;
+}
+
++ (instancetype)fixedPolicyWithDelay:(NSTimeInterval)delay {
+    return [self policyWithMode:HKWMentionsRateLimitModeFixed minimumDelay:delay maximumDelay:delay];
+}
+
++ (instancetype)leadingAndTrailingEdgePolicyWithCooldown:(NSTimeInterval)cooldown {
+    return [self policyWithMode:HKWMentionsRateLimitModeLeadingAndTrailingEdge minimumDelay:cooldown maximumDelay:cooldown];
+}
+
++ (instancetype)adaptivePolicyWithMinimumDelay:(NSTimeInterval)minimumDelay maximumDelay:(NSTimeInterval)maximumDelay {
+    return [self policyWithMode:HKWMentionsRateLimitModeAdaptive minimumDelay:minimumDelay maximumDelay:maximumDelay];
+}
+
++ (instancetype)defaultPolicy {
+    return [self leadingAndTrailingEdgePolicyWithCooldown:0.1];
+}
+
+#pragma mark - API
+
+- (BOOL)sendsLeadingEdgeRequests {
+    return self.mode != HKWMentionsRateLimitModeFixed;
+}
+
+- (NSTimeInterval)delayForSearchType:(HKWMentionsSearchType)type {
+    if (self.mode != HKWMentionsRateLimitModeAdaptive) {
+        return self.minimumDelay;
+    }
+    NSTimeInterval average = [self averageResponseTimeForSearchType:type];
+    return MIN(MAX(average, self.minimumDelay), self.maximumDelay);
+}
+
+- (void)recordResponseTime:(NSTimeInterval)responseTime forSearchType:(HKWMentionsSearchType)type {
+    if (self.mode != HKWMentionsRateLimitModeAdaptive || responseTime < 0) {
+        return;
+    }
+    NSNumber *key = @(type);
+    NSNumber *previousAverage = self.averageResponseTimes[key];
+    if (!previousAverage) {
+        self.averageResponseTimes[key] = @(responseTime);
+        return;
+    }
+    const double alpha = MIN(MAX(self.smoothingFactor, 0.0), 1.0);
+    self.averageResponseTimes[key] = @(alpha * responseTime + (1.0 - alpha) * [previousAverage doubleValue]);
+}
+
+- (NSTimeInterval)averageResponseTimeForSearchType:(HKWMentionsSearchType)type {
+    return [self.averageResponseTimes[@(type)] doubleValue];
+}
+
+@end
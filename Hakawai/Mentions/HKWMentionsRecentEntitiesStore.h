@@ -0,0 +1,79 @@
+//
+//  HKWMentionsRecentEntitiesStore.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "HKWMentionsEntityProtocol.h"
+
+@class HKWMentionsAttribute;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ A bounded store of the entities the user most recently mentioned, ordered from most to least recently used and keyed
+ by the entity's unique ID (or entity ID, if it has none).
+
+ If the store has a file URL, it is loaded from the file the first time it is used, and saved to it in the background
+ whenever it changes. Only the ID, name, unique ID and property list metadata of each entity are saved, so entities
+ loaded from the file are not instances of the data source's own entity class.
+
+ The mentions plug-in shows the stored entities which match a query as soon as the query is made, and appends the
+ results of the data source below them.
+ */
+@interface HKWMentionsRecentEntitiesStore : NSObject
+
+/*!
+ The maximum number of entities which are retained.
+ */
+@property (nonatomic, readonly) NSUInteger capacity;
+
+/*!
+ The file the store is saved to, or nil if it is only kept in memory.
+ */
+@property (nonatomic, readonly, nullable) NSURL *fileURL;
+
+/*!
+ The number of entities currently stored.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ Return a new store which retains at most \c capacity entities, and is saved to \c fileURL if it isn't nil.
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity fileURL:(nullable NSURL *)fileURL;
+
+/*!
+ Make an entity the most recently used one, replacing any entity stored with the same unique ID. If the store is full,
+ the least recently used entity is evicted.
+ */
+- (void)recordEntity:(id<HKWMentionsEntityProtocol>)entity;
+
+/*!
+ Make the entity a mention was created for the most recently used one. An entity already stored with the same entity
+ ID is kept, since it carries more information than the mention; otherwise the mention itself is stored.
+ */
+- (void)recordMention:(HKWMentionsAttribute *)mention;
+
+/*!
+ Return the stored entities with a word in their name which begins with \c keyString, ignoring case and diacritics,
+ from most to least recently used. An empty key string matches all stored entities.
+ */
+- (NSArray<id<HKWMentionsEntityProtocol>> *)entitiesMatchingKeyString:(NSString *)keyString;
+
+/*!
+ Discard all stored entities, and remove the file the store is saved to.
+ */
+- (void)removeAllEntities;
+
+@end
+
+NS_ASSUME_NONNULL_END
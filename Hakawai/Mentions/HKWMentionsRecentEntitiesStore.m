@@ -0,0 +1,254 @@
+//
+//  HKWMentionsRecentEntitiesStore.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "HKWMentionsRecentEntitiesStore.h"
+
+#import "HKWMentionsAttribute.h"
+#import "_HKWMentionsPrivateConstants.h"
+#import "_HKWMentionsTypeaheadCache.h"
+
+// Keys of the dictionary saved for each entity
+static NSString *const HKWRecentEntityIdKey = @"id";
+static NSString *const HKWRecentEntityNameKey = @"name";
+static NSString *const HKWRecentEntityUniqueIdKey = @"uid";
+static NSString *const HKWRecentEntityMetadataKey = @"meta";
+
+/*!
+ An entity loaded from the file a store is saved to.
+ */
+@interface HKWMentionsStoredEntity : NSObject <HKWMentionsEntityProtocol>
+@property (nonatomic, copy) NSString *storedEntityId;
+@property (nonatomic, copy) NSString *storedEntityName;
+@property (nonatomic, copy) NSString *storedUniqueId;
+@property (nonatomic, copy) NSDictionary *storedMetadata;
+@end
+
+@implementation HKWMentionsStoredEntity
+
+- (NSString *)entityId {
+    return self.storedEntityId;
+}
+
+- (NSString *)entityName {
+    return self.storedEntityName;
+}
+
+- (NSDictionary *)entityMetadata {
+    return self.storedMetadata;
+}
+
+- (NSString *)uniqueId {
+    return self.storedUniqueId;
+}
+
+@end
+
+@interface HKWMentionsRecentEntitiesStore ()
+
+@property (nonatomic, readwrite) NSUInteger capacity;
+@property (nonatomic, readwrite, nullable) NSURL *fileURL;
+
+/// The stored entities, from most to least recently used. Loaded from the file the first time it is used.
+@property (nonatomic, strong, null_resettable) NSMutableArray<id<HKWMentionsEntityProtocol>> *entities;
+
+/// A serial queue on which the store is saved, so that saves are written in order.
+@property (nonatomic, strong) dispatch_queue_t saveQueue;
+
+@end
+
+@implementation HKWMentionsRecentEntitiesStore
+
+- (instancetype)init {
+    return [self initWithCapacity:50 fileURL:nil];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity fileURL:(NSURL *)fileURL {
+    self = [super init];
+    if (self) {
+        _capacity = MAX(capacity, (NSUInteger)1);
+        _fileURL = [fileURL copy];
+        _saveQueue = dispatch_queue_create("com.linkedin.hakawai.mentions-recent-entities", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark - API
+
+- (NSUInteger)count {
+    return [self.entities count];
+}
+
+- (void)recordEntity:(id<HKWMentionsEntityProtocol>)entity {
+    NSString *uniqueId = [[self class] uniqueIdForEntity:entity];
+    if ([uniqueId length] == 0) {
+        return;
+    }
+    NSUInteger existingIndex = [self indexOfEntityPassingTest:^BOOL(id<HKWMentionsEntityProtocol> storedEntity) {
+        return [[[self class] uniqueIdForEntity:storedEntity] isEqualToString:uniqueId];
+    }];
+    [self moveEntityToFront:entity fromIndex:existingIndex];
+}
+
+- (void)recordMention:(HKWMentionsAttribute *)mention {
+    NSString *entityId = [mention entityId];
+    if ([entityId length] == 0) {
+        return;
+    }
+    NSUInteger existingIndex = [self indexOfEntityPassingTest:^BOOL(id<HKWMentionsEntityProtocol> storedEntity) {
+        return [[storedEntity entityId] isEqualToString:entityId];
+    }];
+    id<HKWMentionsEntityProtocol> entity = (existingIndex != NSNotFound ? self.entities[existingIndex] : mention);
+    [self moveEntityToFront:entity fromIndex:existingIndex];
+}
+
+- (NSArray<id<HKWMentionsEntityProtocol>> *)entitiesMatchingKeyString:(NSString *)keyString {
+    NSMutableArray<id<HKWMentionsEntityProtocol>> *matches = [NSMutableArray array];
+    for (id<HKWMentionsEntityProtocol> entity in self.entities) {
+        if ([HKWMentionsTypeaheadCache entity:entity matchesKeyString:keyString]) {
+            [matches addObject:entity];
+        }
+    }
+    return [matches copy];
+}
+
+- (void)removeAllEntities {
+    [self.entities removeAllObjects];
+    NSURL *fileURL = self.fileURL;
+    if (!fileURL) {
+        return;
+    }
+    dispatch_async(self.saveQueue, ^{
+        [[NSFileManager defaultManager] removeItemAtURL:fileURL error:NULL];
+    });
+}
+
+#pragma mark - Private
+
++ (NSString *)uniqueIdForEntity:(id<HKWMentionsEntityProtocol>)entity {
+    if ([entity respondsToSelector:@selector(uniqueId)]) {
+        return [entity uniqueId];
+    }
+    return [entity entityId];
+}
+
+- (NSUInteger)indexOfEntityPassingTest:(BOOL (^)(id<HKWMentionsEntityProtocol>))test {
+    return [self.entities indexOfObjectPassingTest:^BOOL(id<HKWMentionsEntityProtocol> entity,
+                                                         __unused NSUInteger idx,
+                                                         __unused BOOL *stop) {
+        return test(entity);
+    }];
+}
+
+- (void)moveEntityToFront:(id<HKWMentionsEntityProtocol>)entity fromIndex:(NSUInteger)index {
+    NSMutableArray<id<HKWMentionsEntityProtocol>> *entities = self.entities;
+    if (index == 0 && entities[0] == entity) {
+        return;
+    }
+    if (index != NSNotFound) {
+        [entities removeObjectAtIndex:index];
+    }
+    [entities insertObject:entity atIndex:0];
+    while ([entities count] > self.capacity) {
+        [entities removeLastObject];
+    }
+    [self save];
+}
+
+- (NSMutableArray<id<HKWMentionsEntityProtocol>> *)entities {
+    if (!_entities) {
+        _entities = [self loadEntities];
+    }
+    return _entities;
+}
+
+/*!
+ Read the entities saved to the file, skipping any which are malformed.
+ */
+- (NSMutableArray<id<HKWMentionsEntityProtocol>> *)loadEntities {
+    NSMutableArray<id<HKWMentionsEntityProtocol>> *entities = [NSMutableArray arrayWithCapacity:self.capacity];
+    NSData *data = self.fileURL ? [NSData dataWithContentsOfURL:self.fileURL] : nil;
+    if (!data) {
+        return entities;
+    }
+    id propertyList = [NSPropertyListSerialization propertyListWithData:data
+                                                                options:NSPropertyListImmutable
+                                                                 format:NULL
+                                                                  error:NULL];
+    if (![propertyList isKindOfClass:[NSArray class]]) {
+        return entities;
+    }
+    for (NSDictionary *dictionary in (NSArray *)propertyList) {
+        if (![dictionary isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+        NSString *entityId = dictionary[HKWRecentEntityIdKey];
+        NSString *entityName = dictionary[HKWRecentEntityNameKey];
+        if (![entityId isKindOfClass:[NSString class]] || ![entityName isKindOfClass:[NSString class]]) {
+            continue;
+        }
+        NSString *uniqueId = dictionary[HKWRecentEntityUniqueIdKey];
+        NSDictionary *metadata = dictionary[HKWRecentEntityMetadataKey];
+        HKWMentionsStoredEntity *entity = [HKWMentionsStoredEntity new];
+        entity.storedEntityId = entityId;
+        entity.storedEntityName = entityName;
+        entity.storedUniqueId = [uniqueId isKindOfClass:[NSString class]] ? uniqueId : entityId;
+        entity.storedMetadata = [metadata isKindOfClass:[NSDictionary class]] ? metadata : @{};
+        [entities addObject:entity];
+        if ([entities count] == self.capacity) {
+            break;
+        }
+    }
+    return entities;
+}
+
+/*!
+ Write a snapshot of the stored entities to the file in the background, as a binary property list.
+ */
+- (void)save {
+    NSURL *fileURL = self.fileURL;
+    if (!fileURL) {
+        return;
+    }
+    NSMutableArray<NSDictionary *> *propertyList = [NSMutableArray arrayWithCapacity:[self.entities count]];
+    for (id<HKWMentionsEntityProtocol> entity in self.entities) {
+        NSString *entityId = [entity entityId];
+        NSString *entityName = [entity entityName];
+        if (!entityId || !entityName) {
+            continue;
+        }
+        NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:4];
+        dictionary[HKWRecentEntityIdKey] = entityId;
+        dictionary[HKWRecentEntityNameKey] = entityName;
+        NSString *uniqueId = [[self class] uniqueIdForEntity:entity];
+        if (uniqueId && ![uniqueId isEqualToString:entityId]) {
+            dictionary[HKWRecentEntityUniqueIdKey] = uniqueId;
+        }
+        NSDictionary *metadata = [entity entityMetadata];
+        if ([metadata count] > 0
+            && [NSPropertyListSerialization propertyList:metadata isValidForFormat:NSPropertyListBinaryFormat_v1_0]) {
+            dictionary[HKWRecentEntityMetadataKey] = metadata;
+        }
+        [propertyList addObject:dictionary];
+    }
+    dispatch_async(self.saveQueue, ^{
+        NSError *error = nil;
+        NSData *data = [NSPropertyListSerialization dataWithPropertyList:propertyList
+                                                                  format:NSPropertyListBinaryFormat_v1_0
+                                                                 options:0
+                                                                   error:&error];
+        if (!data || ![data writeToURL:fileURL options:NSDataWritingAtomic error:&error]) {
+            HKWLOG(@"  DEBUG: could not save recent entities: %@", error);
+        }
+    });
+}
+
+@end
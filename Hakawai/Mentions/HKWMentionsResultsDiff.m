@@ -0,0 +1,188 @@
+//
+//  HKWMentionsResultsDiff.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "_HKWMentionsResultsDiff.h"
+
+@interface HKWMentionsResultsDiff ()
+
+@property (nonatomic, readwrite) NSIndexSet *deletedRows;
+@property (nonatomic, readwrite) NSIndexSet *insertedRows;
+@property (nonatomic, readwrite) NSIndexSet *reloadedRows;
+@property (nonatomic, readwrite) NSArray<NSNumber *> *movedFromRows;
+@property (nonatomic, readwrite) NSArray<NSNumber *> *movedToRows;
+
+@end
+
+@implementation HKWMentionsResultsDiff
+
++ (instancetype)diffFromResults:(NSArray *)oldResults
+                      toResults:(NSArray *)newResults
+                       uniqueId:(NSString *(^)(id))uniqueIdBlock
+                    needsReload:(BOOL (^)(id, id))needsReloadBlock {
+    NSDictionary<NSString *, NSNumber *> *oldRows = [self rowsByUniqueIdForResults:oldResults uniqueId:uniqueIdBlock];
+    NSDictionary<NSString *, NSNumber *> *newRows = [self rowsByUniqueIdForResults:newResults uniqueId:uniqueIdBlock];
+    if (!oldRows || !newRows) {
+        return nil;
+    }
+    const NSUInteger oldCount = [oldResults count];
+    const NSUInteger newCount = [newResults count];
+
+    // For each new row, the old row of the same result, or NSNotFound if the result is new
+    NSUInteger *oldRowForNewRow = malloc(sizeof(NSUInteger) * MAX(newCount, (NSUInteger)1));
+    NSMutableIndexSet *deletedRows = [NSMutableIndexSet indexSet];
+    NSMutableIndexSet *insertedRows = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < oldCount; i++) {
+        if (!newRows[uniqueIdBlock(oldResults[i])]) {
+            [deletedRows addIndex:i];
+        }
+    }
+    for (NSUInteger i = 0; i < newCount; i++) {
+        NSNumber *oldRow = oldRows[uniqueIdBlock(newResults[i])];
+        oldRowForNewRow[i] = oldRow ? [oldRow unsignedIntegerValue] : NSNotFound;
+        if (!oldRow) {
+            [insertedRows addIndex:i];
+        }
+    }
+
+    // The common results which stay in place are those on a longest increasing run of old rows, taken in the order of
+    //  the new rows; every other common result has to move
+    NSIndexSet *stationaryNewRows = [self newRowsOfLongestIncreasingSubsequence:oldRowForNewRow count:newCount];
+    NSMutableIndexSet *reloadedRows = [NSMutableIndexSet indexSet];
+    NSMutableArray<NSNumber *> *movedFromRows = [NSMutableArray array];
+    NSMutableArray<NSNumber *> *movedToRows = [NSMutableArray array];
+    for (NSUInteger i = 0; i < newCount; i++) {
+        const NSUInteger oldRow = oldRowForNewRow[i];
+        if (oldRow == NSNotFound) {
+            continue;
+        }
+        const BOOL needsReload = needsReloadBlock(oldResults[oldRow], newResults[i]);
+        if ([stationaryNewRows containsIndex:i]) {
+            if (needsReload) {
+                [reloadedRows addIndex:oldRow];
+            }
+        } else if (needsReload) {
+            // A table view can't move and reload the same row in one batch
+            [deletedRows addIndex:oldRow];
+            [insertedRows addIndex:i];
+        } else {
+            [movedFromRows addObject:@(oldRow)];
+            [movedToRows addObject:@(i)];
+        }
+    }
+    free(oldRowForNewRow);
+
+    HKWMentionsResultsDiff *diff = [[self class] new];
+    diff.deletedRows = [deletedRows copy];
+    diff.insertedRows = [insertedRows copy];
+    diff.reloadedRows = [reloadedRows copy];
+    diff.movedFromRows = [movedFromRows copy];
+    diff.movedToRows = [movedToRows copy];
+    return diff;
+}
+
+- (BOOL)hasChanges {
+    return ([self.deletedRows count] > 0
+            || [self.insertedRows count] > 0
+            || [self.reloadedRows count] > 0
+            || [self.movedFromRows count] > 0);
+}
+
+- (void)applyToTableView:(UITableView *)tableView section:(NSInteger)section {
+    if ([self.deletedRows count] > 0) {
+        [tableView deleteRowsAtIndexPaths:[[self class] indexPathsForRows:self.deletedRows section:section]
+                         withRowAnimation:UITableViewRowAnimationNone];
+    }
+    if ([self.insertedRows count] > 0) {
+        [tableView insertRowsAtIndexPaths:[[self class] indexPathsForRows:self.insertedRows section:section]
+                         withRowAnimation:UITableViewRowAnimationNone];
+    }
+    if ([self.reloadedRows count] > 0) {
+        [tableView reloadRowsAtIndexPaths:[[self class] indexPathsForRows:self.reloadedRows section:section]
+                         withRowAnimation:UITableViewRowAnimationNone];
+    }
+    [self.movedFromRows enumerateObjectsUsingBlock:^(NSNumber *fromRow, NSUInteger i, __unused BOOL *stop) {
+        [tableView moveRowAtIndexPath:[NSIndexPath indexPathForRow:[fromRow integerValue] inSection:section]
+                          toIndexPath:[NSIndexPath indexPathForRow:[self.movedToRows[i] integerValue] inSection:section]];
+    }];
+}
+
+#pragma mark - Private
+
+/*!
+ Return the row of each result keyed by its unique ID, or nil if any result has no unique ID or shares it with another.
+ */
++ (NSDictionary<NSString *, NSNumber *> *)rowsByUniqueIdForResults:(NSArray *)results
+                                                          uniqueId:(NSString *(^)(id))uniqueIdBlock {
+    NSMutableDictionary<NSString *, NSNumber *> *rows = [NSMutableDictionary dictionaryWithCapacity:[results count]];
+    NSUInteger row = 0;
+    for (id result in results) {
+        NSString *uniqueId = uniqueIdBlock(result);
+        if ([uniqueId length] == 0 || rows[uniqueId]) {
+            return nil;
+        }
+        rows[uniqueId] = @(row);
+        row++;
+    }
+    return rows;
+}
+
+/*!
+ Return the positions in \c values making up a longest strictly increasing subsequence, ignoring \c NSNotFound values.
+ */
++ (NSIndexSet *)newRowsOfLongestIncreasingSubsequence:(const NSUInteger *)values count:(NSUInteger)count {
+    if (count == 0) {
+        return [NSIndexSet indexSet];
+    }
+    // tails[k] is the position of the smallest value ending an increasing subsequence of length k + 1
+    NSUInteger *tails = malloc(sizeof(NSUInteger) * count);
+    NSUInteger *predecessors = malloc(sizeof(NSUInteger) * count);
+    NSUInteger length = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        if (values[i] == NSNotFound) {
+            continue;
+        }
+        NSUInteger low = 0;
+        NSUInteger high = length;
+        while (low < high) {
+            NSUInteger middle = (low + high) / 2;
+            if (values[tails[middle]] < values[i]) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        predecessors[i] = (low > 0) ? tails[low - 1] : NSNotFound;
+        tails[low] = i;
+        if (low == length) {
+            length++;
+        }
+    }
+    NSMutableIndexSet *positions = [NSMutableIndexSet indexSet];
+    NSUInteger position = (length > 0) ? tails[length - 1] : NSNotFound;
+    while (position != NSNotFound) {
+        [positions addIndex:position];
+        position = predecessors[position];
+    }
+    free(tails);
+    free(predecessors);
+    return positions;
+}
+
++ (NSArray<NSIndexPath *> *)indexPathsForRows:(NSIndexSet *)rows section:(NSInteger)section {
+    NSMutableArray<NSIndexPath *> *indexPaths = [NSMutableArray arrayWithCapacity:[rows count]];
+    [rows enumerateIndexesUsingBlock:^(NSUInteger row, __unused BOOL *stop) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:(NSInteger)row inSection:section]];
+    }];
+    return indexPaths;
+}
+
+@end
@@ -0,0 +1,118 @@
+//
+//  HKWMentionsResultsMerger.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "_HKWMentionsResultsMerger.h"
+
+@interface HKWMentionsResultsMerger ()
+
+@property (nonatomic, copy) NSArray *leadingResults;
+@property (nonatomic, copy) NSString *_Nullable (^uniqueIdBlock)(id result);
+
+/// The results returned so far by each source, by index.
+@property (nonatomic, strong) NSMutableArray<NSArray *> *sourceResults;
+
+/// The indexes of the sources, in the order their results are merged.
+@property (nonatomic, copy) NSArray<NSNumber *> *sourceOrder;
+
+/// The results as they were last published, which later results are appended below.
+@property (nonatomic, copy) NSArray *publishedResults;
+
+/// The indexes of the sources which finalized their results or were dropped.
+@property (nonatomic, strong) NSMutableIndexSet *finishedSources;
+
+@property (nonatomic, readwrite) BOOL hasDroppedSources;
+
+@end
+
+@implementation HKWMentionsResultsMerger
+
+- (instancetype)initWithSourcePriorities:(NSArray<NSNumber *> *)priorities
+                          leadingResults:(NSArray *)leadingResults
+                                uniqueId:(NSString *(^)(id))uniqueIdBlock {
+    self = [super init];
+    if (self) {
+        _leadingResults = [leadingResults copy] ?: @[];
+        _uniqueIdBlock = [uniqueIdBlock copy];
+        _sourceResults = [NSMutableArray arrayWithCapacity:[priorities count]];
+        NSMutableArray<NSNumber *> *sourceOrder = [NSMutableArray arrayWithCapacity:[priorities count]];
+        for (NSUInteger i = 0; i < [priorities count]; i++) {
+            [_sourceResults addObject:@[]];
+            [sourceOrder addObject:@(i)];
+        }
+        // A stable sort keeps sources with the same priority in index order
+        _sourceOrder = [sourceOrder sortedArrayWithOptions:NSSortStable
+                                           usingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+            return [priorities[[b unsignedIntegerValue]] compare:priorities[[a unsignedIntegerValue]]];
+        }];
+        _finishedSources = [NSMutableIndexSet indexSet];
+        _publishedResults = @[];
+    }
+    return self;
+}
+
+#pragma mark - API
+
+- (NSArray *)results {
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:[self.publishedResults count]];
+    NSMutableSet<NSString *> *uniqueIds = [NSMutableSet setWithCapacity:[self.publishedResults count]];
+    void (^mergeResults)(NSArray *) = ^(NSArray *resultsToMerge) {
+        for (id result in resultsToMerge) {
+            NSString *uniqueId = self.uniqueIdBlock(result);
+            if ([uniqueId length] == 0 || [uniqueIds containsObject:uniqueId]) {
+                continue;
+            }
+            [uniqueIds addObject:uniqueId];
+            [results addObject:result];
+        }
+    };
+    // The published results keep their positions, and only the results not published yet are ordered by priority
+    mergeResults(self.publishedResults);
+    mergeResults(self.leadingResults);
+    for (NSNumber *index in self.sourceOrder) {
+        mergeResults(self.sourceResults[[index unsignedIntegerValue]]);
+    }
+    return [results copy];
+}
+
+- (BOOL)isComplete {
+    return [self.finishedSources count] == [self.sourceResults count];
+}
+
+- (void)addResults:(NSArray *)results fromSourceAtIndex:(NSUInteger)index isComplete:(BOOL)isComplete {
+    if ([self hasFinishedSourceAtIndex:index]) {
+        return;
+    }
+    if ([results count] > 0) {
+        self.sourceResults[index] = [self.sourceResults[index] arrayByAddingObjectsFromArray:results];
+    }
+    if (isComplete) {
+        [self.finishedSources addIndex:index];
+    }
+}
+
+- (void)markResultsAsPublished {
+    self.publishedResults = self.results;
+}
+
+- (void)dropSourceAtIndex:(NSUInteger)index {
+    if ([self hasFinishedSourceAtIndex:index]) {
+        return;
+    }
+    [self.finishedSources addIndex:index];
+    self.hasDroppedSources = YES;
+}
+
+- (BOOL)hasFinishedSourceAtIndex:(NSUInteger)index {
+    return [self.finishedSources containsIndex:index];
+}
+
+@end
@@ -12,6 +12,7 @@
 
 #import "HKWTextView.h"
 #import "_HKWMentionsStartDetectionStateMachine.h"
+#import "_HKWCharacterClassifier.h"
 
 #import "_HKWPrivateConstants.h"
 
@@ -52,9 +53,7 @@ typedef NS_ENUM(NSInteger, CharacterType) {
 
 @property (nonatomic, readonly) BOOL implicitMentionsEnabled;
 
-@property (nonatomic, strong, nonnull, class, readonly) NSCharacterSet *whitespaceSet;
-@property (nonatomic, strong, nonnull, class, readonly) NSCharacterSet *punctuationSet;
-@property (nonatomic, strong, nonnull, class, readonly) NSCharacterSet *separatorSet;
+@property (nonatomic, readonly, nonnull) HKWCharacterClassifier *characterClassifier;
 
 @end
 
@@ -130,6 +129,11 @@ wordFollowingTypedCharacter:(nullable NSString *)wordFollowingTypedCharacter {
     // Determine character types
     enum CharacterType currentCharacterType = [self characterTypeOfCharacter:c];
     enum CharacterType previousCharacterType = [self characterTypeOfCharacter:previousCharacter];
+    if (currentCharacterType == CharacterTypeControlCharacter
+        && self.state != HKWMentionsStartDetectionStateCreatingMention
+        && [delegate respondsToSelector:@selector(controlCharacterTyped:)]) {
+        [delegate controlCharacterTyped:c];
+    }
 
     // State transition
     switch (self.state) {
@@ -168,7 +172,7 @@ wordFollowingTypedCharacter:(nullable NSString *)wordFollowingTypedCharacter {
                                                   controlCharacter:c];
                 }
             }
-            else if ([HKWMentionsStartDetectionStateMachine.whitespaceSet characterIsMember:c]) {
+            else if ([self.characterClassifier character:c isInClass:HKWCharacterClassWhitespace]) {
                 // User typed a whitespace/newline. Reset the counter.
                 self.charactersSinceLastWhitespace = 0;
                 self.stringBuffer = [@"" mutableCopy];
@@ -209,7 +213,8 @@ withCharacterNowPrecedingCursor:(unichar)precedingChar
             BOOL canCreateMention = NO;
             if (location > 1 && textViewText.length > location - 2) {
                 const unichar characterBeforePrecedingChar = [textViewText characterAtIndex:location - 2];
-                canCreateMention = [HKWMentionsStartDetectionStateMachine.separatorSet characterIsMember:characterBeforePrecedingChar]
+                canCreateMention = [self.characterClassifier character:characterBeforePrecedingChar
+                                                             isInClass:HKWCharacterClassSeparator]
                 && precedingCharacterType == CharacterTypeControlCharacter;
             } else if (precedingCharacterType == CharacterTypeControlCharacter) {
                 canCreateMention = YES;
@@ -235,7 +240,7 @@ withCharacterNowPrecedingCursor:(unichar)precedingChar
                     [self.stringBuffer deleteCharactersInRange:NSMakeRange([self.stringBuffer length]-1, 1)];
                 }
             }
-            else if ([HKWMentionsStartDetectionStateMachine.whitespaceSet characterIsMember:precedingChar]) {
+            else if ([self.characterClassifier character:precedingChar isInClass:HKWCharacterClassWhitespace]) {
                 self.charactersSinceLastWhitespace = 0;
                 self.stringBuffer = [@"" mutableCopy];
             }
@@ -310,38 +315,35 @@ withCharacterNowPrecedingCursor:(unichar)precedingChar
  Returns nil if no non-delimeter text is available.
  */
 + (nullable NSString *)wordAfterLocation:(NSUInteger)location text:(nonnull NSString *)text {
-    NSMutableString *const word = [[NSMutableString alloc] init];
-    for(NSUInteger i = location; i < text.length ; i++) {
-        const unichar character = [text characterAtIndex:i];
-        if ([HKWMentionsStartDetectionStateMachine.whitespaceSet characterIsMember:character]) {
-            break;
-        }
-        [word appendString:[NSString stringWithCharacters:&character length:1]];
+    if (location >= [text length]) {
+        return nil;
     }
-    if (word.length == 0) {
+    NSUInteger end = [[HKWCharacterClassifier sharedClassifier] nextIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                                                                   inString:text
+                                                                                  fromIndex:location];
+    if (end == location) {
         return nil;
     }
-    return [word copy];
+    return [text substringWithRange:NSMakeRange(location, end - location)];
 }
 
 #pragma mark - Private helper method
 
 - (CharacterType)characterTypeOfCharacter:(unichar)aCharacter {
-    __auto_type __strong delegate = self.delegate;
-    CharacterType characterType = CharacterTypeNormal;
-    if ([HKWMentionsStartDetectionStateMachine.whitespaceSet characterIsMember:aCharacter] || aCharacter == 0) {
-        characterType = CharacterTypeSeparator;
-    } else {
-        // Check first for control character because control character can be a separator.
-        // e.g "@" and "#" are both control character and separator.
-        NSCharacterSet *const controlCharacterSet = [delegate controlCharacterSet];
-        if (controlCharacterSet && [controlCharacterSet characterIsMember:aCharacter]) {
-            characterType = CharacterTypeControlCharacter;
-        } else if ([HKWMentionsStartDetectionStateMachine.punctuationSet characterIsMember:aCharacter]) {
-            characterType = CharacterTypeSeparator;
-        }
+    if (aCharacter == 0) {
+        return CharacterTypeSeparator;
     }
-    return characterType;
+    const HKWCharacterClass characterClass = [self.characterClassifier classOfCharacter:aCharacter];
+    // Check for control character before punctuation because control character can be a separator.
+    // e.g "@" and "#" are both control character and separator.
+    if (characterClass & HKWCharacterClassWhitespace) {
+        return CharacterTypeSeparator;
+    } else if (characterClass & HKWCharacterClassControl) {
+        return CharacterTypeControlCharacter;
+    } else if (characterClass & HKWCharacterClassPunctuation) {
+        return CharacterTypeSeparator;
+    }
+    return CharacterTypeNormal;
 }
 
 #pragma mark - Properties and Constants
@@ -358,42 +360,10 @@ withCharacterNowPrecedingCursor:(unichar)precedingChar
 }
 
 /**
- Character set of whitespace and new line
- */
-+ (nonnull NSCharacterSet *)whitespaceSet {
-    static NSCharacterSet *whitespaceSet;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        whitespaceSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
-    });
-    return whitespaceSet;
-}
-
-/**
- Character set of punctuations
- */
-+ (nonnull NSCharacterSet *)punctuationSet {
-    static NSCharacterSet *punctuationSet;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        punctuationSet = [NSCharacterSet punctuationCharacterSet];
-    });
-    return punctuationSet;
-}
-
-/**
- Union set of whitespace set and punctuation set whose contents are treated as separators
- Mentions trigger after these separators
+ The delegate's character classifier, or the shared classifier (which has no control characters) if there is none
  */
-+ (nonnull NSCharacterSet *)separatorSet {
-    static NSCharacterSet *separatorSet;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        NSMutableCharacterSet *const mutableSeparatorSet = [HKWMentionsStartDetectionStateMachine.punctuationSet mutableCopy];
-        [mutableSeparatorSet formUnionWithCharacterSet:HKWMentionsStartDetectionStateMachine.whitespaceSet];
-        separatorSet = [mutableSeparatorSet copy];
-    });
-    return separatorSet;
+- (HKWCharacterClassifier *)characterClassifier {
+    return [self.delegate characterClassifier] ?: [HKWCharacterClassifier sharedClassifier];
 }
 
 
@@ -0,0 +1,172 @@
+//
+//  HKWMentionsTypeaheadCache.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "_HKWMentionsTypeaheadCache.h"
+
+#import "_HKWCharacterClassifier.h"
+
+/*!
+ The results stored for a single query.
+ */
+@interface HKWMentionsTypeaheadCacheEntry : NSObject
+@property (nonatomic, copy) NSArray<id<HKWMentionsEntityProtocol>> *results;
+@property (nonatomic) BOOL isComplete;
+@end
+
+@implementation HKWMentionsTypeaheadCacheEntry
+@end
+
+@interface HKWMentionsTypeaheadCache ()
+
+@property (nonatomic, readwrite) NSUInteger capacity;
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, HKWMentionsTypeaheadCacheEntry *> *entries;
+
+/// The keys of \c entries, ordered from least to most recently used.
+@property (nonatomic, strong) NSMutableOrderedSet<NSString *> *recentKeys;
+
+@end
+
+@implementation HKWMentionsTypeaheadCache
+
+- (instancetype)init {
+    return [self initWithCapacity:32];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _capacity = MAX(capacity, (NSUInteger)1);
+        _entries = [NSMutableDictionary dictionaryWithCapacity:_capacity];
+        _recentKeys = [NSMutableOrderedSet orderedSetWithCapacity:_capacity];
+    }
+    return self;
+}
+
+#pragma mark - API
+
+- (NSUInteger)count {
+    return [self.entries count];
+}
+
+- (void)setResults:(NSArray<id<HKWMentionsEntityProtocol>> *)results
+        isComplete:(BOOL)isComplete
+      forKeyString:(NSString *)keyString
+        searchType:(HKWMentionsSearchType)type
+  controlCharacter:(unichar)character {
+    NSString *key = [[self class] keyForKeyString:keyString searchType:type controlCharacter:character];
+    HKWMentionsTypeaheadCacheEntry *entry = [HKWMentionsTypeaheadCacheEntry new];
+    entry.results = results ?: @[];
+    entry.isComplete = isComplete;
+    self.entries[key] = entry;
+    [self markKeyAsRecentlyUsed:key];
+    while ([self.recentKeys count] > self.capacity) {
+        NSString *leastRecentlyUsedKey = [self.recentKeys firstObject];
+        [self.recentKeys removeObjectAtIndex:0];
+        [self.entries removeObjectForKey:leastRecentlyUsedKey];
+    }
+}
+
+- (NSArray<id<HKWMentionsEntityProtocol>> *)completeResultsForKeyString:(NSString *)keyString
+                                                             searchType:(HKWMentionsSearchType)type
+                                                       controlCharacter:(unichar)character {
+    HKWMentionsTypeaheadCacheEntry *entry = [self entryForKeyString:keyString searchType:type controlCharacter:character];
+    if (entry) {
+        return entry.isComplete ? entry.results : nil;
+    }
+    // Look for the longest prefix of the key string with complete results. An empty key string is never used as a
+    //  prefix, since the results for it are typically suggestions rather than matches.
+    for (NSUInteger prefixLength = [keyString length]; prefixLength > 1; prefixLength--) {
+        NSString *prefix = [keyString substringToIndex:prefixLength - 1];
+        HKWMentionsTypeaheadCacheEntry *prefixEntry = [self entryForKeyString:prefix
+                                                                   searchType:type
+                                                             controlCharacter:character];
+        if (!prefixEntry) {
+            continue;
+        }
+        if (!prefixEntry.isComplete) {
+            // A longer prefix is a better predictor of the results than a shorter one, even if it is incomplete.
+            return nil;
+        }
+        NSMutableArray<id<HKWMentionsEntityProtocol>> *refinedResults = [NSMutableArray array];
+        for (id<HKWMentionsEntityProtocol> candidate in prefixEntry.results) {
+            if ([[self class] entity:candidate matchesKeyString:keyString]) {
+                [refinedResults addObject:candidate];
+            }
+        }
+        [self setResults:refinedResults
+              isComplete:YES
+            forKeyString:keyString
+              searchType:type
+        controlCharacter:character];
+        return [refinedResults copy];
+    }
+    return nil;
+}
+
+- (void)removeAllResults {
+    [self.entries removeAllObjects];
+    [self.recentKeys removeAllObjects];
+}
+
++ (BOOL)entity:(id<HKWMentionsEntityProtocol>)entity matchesKeyString:(NSString *)keyString {
+    return [self rangeOfKeyString:keyString inName:[entity entityName]].location != NSNotFound;
+}
+
++ (NSRange)rangeOfKeyString:(NSString *)keyString inName:(NSString *)name {
+    if ([keyString length] == 0) {
+        return NSMakeRange(0, 0);
+    }
+    NSUInteger nameLength = [name length];
+    HKWCharacterClassifier *classifier = [HKWCharacterClassifier sharedClassifier];
+    const NSStringCompareOptions options = NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch;
+    NSRange searchRange = NSMakeRange(0, nameLength);
+    while (searchRange.length > 0) {
+        NSRange match = [name rangeOfString:keyString options:options range:searchRange];
+        if (match.location == NSNotFound) {
+            return match;
+        }
+        if (match.location == 0
+            || [classifier character:[name characterAtIndex:match.location - 1] isInClass:HKWCharacterClassSeparator]) {
+            return match;
+        }
+        searchRange = NSMakeRange(match.location + 1, nameLength - match.location - 1);
+    }
+    return NSMakeRange(NSNotFound, 0);
+}
+
++ (NSString *)keyForKeyString:(NSString *)keyString
+                   searchType:(HKWMentionsSearchType)type
+             controlCharacter:(unichar)character {
+    // The key string comes last, so that it can't be confused with the fixed-format fields before it
+    return [NSString stringWithFormat:@"%ld:%u:%@", (long)type, (unsigned int)character, keyString ?: @""];
+}
+
+#pragma mark - Private
+
+- (HKWMentionsTypeaheadCacheEntry *)entryForKeyString:(NSString *)keyString
+                                           searchType:(HKWMentionsSearchType)type
+                                     controlCharacter:(unichar)character {
+    NSString *key = [[self class] keyForKeyString:keyString searchType:type controlCharacter:character];
+    HKWMentionsTypeaheadCacheEntry *entry = self.entries[key];
+    if (entry) {
+        [self markKeyAsRecentlyUsed:key];
+    }
+    return entry;
+}
+
+- (void)markKeyAsRecentlyUsed:(NSString *)key {
+    [self.recentKeys removeObject:key];
+    [self.recentKeys addObject:key];
+}
+
+@end
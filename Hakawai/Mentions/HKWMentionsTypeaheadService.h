@@ -0,0 +1,55 @@
+//
+//  HKWMentionsTypeaheadService.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ A typeahead service which can be shared by several mentions plug-ins, such as those of the comment composers on a feed,
+ so that they don't each request the same queries from their default chooser view delegates.
+
+ While a query is being requested by one plug-in, other plug-ins making the same query (with the same search type and
+ control character) wait for its results instead of making their own request, and every page of results is passed to
+ all of them. The request is only canceled once every plug-in waiting for it no longer needs its results. If
+ \c HKWTextView.enableTypeaheadResultsCache is set, the plug-ins sharing the service also share its typeahead cache, which
+ outlives any single plug-in.
+
+ Requests are made through the default chooser view delegate of the plug-in which first makes a query, so a service must
+ only be shared by plug-ins whose default chooser view delegates return the same results for the same query. The service
+ must only be used from the main thread.
+ */
+@interface HKWMentionsTypeaheadService : NSObject
+
+/*!
+ Return the process-wide service.
+ */
++ (instancetype)sharedService;
+
+/*!
+ Return a new service whose typeahead cache holds the results of at most \c cacheCapacity queries.
+ */
+- (instancetype)initWithCacheCapacity:(NSUInteger)cacheCapacity;
+
+/*!
+ The number of queries being requested.
+ */
+@property (nonatomic, readonly) NSUInteger requestsInFlight;
+
+/*!
+ Discard all cached results, for example when the user signs out. Requests in flight are unaffected.
+ */
+- (void)removeAllResults;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,194 @@
+//
+//  HKWMentionsTypeaheadService.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "_HKWMentionsTypeaheadService.h"
+
+#import "_HKWMentionsPrivateConstants.h"
+
+/*!
+ A plug-in waiting for the results of a shared request.
+ */
+@interface HKWMentionsTypeaheadWaiter : NSObject
+@property (nonatomic, copy) HKWMentionsTypeaheadCompletion completion;
+@end
+
+@implementation HKWMentionsTypeaheadWaiter
+@end
+
+/*!
+ A single page of results received by a shared request.
+ */
+@interface HKWMentionsTypeaheadPage : NSObject
+@property (nonatomic, copy) NSArray *results;
+@property (nonatomic) BOOL dedupe;
+@end
+
+@implementation HKWMentionsTypeaheadPage
+@end
+
+/*!
+ A request made on behalf of every plug-in waiting for the results of the same query.
+ */
+@interface HKWMentionsSharedRequest : NSObject
+@property (nonatomic, strong) HKWMentionsCancellationToken *token;
+/// The pages received so far, passed again to plug-ins which start waiting for the request later.
+@property (nonatomic, strong) NSMutableArray<HKWMentionsTypeaheadPage *> *pages;
+@property (nonatomic, strong) NSMutableArray<HKWMentionsTypeaheadWaiter *> *waiters;
+@end
+
+@implementation HKWMentionsSharedRequest
+@end
+
+@interface HKWMentionsTypeaheadService ()
+
+@property (nonatomic, strong, readwrite) HKWMentionsTypeaheadCache *resultsCache;
+
+/// The requests in flight, keyed by the typeahead cache key of their query.
+@property (nonatomic, strong) NSMutableDictionary<NSString *, HKWMentionsSharedRequest *> *requests;
+
+@end
+
+@implementation HKWMentionsTypeaheadService
+
++ (instancetype)sharedService {
+    static HKWMentionsTypeaheadService *sharedService;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedService = [[self alloc] initWithCacheCapacity:128];
+    });
+    return sharedService;
+}
+
+- (instancetype)init {
+    return [self initWithCacheCapacity:128];
+}
+
+- (instancetype)initWithCacheCapacity:(NSUInteger)cacheCapacity {
+    self = [super init];
+    if (self) {
+        _resultsCache = [[HKWMentionsTypeaheadCache alloc] initWithCapacity:cacheCapacity];
+        _requests = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - API
+
+- (NSUInteger)requestsInFlight {
+    return [self.requests count];
+}
+
+- (void)removeAllResults {
+    [self.resultsCache removeAllResults];
+}
+
+- (void)retrieveEntitiesForKeyString:(NSString *)keyString
+                          searchType:(HKWMentionsSearchType)type
+                    controlCharacter:(unichar)character
+                   cancellationToken:(HKWMentionsCancellationToken *)cancellationToken
+                             request:(void (^)(HKWMentionsCancellationToken *, HKWMentionsTypeaheadCompletion))request
+                          completion:(HKWMentionsTypeaheadCompletion)completion {
+    NSString *key = [HKWMentionsTypeaheadCache keyForKeyString:keyString searchType:type controlCharacter:character];
+    HKWMentionsTypeaheadWaiter *waiter = [HKWMentionsTypeaheadWaiter new];
+    waiter.completion = completion;
+    HKWMentionsSharedRequest *sharedRequest = self.requests[key];
+    const BOOL joinsRequest = (sharedRequest != nil);
+    if (joinsRequest) {
+        HKWLOG(@"  DEBUG: coalescing request for '%@' (%lu waiting)",
+               keyString, (unsigned long)[sharedRequest.waiters count]);
+        [sharedRequest.waiters addObject:waiter];
+        for (HKWMentionsTypeaheadPage *page in [sharedRequest.pages copy]) {
+            completion(page.results, page.dedupe, NO);
+        }
+    } else {
+        sharedRequest = [HKWMentionsSharedRequest new];
+        sharedRequest.token = [HKWMentionsCancellationToken new];
+        sharedRequest.pages = [NSMutableArray array];
+        sharedRequest.waiters = [NSMutableArray arrayWithObject:waiter];
+        self.requests[key] = sharedRequest;
+    }
+    __weak typeof(self) weakSelf = self;
+    [cancellationToken addCancellationHandler:^{
+        [weakSelf performOnMainThread:^{
+            [weakSelf removeWaiter:waiter fromRequest:sharedRequest forKey:key];
+        }];
+    }];
+    if (joinsRequest || cancellationToken.cancelled) {
+        return;
+    }
+    request(sharedRequest.token, ^(NSArray *results, BOOL dedupe, BOOL isComplete) {
+        [weakSelf performOnMainThread:^{
+            [weakSelf handleResults:results dedupe:dedupe isComplete:isComplete forRequest:sharedRequest forKey:key];
+        }];
+    });
+}
+
+#pragma mark - Private
+
+/*!
+ Pass a page of results to every plug-in waiting for a shared request. An empty first page finalizes the results, as
+ it does for a request made by the plug-in itself.
+ */
+- (void)handleResults:(NSArray *)results
+               dedupe:(BOOL)dedupe
+           isComplete:(BOOL)isComplete
+           forRequest:(HKWMentionsSharedRequest *)sharedRequest
+               forKey:(NSString *)key {
+    if (self.requests[key] != sharedRequest) {
+        // The results were already finalized, or no plug-in is waiting for them anymore
+        return;
+    }
+    const BOOL isFinalPage = isComplete || ([sharedRequest.pages count] == 0 && [results count] == 0);
+    HKWMentionsTypeaheadPage *page = [HKWMentionsTypeaheadPage new];
+    page.results = results ?: @[];
+    page.dedupe = dedupe;
+    [sharedRequest.pages addObject:page];
+    if (isFinalPage) {
+        [self.requests removeObjectForKey:key];
+    }
+    NSArray<HKWMentionsTypeaheadWaiter *> *waiters = [sharedRequest.waiters copy];
+    if (isFinalPage) {
+        [sharedRequest.waiters removeAllObjects];
+    }
+    for (HKWMentionsTypeaheadWaiter *waiter in waiters) {
+        waiter.completion(results, dedupe, isFinalPage);
+    }
+}
+
+/*!
+ Stop passing the results of a shared request to a plug-in, and finalize its results. The request is canceled once no
+ plug-in is waiting for it.
+ */
+- (void)removeWaiter:(HKWMentionsTypeaheadWaiter *)waiter
+         fromRequest:(HKWMentionsSharedRequest *)sharedRequest
+              forKey:(NSString *)key {
+    if (![sharedRequest.waiters containsObject:waiter]) {
+        // The results were already finalized
+        return;
+    }
+    [sharedRequest.waiters removeObjectIdenticalTo:waiter];
+    if ([sharedRequest.waiters count] == 0 && self.requests[key] == sharedRequest) {
+        [self.requests removeObjectForKey:key];
+        [sharedRequest.token cancel];
+    }
+    waiter.completion(nil, NO, YES);
+}
+
+- (void)performOnMainThread:(void (^)(void))block {
+    if ([NSThread isMainThread]) {
+        block();
+    } else {
+        dispatch_async(dispatch_get_main_queue(), block);
+    }
+}
+
+@end
@@ -0,0 +1,67 @@
+//
+//  HKWMentionsTypeaheadSource.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "HKWMentionsDefaultChooserViewDelegate.h"
+
+/*!
+ A protocol describing an additional source of typeahead results, such as a people or company search service, which the
+ mentions plug-in queries alongside its default chooser view delegate.
+
+ Every query is sent to the default chooser view delegate and to all the registered sources at once, and the chooser is
+ updated as each of them answers. The results are merged in order of source priority, from highest to lowest, and then
+ in the order each source returned them; sources with the same priority keep the order they were registered in, after
+ the default chooser view delegate. An entity returned by more than one source is only shown once, where the source with
+ the highest priority placed it. Rows which are already shown keep their positions: results which arrive later are
+ merged among themselves in the same way, and appended below them.
+ */
+@protocol HKWMentionsTypeaheadSource <NSObject>
+
+/*!
+ Request the source to fetch results for a query. This method behaves like the method of the same name on
+ \c HKWMentionsDefaultChooserViewDelegate: the completion block may be called repeatedly to append results until it is
+ called with \c isComplete set to YES, and must be called even if the request fails or is canceled. It may be called on
+ any thread.
+
+ \param cancellationToken    a token which is canceled once the results of the request are no longer needed, either
+                             because a newer query was made or because the source missed its deadline
+ */
+- (void)asyncRetrieveEntitiesForKeyString:(nonnull NSString *)keyString
+                               searchType:(HKWMentionsSearchType)type
+                         controlCharacter:(unichar)character
+                        cancellationToken:(nonnull HKWMentionsCancellationToken *)cancellationToken
+                               completion:(void(^_Null_unspecified)(NSArray *_Null_unspecified results, BOOL dedupe, BOOL isComplete))completionBlock;
+
+@optional
+
+/*!
+ The priority of the source's results relative to those of other sources. The default chooser view delegate has a
+ priority of 0. Defaults to 0.
+ */
+@property (nonatomic, readonly) NSInteger sourcePriority;
+
+/*!
+ How long to wait after a query is requested before requesting it from the source, in addition to the delay applied by
+ the rate limit policy. If a newer query is made in the meantime, the source is never asked for the older one. Defaults
+ to 0.
+ */
+@property (nonatomic, readonly) NSTimeInterval sourceDebounceInterval;
+
+/*!
+ How long after a query is requested the source has to finalize its results, including its debounce interval. Once the
+ deadline passes, the request is canceled, any results returned later are ignored, and the results the source returned
+ before then are kept. If 0, the source has no deadline. Defaults to 0.
+ */
+@property (nonatomic, readonly) NSTimeInterval sourceTimeout;
+
+@end
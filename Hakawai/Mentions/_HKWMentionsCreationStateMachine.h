@@ -110,6 +110,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)fetchInitialMentions;
 
+/**
+ Set up the chooser view, and prefetch the results for an explicit mention with an empty prefix begun with the given
+ control character, so that the chooser opens with results as soon as the character is typed. Only takes effect if
+ there is a data provider and \c HKWTextView.enableTypeaheadResultsCache is set.
+ */
+- (void)prefetchInitialResultsForControlCharacter:(unichar)character;
+
+/**
+ Perform \c prefetchInitialResultsForControlCharacter: for each of the given control characters in the Basic
+ Multilingual Plane.
+ */
+- (void)prefetchInitialResultsForControlCharacters:(NSCharacterSet *)controlCharacters;
+
 /**
  Get the chooser view frame. If the chooser view has not yet been instantiated, returns the nil rectangle.
  */
@@ -145,6 +158,13 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)reloadChooserView;
 
+/**
+ Apply incremental changes to the results chooser view, or reload it if it doesn't support incremental changes.
+ \c updates must update the results data before making the table view changes; it is passed nil if the chooser view is
+ reloaded instead.
+ */
+- (void)updateChooserViewWithBatchUpdates:(void (^)(UITableView *tableView))updates;
+
 /**
  Return a new, initialized state machine instance, and let it know whether we are using a custom chooser view or not
  */
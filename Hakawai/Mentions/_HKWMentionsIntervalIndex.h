@@ -0,0 +1,82 @@
+//
+//  HKWMentionsIntervalIndex.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+@class HKWMentionsAttribute;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ A sorted, non-overlapping index of the mention spans within an attributed string. Each span is a maximal run of text
+ whose \c HKWMentionAttributeName attribute holds equal \c HKWMentionsAttribute objects, mirroring the longest
+ effective range semantics the mentions plug-in relied on when it scanned the text directly.
+
+ Point and range queries are answered by binary search in O(log n + k). After the backing text is edited, call
+ \c updateForEditedRange:changeInLength:inAttributedString: so that only the neighborhood of the edit is rescanned. The
+ spans after the edit are shifted lazily, so an edit costs O(log n) plus the number of spans between it and the
+ previous edit.
+ */
+@interface HKWMentionsIntervalIndex : NSObject
+
+/*!
+ Whether the index currently reflects its backing text. An invalid index ignores incremental updates and must be
+ rebuilt before it is queried.
+ */
+@property (nonatomic, readonly) BOOL isValid;
+
+/*!
+ The number of mention spans in the index.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ Discard all spans and rebuild the index by scanning the entire attributed string.
+ */
+- (void)rebuildFromAttributedString:(NSAttributedString *)attributedString;
+
+/*!
+ Mark the index as stale. The next query made through the mentions plug-in will rebuild it.
+ */
+- (void)invalidate;
+
+/*!
+ Bring the index up to date after an edit to its backing text.
+
+ \param editedRange         the range of the edited text, in post-edit coordinates
+ \param delta               the change in length of the backing text caused by the edit
+ \param attributedString    the backing text, after the edit was applied
+ */
+- (void)updateForEditedRange:(NSRange)editedRange
+              changeInLength:(NSInteger)delta
+          inAttributedString:(NSAttributedString *)attributedString;
+
+/*!
+ Return the mention whose span contains \c location, or nil if there is none. If \c range is not NULL and a mention is
+ found, it is populated with the span of the mention.
+ */
+- (nullable HKWMentionsAttribute *)mentionAtLocation:(NSUInteger)location range:(nullable NSRangePointer)range;
+
+/*!
+ Enumerate, in ascending order, the spans that intersect the given range. A zero-length range intersects no spans.
+ */
+- (void)enumerateMentionsIntersectingRange:(NSRange)range
+                                usingBlock:(void (^)(HKWMentionsAttribute *mention, NSRange range, BOOL *stop))block;
+
+/*!
+ Enumerate every span in the index in ascending order.
+ */
+- (void)enumerateMentionsUsingBlock:(void (^)(HKWMentionsAttribute *mention, NSRange range, BOOL *stop))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,60 @@
+//
+//  _HKWMentionsResultsDiff.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ The row changes which turn one list of typeahead results into another, so that the chooser's table view can be
+ updated in place instead of reloaded. Results are matched up by their unique IDs. Results present in both lists are
+ only moved if their order relative to the other common results changed, and only reloaded if the caller says their
+ cells would look different.
+ */
+@interface HKWMentionsResultsDiff : NSObject
+
+/// Rows of the old results which are removed.
+@property (nonatomic, readonly) NSIndexSet *deletedRows;
+
+/// Rows of the new results which are added.
+@property (nonatomic, readonly) NSIndexSet *insertedRows;
+
+/// Rows of the old results which are kept in place, but whose cells must be recreated.
+@property (nonatomic, readonly) NSIndexSet *reloadedRows;
+
+/// Rows of the old results which are moved, and the rows of the new results they are moved to.
+@property (nonatomic, readonly) NSArray<NSNumber *> *movedFromRows;
+@property (nonatomic, readonly) NSArray<NSNumber *> *movedToRows;
+
+/// Whether applying the diff changes anything.
+@property (nonatomic, readonly) BOOL hasChanges;
+
+/*!
+ Return the diff between two lists of results, or nil if the unique IDs within either list aren't unique, in which
+ case the lists can't be diffed.
+
+ \param uniqueIdBlock      returns the unique ID of a result
+ \param needsReloadBlock   returns whether the cell for a result present in both lists must be recreated
+ */
++ (nullable instancetype)diffFromResults:(NSArray *)oldResults
+                               toResults:(NSArray *)newResults
+                                uniqueId:(NSString *_Nullable (^)(id result))uniqueIdBlock
+                             needsReload:(BOOL (^)(id oldResult, id newResult))needsReloadBlock;
+
+/*!
+ Make the row changes in a section of a table view. Must be called within a batch of table view updates.
+ */
+- (void)applyToTableView:(UITableView *)tableView section:(NSInteger)section;
+
+@end
+
+NS_ASSUME_NONNULL_END
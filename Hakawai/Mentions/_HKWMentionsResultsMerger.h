@@ -0,0 +1,70 @@
+//
+//  _HKWMentionsResultsMerger.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ Merges the typeahead results several sources return for a single query, as each of them answers. The merged results
+ begin with the leading results, followed by the results of each source in order of descending priority; sources with
+ the same priority are kept in index order. Results are matched up by their unique IDs, and only the first occurrence
+ of each is kept.
+
+ Once results have been published, they keep their positions: results which arrive later are merged by priority among
+ themselves and appended below the published ones, so that a late answer from a higher priority source doesn't move the
+ rows the user may be about to tap.
+ */
+@interface HKWMentionsResultsMerger : NSObject
+
+/// The merged results of all sources so far, beginning with the published results.
+@property (nonatomic, readonly) NSArray *results;
+
+/// Whether every source has either finalized its results or been dropped.
+@property (nonatomic, readonly) BOOL isComplete;
+
+/// Whether any source was dropped before finalizing its results.
+@property (nonatomic, readonly) BOOL hasDroppedSources;
+
+/*!
+ Return a merger for as many sources as there are priorities.
+
+ \param leadingResults    results which are shown before those of any source, or nil
+ \param uniqueIdBlock     returns the unique ID of a result
+ */
+- (instancetype)initWithSourcePriorities:(NSArray<NSNumber *> *)priorities
+                          leadingResults:(nullable NSArray *)leadingResults
+                                uniqueId:(NSString *_Nullable (^)(id result))uniqueIdBlock;
+
+/*!
+ Append a page of results from a source. Has no effect if the source already finalized its results or was dropped.
+ */
+- (void)addResults:(NSArray *)results fromSourceAtIndex:(NSUInteger)index isComplete:(BOOL)isComplete;
+
+/*!
+ Record the current results as published, so that their order no longer changes as more results arrive.
+ */
+- (void)markResultsAsPublished;
+
+/*!
+ Stop accepting results from a source which hasn't finalized its results, keeping those it already returned.
+ */
+- (void)dropSourceAtIndex:(NSUInteger)index;
+
+/*!
+ Return whether a source has either finalized its results or been dropped.
+ */
+- (BOOL)hasFinishedSourceAtIndex:(NSUInteger)index;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -12,6 +12,8 @@
 
 #import <Foundation/Foundation.h>
 
+@class HKWCharacterClassifier;
+
 @protocol HKWMentionsStartDetectionStateMachineProtocol <NSObject>
 
 /*!
@@ -19,6 +21,12 @@
  */
 - (NSCharacterSet *)controlCharacterSet;
 
+/*!
+ Return a character classifier whose control class matches \c controlCharacterSet. The state machine classifies every
+ typed or deleted character with it, so the delegate should keep it around until its control character set changes.
+ */
+- (HKWCharacterClassifier *)characterClassifier;
+
 /*!
  Return the number of characters to wait before beginning an 'implicit' mention. If this is 0 or negative, implicit
  mentions will not be supported.
@@ -60,6 +68,14 @@
                   usingControlCharacter:(BOOL)usingControlCharacter
                        controlCharacter:(unichar)character;
 
+@optional
+
+/*!
+ Inform the delegate that the user typed a control character while no mention was being created, whether or not it
+ begins one. If it does, this is called before \c beginMentionsCreationWithString:alreadyInserted:... is.
+ */
+- (void)controlCharacterTyped:(unichar)character;
+
 @end
 
 /*!
@@ -0,0 +1,92 @@
+//
+//  _HKWMentionsTypeaheadCache.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <UIKit/UIKit.h>
+
+#import "HKWMentionsDefaultChooserViewDelegate.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ A least-recently-used cache of typeahead results, keyed by the key string, search type and control character of the
+ query that produced them.
+
+ Results which the data source marked as complete can also answer queries that extend the query they were returned
+ for: typing "Jo", "Joh" and "John" requires results only for "Jo" if those results were complete, since the results
+ for the longer queries are filtered locally out of them.
+ */
+@interface HKWMentionsTypeaheadCache : NSObject
+
+/*!
+ The maximum number of queries whose results are retained.
+ */
+@property (nonatomic, readonly) NSUInteger capacity;
+
+/*!
+ The number of queries whose results are currently retained.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/*!
+ Return a new cache which retains the results of at most \c capacity queries.
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+/*!
+ Store the results for a query, replacing any results previously stored for it. If the cache is full, the results of
+ the least recently used query are evicted.
+
+ \param isComplete    whether \c results are all the results the data source will return for the query
+ */
+- (void)setResults:(NSArray<id<HKWMentionsEntityProtocol>> *)results
+        isComplete:(BOOL)isComplete
+      forKeyString:(NSString *)keyString
+        searchType:(HKWMentionsSearchType)type
+  controlCharacter:(unichar)character;
+
+/*!
+ Return the complete results for a query, or nil if they aren't known. The results are either those stored for the
+ query itself, or the results stored for the longest non-empty prefix of the key string, filtered down to the entities
+ which match the full key string. In the latter case the filtered results are also stored for the query.
+ */
+- (nullable NSArray<id<HKWMentionsEntityProtocol>> *)completeResultsForKeyString:(NSString *)keyString
+                                                                      searchType:(HKWMentionsSearchType)type
+                                                                controlCharacter:(unichar)character;
+
+/*!
+ Discard all stored results.
+ */
+- (void)removeAllResults;
+
+/*!
+ Return whether an entity returned for a shorter query should also be shown for \c keyString. This is the case if any
+ word in the entity's name begins with \c keyString, ignoring case and diacritics.
+ */
++ (BOOL)entity:(id<HKWMentionsEntityProtocol>)entity matchesKeyString:(NSString *)keyString;
+
+/*!
+ Return the range of the first occurrence of \c keyString at the beginning of a word in \c name, ignoring case and
+ diacritics, or a range with location \c NSNotFound if there is none. An empty key string matches at the beginning of
+ the name.
+ */
++ (NSRange)rangeOfKeyString:(NSString *)keyString inName:(NSString *)name;
+
+/*!
+ Return the key under which the results for a query are stored.
+ */
++ (NSString *)keyForKeyString:(NSString *)keyString
+                   searchType:(HKWMentionsSearchType)type
+             controlCharacter:(unichar)character;
+
+@end
+
+NS_ASSUME_NONNULL_END
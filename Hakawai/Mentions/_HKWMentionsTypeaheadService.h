@@ -0,0 +1,46 @@
+//
+//  _HKWMentionsTypeaheadService.h
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import "HKWMentionsTypeaheadService.h"
+
+#import "HKWMentionsDefaultChooserViewDelegate.h"
+#import "_HKWMentionsTypeaheadCache.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The completion block of a typeahead request, as passed to the default chooser view delegate.
+typedef void (^HKWMentionsTypeaheadCompletion)(NSArray *_Nullable results, BOOL dedupe, BOOL isComplete);
+
+@interface HKWMentionsTypeaheadService ()
+
+/// The typeahead cache shared by the plug-ins using the service.
+@property (nonatomic, strong, readonly) HKWMentionsTypeaheadCache *resultsCache;
+
+/*!
+ Request a query on behalf of a plug-in. If the same query is already being requested, the results it received so far
+ are passed to \c completion right away, and the results it receives later as they arrive; otherwise, \c request is
+ called to make the request, with a token which is canceled once no plug-in needs its results anymore.
+
+ If \c cancellationToken is canceled before the results are finalized, \c completion is called with nil and the plug-in
+ stops waiting for the request. \c completion is always called on the main thread.
+ */
+- (void)retrieveEntitiesForKeyString:(NSString *)keyString
+                          searchType:(HKWMentionsSearchType)type
+                    controlCharacter:(unichar)character
+                   cancellationToken:(HKWMentionsCancellationToken *)cancellationToken
+                             request:(void (^)(HKWMentionsCancellationToken *sharedToken,
+                                               HKWMentionsTypeaheadCompletion sharedCompletion))request
+                          completion:(HKWMentionsTypeaheadCompletion)completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,177 @@
+//
+//  HKWAbstractionLayerTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "HKWAbstractionLayer.h"
+
+@interface HKWAbstractionLayer ()
+@property (nonatomic, strong) NSAttributedString *acceptedTextSnapshot;
+@end
+
+@interface HKWTChangeRejectingDelegate : NSObject <HKWAbstractionLayerDelegate>
+@property (nonatomic) BOOL shouldAcceptChanges;
+@property (nonatomic) NSUInteger changeCount;
+@property (nonatomic, copy) NSString *lastText;
+@end
+
+@implementation HKWTChangeRejectingDelegate
+
+- (BOOL)textView:(__unused UITextView *)textView
+    textInserted:(NSString *)text
+      atLocation:(__unused NSUInteger)location
+     autocorrect:(__unused BOOL)autocorrect {
+    self.changeCount++;
+    self.lastText = text;
+    return self.shouldAcceptChanges;
+}
+
+- (BOOL)textView:(__unused UITextView *)textView
+textDeletedFromLocation:(__unused NSUInteger)location
+          length:(__unused NSUInteger)length {
+    self.changeCount++;
+    self.lastText = nil;
+    return self.shouldAcceptChanges;
+}
+
+- (BOOL)textView:(__unused UITextView *)textView replacedTextAtRange:(__unused NSRange)replacementRange
+         newText:(NSString *)newText
+     autocorrect:(__unused BOOL)autocorrect {
+    self.changeCount++;
+    self.lastText = newText;
+    return self.shouldAcceptChanges;
+}
+
+@end
+
+SpecBegin(abstractionLayerChangeRejection)
+
+describe(@"change rejection", ^{
+    __block UITextView *textView;
+    __block HKWAbstractionLayer *layer;
+    __block HKWTChangeRejectingDelegate *delegate;
+
+    // Drive the layer the way UITextView drives it: the text view asks whether it should change its text, makes the
+    //  change, then reports the selection change and the text change.
+    void (^shouldChange)(NSRange, NSString *) = ^(NSRange range, NSString *text) {
+        [layer textViewShouldChangeTextInRange:range replacementText:text wasPaste:NO];
+    };
+    void (^makeChange)(NSRange, NSString *) = ^(NSRange range, NSString *text) {
+        [textView.textStorage replaceCharactersInRange:range withString:text];
+        [layer textViewDidChangeSelection];
+    };
+    void (^typeText)(NSRange, NSString *) = ^(NSRange range, NSString *text) {
+        shouldChange(range, text);
+        makeChange(range, text);
+        [layer textViewDidChange];
+    };
+
+    beforeEach(^{
+        textView = [[UITextView alloc] initWithFrame:CGRectMake(0, 0, 320, 100)];
+        textView.text = @"Hello";
+        layer = [HKWAbstractionLayer instanceWithTextView:textView changeRejection:YES];
+        delegate = [HKWTChangeRejectingDelegate new];
+        layer.delegate = delegate;
+    });
+
+    it(@"should keep an accepted insertion", ^{
+        delegate.shouldAcceptChanges = YES;
+        typeText(NSMakeRange(5, 0), @"!");
+        expect(delegate.changeCount).to.equal(1);
+        expect(delegate.lastText).to.equal(@"!");
+        expect(textView.text).to.equal(@"Hello!");
+
+        // The accepted text is what the next rejection rolls back to
+        delegate.shouldAcceptChanges = NO;
+        typeText(NSMakeRange(6, 0), @"?");
+        expect(textView.text).to.equal(@"Hello!");
+    });
+
+    it(@"should roll back rejected insertions, deletions, and replacements", ^{
+        delegate.shouldAcceptChanges = NO;
+        typeText(NSMakeRange(5, 0), @"!");
+        expect(textView.text).to.equal(@"Hello");
+
+        typeText(NSMakeRange(1, 3), @"");
+        expect(textView.text).to.equal(@"Hello");
+
+        typeText(NSMakeRange(0, 5), @"Goodbye");
+        expect(textView.text).to.equal(@"Hello");
+        expect(delegate.changeCount).to.equal(3);
+    });
+
+    it(@"should roll back a space which was turned into a period", ^{
+        delegate.shouldAcceptChanges = YES;
+        typeText(NSMakeRange(5, 0), @" ");
+        expect(textView.text).to.equal(@"Hello ");
+
+        // Typing a second space asks to insert it, but the text view replaces the first space with ". " instead
+        delegate.shouldAcceptChanges = NO;
+        shouldChange(NSMakeRange(6, 0), @" ");
+        shouldChange(NSMakeRange(5, 1), @". ");
+        makeChange(NSMakeRange(5, 1), @". ");
+        [layer textViewDidChange];
+        expect(delegate.lastText).to.equal(@". ");
+        expect(textView.text).to.equal(@"Hello ");
+    });
+
+    it(@"should fall back to a snapshot once an editing run outgrows the journal", ^{
+        // A predictive suggestion followed by further text extends the same editing run; do that until the run has
+        //  made more edits than the journal holds
+        delegate.shouldAcceptChanges = NO;
+        for (NSUInteger i = 0; i < 70; i++) {
+            NSRange range = NSMakeRange([textView.text length], 0);
+            shouldChange(range, @"a");
+            makeChange(range, @"a");
+        }
+        expect(layer.acceptedTextSnapshot.string).to.equal(@"Hello");
+        expect([textView.text length]).to.equal(75);
+
+        [layer textViewDidChange];
+        expect(delegate.changeCount).to.equal(1);
+        expect(textView.text).to.equal(@"Hello");
+        expect(layer.acceptedTextSnapshot).to.beNil();
+
+        // The journal is used again for the next editing run
+        typeText(NSMakeRange(5, 0), @"!");
+        expect(textView.text).to.equal(@"Hello");
+    });
+
+    it(@"should leave the text alone if it was changed outside the journal", ^{
+        // Change the text without telling the layer
+        [textView.textStorage replaceCharactersInRange:NSMakeRange(5, 0) withString:@" world"];
+
+        delegate.shouldAcceptChanges = NO;
+        typeText(NSMakeRange(11, 0), @"!");
+        expect(delegate.changeCount).to.equal(1);
+        expect(textView.text).to.equal(@"Hello world!");
+
+        // The text as it was left is accepted, so the next rejection can be rolled back again
+        typeText(NSMakeRange(12, 0), @"?");
+        expect(textView.text).to.equal(@"Hello world!");
+    });
+
+    it(@"should not treat programmatic changes as untracked", ^{
+        [layer pushIgnore];
+        textView.text = @"Hello world";
+        [layer popIgnore];
+
+        delegate.shouldAcceptChanges = NO;
+        typeText(NSMakeRange(11, 0), @"!");
+        expect(textView.text).to.equal(@"Hello world");
+    });
+});
+
+SpecEnd
@@ -0,0 +1,260 @@
+//
+//  HKWLayoutManagerPerformanceTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#import <XCTest/XCTest.h>
+
+#import "HKWTextView.h"
+#import "_HKWLayoutManager.h"
+#import "HKWCustomAttributes.h"
+#import "HKWRoundedRectBackgroundAttributeValue.h"
+
+/// The size of the viewport the documents are drawn into, as on a phone in portrait.
+static const CGSize HKWTViewportSize = {320, 568};
+
+/// The distance scrolled between each partial redraw.
+static const CGFloat HKWTScrollStep = 120;
+
+/// The state of the layout manager's rounded rect geometry cache when each measurement starts.
+typedef NS_ENUM(NSInteger, HKWTGeometryCacheState) {
+    /// The cache is emptied before each measurement, so every run's geometry is computed while measuring.
+    HKWTGeometryCacheStateCold,
+    /// The cache is filled by an unmeasured draw beforehand, so every run's geometry is taken from it.
+    HKWTGeometryCacheStateWarm,
+};
+
+@interface HKWLayoutManager ()
+@property (nonatomic, strong) NSMutableDictionary *roundedRectGeometryCache;
+@end
+
+/*!
+ Measure how long \c HKWLayoutManager takes to draw the rounded rect backgrounds of documents of various lengths, and
+ how much memory it uses doing so. Every other run of each document wraps across lines, unless the runs are too close
+ together to allow it.
+
+ Each test draws into an offscreen bitmap context the size of the viewport. Full redraws draw every glyph of the
+ document, as when the text view is first shown; scrolled redraws draw the glyphs within the viewport as it scrolls from
+ the top of the document to the bottom, as the text view does while the user scrolls. The layout of the document is
+ completed before measuring, and the bitmap context is created outside of each measurement, so only drawing is
+ measured. Cold tests empty the geometry cache before every measurement, as when the text view is first shown or its
+ text has just changed; warm tests draw with a filled cache, as when the same text is redrawn.
+
+ No baselines are checked in yet, so the suite reports its measurements without failing on regressions. Baselines
+ should be recorded through Xcode on the device the suite runs on in CI, and kept with the shared scheme.
+ */
+@interface HKWLayoutManagerPerformanceTests : XCTestCase
+@property (nonatomic, strong) HKWTextView *textView;
+@end
+
+@implementation HKWLayoutManagerPerformanceTests
+
+- (void)tearDown {
+    self.textView = nil;
+    [super tearDown];
+}
+
+#pragma mark - Full redraws, cold cache
+
+- (void)testFullRedraw1kCharacters10RunsColdCache {
+    [self measureFullRedrawsOfDocumentWithLength:1000 runCount:10 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testFullRedraw1kCharacters100RunsColdCache {
+    [self measureFullRedrawsOfDocumentWithLength:1000 runCount:100 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testFullRedraw10kCharacters10RunsColdCache {
+    [self measureFullRedrawsOfDocumentWithLength:10000 runCount:10 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testFullRedraw10kCharacters500RunsColdCache {
+    [self measureFullRedrawsOfDocumentWithLength:10000 runCount:500 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testFullRedraw100kCharacters100RunsColdCache {
+    [self measureFullRedrawsOfDocumentWithLength:100000 runCount:100 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testFullRedraw100kCharacters2000RunsColdCache {
+    [self measureFullRedrawsOfDocumentWithLength:100000 runCount:2000 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+#pragma mark - Full redraws, warm cache
+
+- (void)testFullRedraw1kCharacters10RunsWarmCache {
+    [self measureFullRedrawsOfDocumentWithLength:1000 runCount:10 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testFullRedraw1kCharacters100RunsWarmCache {
+    [self measureFullRedrawsOfDocumentWithLength:1000 runCount:100 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testFullRedraw10kCharacters10RunsWarmCache {
+    [self measureFullRedrawsOfDocumentWithLength:10000 runCount:10 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testFullRedraw10kCharacters500RunsWarmCache {
+    [self measureFullRedrawsOfDocumentWithLength:10000 runCount:500 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testFullRedraw100kCharacters100RunsWarmCache {
+    [self measureFullRedrawsOfDocumentWithLength:100000 runCount:100 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testFullRedraw100kCharacters2000RunsWarmCache {
+    [self measureFullRedrawsOfDocumentWithLength:100000 runCount:2000 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+#pragma mark - Scrolled redraws, cold cache
+
+- (void)testScrolledRedraw1kCharacters10RunsColdCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:1000 runCount:10 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testScrolledRedraw1kCharacters100RunsColdCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:1000 runCount:100 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testScrolledRedraw10kCharacters10RunsColdCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:10000 runCount:10 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testScrolledRedraw10kCharacters500RunsColdCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:10000 runCount:500 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testScrolledRedraw100kCharacters100RunsColdCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:100000 runCount:100 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+- (void)testScrolledRedraw100kCharacters2000RunsColdCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:100000 runCount:2000 geometryCacheState:HKWTGeometryCacheStateCold];
+}
+
+#pragma mark - Scrolled redraws, warm cache
+
+- (void)testScrolledRedraw1kCharacters10RunsWarmCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:1000 runCount:10 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testScrolledRedraw1kCharacters100RunsWarmCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:1000 runCount:100 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testScrolledRedraw10kCharacters10RunsWarmCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:10000 runCount:10 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testScrolledRedraw10kCharacters500RunsWarmCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:10000 runCount:500 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testScrolledRedraw100kCharacters100RunsWarmCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:100000 runCount:100 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+- (void)testScrolledRedraw100kCharacters2000RunsWarmCache {
+    [self measureScrolledRedrawsOfDocumentWithLength:100000 runCount:2000 geometryCacheState:HKWTGeometryCacheStateWarm];
+}
+
+#pragma mark - Helpers
+
+- (void)measureFullRedrawsOfDocumentWithLength:(NSUInteger)length
+                                      runCount:(NSUInteger)runCount
+                            geometryCacheState:(HKWTGeometryCacheState)cacheState {
+    HKWLayoutManager *layoutManager = [self layoutManagerForDocumentWithLength:length runCount:runCount];
+    NSRange glyphRange = NSMakeRange(0, layoutManager.numberOfGlyphs);
+    [self measureDrawingWithLayoutManager:layoutManager geometryCacheState:cacheState block:^{
+        [layoutManager drawBackgroundForGlyphRange:glyphRange atPoint:CGPointZero];
+    }];
+}
+
+- (void)measureScrolledRedrawsOfDocumentWithLength:(NSUInteger)length
+                                          runCount:(NSUInteger)runCount
+                                geometryCacheState:(HKWTGeometryCacheState)cacheState {
+    HKWLayoutManager *layoutManager = [self layoutManagerForDocumentWithLength:length runCount:runCount];
+    NSTextContainer *container = self.textView.textContainer;
+    CGFloat documentHeight = CGRectGetMaxY([layoutManager usedRectForTextContainer:container]);
+    [self measureDrawingWithLayoutManager:layoutManager geometryCacheState:cacheState block:^{
+        for (CGFloat offset = 0; offset < documentHeight; offset += HKWTScrollStep) {
+            CGRect viewport = CGRectMake(0, offset, HKWTViewportSize.width, HKWTViewportSize.height);
+            NSRange glyphRange = [layoutManager glyphRangeForBoundingRect:viewport inTextContainer:container];
+            [layoutManager drawBackgroundForGlyphRange:glyphRange atPoint:CGPointMake(0, -offset)];
+        }
+    }];
+}
+
+/*!
+ Measure the time and the memory taken by \c block separately, drawing into a fresh offscreen bitmap context each time.
+ The geometry cache of \c layoutManager is put into \c cacheState before every measurement, since it would otherwise
+ be filled by the first one.
+ */
+- (void)measureDrawingWithLayoutManager:(HKWLayoutManager *)layoutManager
+                     geometryCacheState:(HKWTGeometryCacheState)cacheState
+                                  block:(void (^)(void))block {
+    if (cacheState == HKWTGeometryCacheStateWarm) {
+        UIGraphicsBeginImageContextWithOptions(HKWTViewportSize, NO, 1);
+        block();
+        UIGraphicsEndImageContext();
+    }
+    void (^drawBlock)(void) = ^{
+        UIGraphicsBeginImageContextWithOptions(HKWTViewportSize, NO, 1);
+        if (cacheState == HKWTGeometryCacheStateCold) {
+            [layoutManager.roundedRectGeometryCache removeAllObjects];
+        }
+        [self startMeasuring];
+        block();
+        [self stopMeasuring];
+        UIGraphicsEndImageContext();
+    };
+    if (@available(iOS 13.0, *)) {
+        XCTMeasureOptions *options = [XCTMeasureOptions defaultOptions];
+        options.invocationOptions = XCTMeasurementInvocationManuallyStart | XCTMeasurementInvocationManuallyStop;
+        [self measureWithMetrics:@[[XCTClockMetric new], [XCTMemoryMetric new]] options:options block:drawBlock];
+    } else {
+        [self measureMetrics:[[self class] defaultPerformanceMetrics]
+ automaticallyStartMeasuring:NO
+                    forBlock:drawBlock];
+    }
+}
+
+/*!
+ Return the layout manager of a text view holding a document of \c length characters, with \c runCount rounded rect
+ background runs spread evenly through it. Even runs are a single word; odd runs are up to 80 characters long.
+ */
+- (HKWLayoutManager *)layoutManagerForDocumentWithLength:(NSUInteger)length runCount:(NSUInteger)runCount {
+    NSString *sentence = @"The quick brown fox jumps over the lazy dog. ";
+    NSMutableString *string = [NSMutableString stringWithCapacity:length + [sentence length]];
+    while ([string length] < length) {
+        [string appendString:sentence];
+    }
+    [string deleteCharactersInRange:NSMakeRange(length, [string length] - length)];
+
+    NSDictionary *attributes = @{NSFontAttributeName: [UIFont systemFontOfSize:14]};
+    NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:string attributes:attributes];
+    NSArray<UIColor *> *colors = @[[UIColor blueColor], [UIColor greenColor], [UIColor orangeColor]];
+    NSUInteger stride = length / runCount;
+    for (NSUInteger i=0; i<runCount; i++) {
+        NSUInteger runLength = MIN((i % 2 == 0) ? 5 : 80, stride - 1);
+        HKWRoundedRectBackgroundAttributeValue *value =
+            [HKWRoundedRectBackgroundAttributeValue valueWithBackgroundColor:colors[i % [colors count]]];
+        [text addAttribute:HKWRoundedRectBackgroundAttributeName value:value range:NSMakeRange(i*stride, runLength)];
+    }
+
+    CGRect frame = CGRectMake(0, 0, HKWTViewportSize.width, HKWTViewportSize.height);
+    self.textView = [[HKWTextView alloc] initWithFrame:frame];
+    self.textView.attributedText = text;
+    HKWLayoutManager *layoutManager = (HKWLayoutManager *)self.textView.layoutManager;
+    [layoutManager ensureLayoutForTextContainer:self.textView.textContainer];
+    return layoutManager;
+}
+
+@end
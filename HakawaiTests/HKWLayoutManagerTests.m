@@ -18,10 +18,18 @@
 
 #import "HKWTextView.h"
 #import "_HKWLayoutManager.h"
+#import "HKWCustomAttributes.h"
+#import "HKWRoundedRectBackgroundAttributeValue.h"
+#import "HKWMentionsPlugin.h"
+#import "HKWMentionsAttribute.h"
 
 @interface HKWLayoutManager ()
+@property (nonatomic, strong) NSMutableDictionary *roundedRectGeometryCache;
 - (NSArray *)roundedRectBackgroundAttributeTuplesInTextStorage:(NSTextStorage *)textStorage
                                               withinGlyphRange:(NSRange)glyphRange;
+- (NSArray *)arrayOfRectsForFragmentRects:(NSArray *)fragmentRects
+                           enclosingRects:(NSArray *)enclosingRects
+                         rrbAttributeData:(HKWRoundedRectBackgroundAttributeValue *)data;
 @end
 
 SpecBegin(layoutManager)
@@ -42,6 +50,78 @@ describe(@"roundedRectBackgroundAttributeTuples method", ^{
         NSArray *result = [layoutManager roundedRectBackgroundAttributeTuplesInTextStorage:textView.textStorage withinGlyphRange:range];
         expect(result).notTo.beNil();
     });
+
+    it(@"should return a single tuple for a run whose other attributes vary", ^{
+        NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:baseString];
+        HKWRoundedRectBackgroundAttributeValue *value = [HKWRoundedRectBackgroundAttributeValue valueWithBackgroundColor:[UIColor blueColor]];
+        // "quick brown", with "brown" in bold
+        [text addAttribute:HKWRoundedRectBackgroundAttributeName value:value range:NSMakeRange(4, 11)];
+        [text addAttribute:NSFontAttributeName value:[UIFont boldSystemFontOfSize:12] range:NSMakeRange(10, 5)];
+        textView.attributedText = text;
+        NSArray *result = [layoutManager roundedRectBackgroundAttributeTuplesInTextStorage:textView.textStorage withinGlyphRange:NSMakeRange(0, layoutManager.numberOfGlyphs)];
+        expect(result.count).to.equal(1);
+        expect([result[0][0] rangeValue]).to.equal(NSMakeRange(4, 11));
+    });
+
+    it(@"should return a tuple for each of two adjacent mentions sharing an attribute value", ^{
+        NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:baseString];
+        HKWRoundedRectBackgroundAttributeValue *value = [HKWRoundedRectBackgroundAttributeValue valueWithBackgroundColor:[UIColor blueColor]];
+        // "quick" and "brown", with the space between them part of the first mention
+        [text addAttribute:HKWRoundedRectBackgroundAttributeName value:value range:NSMakeRange(4, 11)];
+        [text addAttribute:HKWMentionAttributeName value:[HKWMentionsAttribute mentionWithText:@"quick " identifier:@"1"] range:NSMakeRange(4, 6)];
+        [text addAttribute:HKWMentionAttributeName value:[HKWMentionsAttribute mentionWithText:@"brown" identifier:@"2"] range:NSMakeRange(10, 5)];
+        textView.attributedText = text;
+        NSArray *result = [layoutManager roundedRectBackgroundAttributeTuplesInTextStorage:textView.textStorage withinGlyphRange:NSMakeRange(0, layoutManager.numberOfGlyphs)];
+        expect(result.count).to.equal(2);
+        expect([result[0][0] rangeValue]).to.equal(NSMakeRange(4, 6));
+        expect([result[1][0] rangeValue]).to.equal(NSMakeRange(10, 5));
+        // Only the mention cut off by the glyph range is extended to its full length
+        result = [layoutManager roundedRectBackgroundAttributeTuplesInTextStorage:textView.textStorage withinGlyphRange:NSMakeRange(12, 10)];
+        expect(result.count).to.equal(1);
+        expect([result[0][0] rangeValue]).to.equal(NSMakeRange(10, 5));
+    });
+
+    it(@"should return the full range of a run cut off by the glyph range", ^{
+        NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:baseString];
+        HKWRoundedRectBackgroundAttributeValue *value = [HKWRoundedRectBackgroundAttributeValue valueWithBackgroundColor:[UIColor blueColor]];
+        [text addAttribute:HKWRoundedRectBackgroundAttributeName value:value range:NSMakeRange(4, 11)];
+        textView.attributedText = text;
+        NSArray *result = [layoutManager roundedRectBackgroundAttributeTuplesInTextStorage:textView.textStorage withinGlyphRange:NSMakeRange(8, 20)];
+        expect(result.count).to.equal(1);
+        expect([result[0][0] rangeValue]).to.equal(NSMakeRange(4, 11));
+    });
+});
+
+describe(@"fragment rect intersection", ^{
+    __block HKWLayoutManager *layoutManager;
+
+    beforeEach(^{
+        layoutManager = [HKWLayoutManager new];
+    });
+
+    it(@"should clip each enclosing rect to the fragment rects on its line", ^{
+        // Three lines of a wrapped run, with the fragment rects out of order
+        NSArray *fragmentRects = @[[NSValue valueWithCGRect:CGRectMake(0, 20, 80, 18)],
+                                   [NSValue valueWithCGRect:CGRectMake(0, 0, 100, 18)],
+                                   [NSValue valueWithCGRect:CGRectMake(0, 40, 30, 18)]];
+        NSArray *enclosingRects = @[[NSValue valueWithCGRect:CGRectMake(50, 0, 60, 18)],
+                                    [NSValue valueWithCGRect:CGRectMake(0, 20, 100, 18)],
+                                    [NSValue valueWithCGRect:CGRectMake(0, 40, 50, 18)]];
+        NSArray *result = [layoutManager arrayOfRectsForFragmentRects:fragmentRects
+                                                       enclosingRects:enclosingRects
+                                                     rrbAttributeData:nil];
+        expect(result.count).to.equal(3);
+        expect([result[0] CGRectValue]).to.equal(CGRectMake(50, 0, 50, 18));
+        expect([result[1] CGRectValue]).to.equal(CGRectMake(0, 20, 80, 18));
+        expect([result[2] CGRectValue]).to.equal(CGRectMake(0, 40, 30, 18));
+    });
+
+    it(@"should return nil without fragment rects", ^{
+        NSArray *result = [layoutManager arrayOfRectsForFragmentRects:@[]
+                                                       enclosingRects:@[[NSValue valueWithCGRect:CGRectMake(0, 0, 10, 10)]]
+                                                     rrbAttributeData:nil];
+        expect(result).to.beNil();
+    });
 });
 
 describe(@"long non-english languages", ^{
@@ -96,4 +176,79 @@ describe(@"long non-english languages", ^{
     });
 });
 
+
+describe(@"highlighted character range", ^{
+    __block HKWTextView *textView;
+    __block HKWLayoutManager *layoutManager;
+    NSString *baseString = @"The quick brown fox jumps over the lazy dog";
+    NSDictionary *attributes = @{NSForegroundColorAttributeName: [UIColor whiteColor]};
+
+    beforeEach(^{
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        textView.attributedText = [[NSAttributedString alloc] initWithString:baseString];
+        layoutManager = (HKWLayoutManager *)textView.layoutManager;
+        // "brown"
+        [layoutManager setHighlightedCharacterRange:NSMakeRange(10, 5) attributes:attributes];
+    });
+
+    it(@"should shift when text before it is edited", ^{
+        [textView.textStorage replaceCharactersInRange:NSMakeRange(4, 6) withString:@""];
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(4);
+        expect(layoutManager.highlightedCharacterRange.length).to.equal(5);
+        [textView.textStorage replaceCharactersInRange:NSMakeRange(0, 0) withString:@"Look! "];
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(10);
+        expect(layoutManager.highlightAttributes).to.equal(attributes);
+    });
+
+    it(@"should be unaffected by edits after it", ^{
+        [textView.textStorage replaceCharactersInRange:NSMakeRange(15, 0) withString:@"ish"];
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(10);
+        expect(layoutManager.highlightedCharacterRange.length).to.equal(5);
+    });
+
+    it(@"should be cleared when the highlighted text is edited", ^{
+        [textView.textStorage addAttribute:NSForegroundColorAttributeName value:[UIColor redColor] range:NSMakeRange(12, 1)];
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(NSNotFound);
+        expect(layoutManager.highlightAttributes).to.beNil();
+    });
+});
+
+describe(@"rounded rect background geometry cache", ^{
+    __block HKWTextView *textView;
+    __block HKWLayoutManager *layoutManager;
+    NSString *baseString = @"The quick brown fox jumps over the lazy dog";
+
+    void (^drawBackground)(void) = ^{
+        UIGraphicsBeginImageContext(textView.bounds.size);
+        [layoutManager drawBackgroundForGlyphRange:NSMakeRange(0, layoutManager.numberOfGlyphs) atPoint:CGPointZero];
+        UIGraphicsEndImageContext();
+    };
+
+    beforeEach(^{
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 320, 200)];
+        NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:baseString];
+        HKWRoundedRectBackgroundAttributeValue *value = [HKWRoundedRectBackgroundAttributeValue valueWithBackgroundColor:[UIColor blueColor]];
+        // "quick" and "lazy"
+        [text addAttribute:HKWRoundedRectBackgroundAttributeName value:value range:NSMakeRange(4, 5)];
+        [text addAttribute:HKWRoundedRectBackgroundAttributeName value:value range:NSMakeRange(35, 4)];
+        textView.attributedText = text;
+        layoutManager = (HKWLayoutManager *)textView.layoutManager;
+    });
+
+    it(@"should only discard the geometry of runs at or after an edit", ^{
+        drawBackground();
+        expect(layoutManager.roundedRectGeometryCache.count).to.equal(2);
+        drawBackground();
+        expect(layoutManager.roundedRectGeometryCache.count).to.equal(2);
+        [textView.textStorage replaceCharactersInRange:NSMakeRange(20, 5) withString:@"leaps"];
+        expect(layoutManager.roundedRectGeometryCache.count).to.equal(1);
+    });
+
+    it(@"should discard all geometry when the text container changes size", ^{
+        drawBackground();
+        textView.textContainer.size = CGSizeMake(200, CGFLOAT_MAX);
+        expect(layoutManager.roundedRectGeometryCache.count).to.equal(0);
+    });
+});
+
 SpecEnd
@@ -0,0 +1,38 @@
+//
+//  HKWMentionsCancellationTokenTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "HKWMentionsCancellationToken.h"
+
+SpecBegin(cancellationToken)
+
+describe(@"typeahead request cancellation", ^{
+    it(@"should call cancellation handlers exactly once", ^{
+        HKWMentionsCancellationToken *token = [HKWMentionsCancellationToken new];
+        __block NSUInteger handlerCalls = 0;
+        [token addCancellationHandler:^{ handlerCalls += 1; }];
+        expect(token.cancelled).to.beFalsy();
+        [token cancel];
+        [token cancel];
+        expect(token.cancelled).to.beTruthy();
+        expect(handlerCalls).to.equal(1);
+        // Handlers added after cancellation are called immediately
+        [token addCancellationHandler:^{ handlerCalls += 1; }];
+        expect(handlerCalls).to.equal(2);
+    });
+});
+
+SpecEnd
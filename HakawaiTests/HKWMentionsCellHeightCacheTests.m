@@ -0,0 +1,72 @@
+//
+//  HKWMentionsCellHeightCacheTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "HKWMentionsCellHeightCache.h"
+#import "HKWTDummyMentionEntity.h"
+
+SpecBegin(cellHeightCache)
+
+describe(@"chooser cell height cache", ^{
+    it(@"should cache heights per entity and estimate unknown heights", ^{
+        HKWMentionsCellHeightCache *cache = [HKWMentionsCellHeightCache new];
+        UITableView *tableView = [[UITableView alloc] initWithFrame:CGRectMake(0, 0, 320, 200)];
+        HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+        HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+        HKWTDummyMentionEntity *maurice = [HKWTDummyMentionEntity entityWithName:@"Maurice Wilkes" entityID:@"2"];
+        expect([cache heightForEntity:alan inTableView:tableView]).to.beNil();
+        expect([cache estimatedHeightForEntity:alan inTableView:tableView]).to.equal(44);
+        [cache setHeight:40 forEntity:alan inTableView:tableView];
+        [cache setHeight:60 forEntity:john inTableView:tableView];
+        expect([cache heightForEntity:alan inTableView:tableView]).to.equal(@40);
+        expect([cache estimatedHeightForEntity:maurice inTableView:tableView]).to.equal(50);
+    });
+
+    it(@"should keep the heights measured in table views of different widths apart", ^{
+        HKWMentionsCellHeightCache *cache = [HKWMentionsCellHeightCache new];
+        UITableView *narrowTableView = [[UITableView alloc] initWithFrame:CGRectMake(0, 0, 320, 200)];
+        UITableView *wideTableView = [[UITableView alloc] initWithFrame:CGRectMake(0, 0, 480, 200)];
+        HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+        [cache setHeight:60 forEntity:alan inTableView:narrowTableView];
+        expect([cache heightForEntity:alan inTableView:wideTableView]).to.beNil();
+        [cache setHeight:40 forEntity:alan inTableView:wideTableView];
+        expect([cache heightForEntity:alan inTableView:narrowTableView]).to.equal(@60);
+        expect([cache heightForEntity:alan inTableView:wideTableView]).to.equal(@40);
+        expect(cache.count).to.equal(2);
+
+        // A table view which is resized uses the heights measured at its new width
+        narrowTableView.frame = CGRectMake(0, 0, 480, 200);
+        expect([cache heightForEntity:alan inTableView:narrowTableView]).to.equal(@40);
+    });
+
+    it(@"should evict the least recently used heights", ^{
+        HKWMentionsCellHeightCache *cache = [[HKWMentionsCellHeightCache alloc] initWithCapacity:2];
+        UITableView *tableView = [[UITableView alloc] initWithFrame:CGRectMake(0, 0, 320, 200)];
+        HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+        HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+        HKWTDummyMentionEntity *maurice = [HKWTDummyMentionEntity entityWithName:@"Maurice Wilkes" entityID:@"2"];
+        [cache setHeight:40 forEntity:alan inTableView:tableView];
+        [cache setHeight:60 forEntity:john inTableView:tableView];
+        expect([cache heightForEntity:alan inTableView:tableView]).to.equal(@40);
+        [cache setHeight:80 forEntity:maurice inTableView:tableView];
+        expect(cache.count).to.equal(2);
+        expect([cache heightForEntity:john inTableView:tableView]).to.beNil();
+        // Estimates only average the heights still cached
+        expect([cache estimatedHeightForEntity:john inTableView:tableView]).to.equal(60);
+    });
+});
+
+SpecEnd
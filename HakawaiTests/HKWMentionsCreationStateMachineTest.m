@@ -23,6 +23,12 @@
 #import "_HKWMentionsCreationStateMachine.h"
 #import "HKWMentionDataProvider.h"
 #import "HKWTDummyMentionsManager.h"
+#import "HKWTDummyMentionEntity.h"
+#import "_HKWMentionsTypeaheadCache.h"
+#import "HKWMentionsRateLimitPolicy.h"
+#import "HKWMentionsRecentEntitiesStore.h"
+#import "HKWMentionsEntityIndex.h"
+#import "HKWMentionsTypeaheadService.h"
 
 @interface HKWMentionsCreationStateMachine ()
 
@@ -35,6 +41,9 @@
 @interface HKWMentionDataProvider ()
 
 @property (nonatomic) NSArray *entityArray;
+@property (nonatomic, strong) HKWMentionsTypeaheadCache *resultsCache;
+@property (nonatomic) NSUInteger requestsAwaitingResponse;
+@property (nonatomic) BOOL currentQueryIsComplete;
 
 @end
 
@@ -329,4 +338,239 @@ describe(@"autocorrect setting - MENTIONS PLUGIN V2", ^{
     });
 });
 
+describe(@"typeahead requests - MENTIONS PLUGIN V2", ^{
+    HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+    HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+    HKWTDummyMentionEntity *joanna = [HKWTDummyMentionEntity entityWithName:@"Joanna Jöhansson" entityID:@"7"];
+    HKWTDummyMentionEntity *johann = [HKWTDummyMentionEntity entityWithName:@"Johann Carl Friedrich Gauss" entityID:@"8"];
+    __block HKWTextView *textView;
+    __block HKWMentionsPluginV2 *mentionsPlugin;
+    __block HKWTDummyMentionsManager *mentionsManager;
+    __block HKWMentionDataProvider *dataProvider;
+
+    // Register a new plug-in to a text view, with requests held by the given manager until they are completed
+    HKWMentionsPluginV2 *(^makePlugin)(HKWTextView *, HKWTDummyMentionsManager *) = ^(HKWTextView *parentTextView, HKWTDummyMentionsManager *manager) {
+        HKWMentionsPluginV2 *plugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp
+                                                                      controlCharacters:[NSCharacterSet characterSetWithCharactersInString:@"@"]
+                                                                           searchLength:0];
+        manager.holdsRequests = YES;
+        plugin.defaultChooserViewDelegate = manager;
+        [parentTextView setControlFlowPlugin:plugin];
+        return plugin;
+    };
+
+    beforeEach(^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        mentionsManager = [[HKWTDummyMentionsManager alloc] init];
+        mentionsPlugin = makePlugin(textView, mentionsManager);
+        dataProvider = mentionsPlugin.creationStateMachine.dataProvider;
+    });
+
+    afterEach(^{
+        HKWTextView.enableTypeaheadResultsCache = NO;
+        HKWTextView.enableBackgroundResultsProcessing = NO;
+        HKWTextView.enableMentionsPluginV2 = NO;
+    });
+
+    it(@"should show refined results without querying the data source", ^{
+        HKWTextView.enableTypeaheadResultsCache = YES;
+        [dataProvider.resultsCache setResults:@[alan, john, joanna]
+                                   isComplete:YES
+                                 forKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'@'];
+        [dataProvider queryUpdatedWithKeyString:@"Joa"
+                                     searchType:HKWMentionsSearchTypeExplicit
+                                   isWhitespace:NO
+                               controlCharacter:'@'];
+        expect(mentionsManager.cancellationTokens.count).to.equal(0);
+        expect(dataProvider.entityArray.count).to.equal(1);
+        expect(((HKWTDummyMentionEntity *)dataProvider.entityArray[0]).entityId).to.equal(@"7");
+    });
+
+    it(@"should prefetch the initial results and show them without another request", ^{
+        HKWTextView.enableTypeaheadResultsCache = YES;
+        NSArray *entities = @[alan, john, joanna];
+        mentionsPlugin.prefetchesInitialResults = YES;
+        [mentionsPlugin textViewDidBeginEditing:textView];
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+        // The query waits for the prefetch in flight instead of making its own request
+        [dataProvider queryUpdatedWithKeyString:@"" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+        [mentionsManager completeRequestAtIndex:0 withResults:entities isComplete:YES];
+        expect(dataProvider.entityArray.count).to.equal(entities.count);
+        // Once cached, prefetching again makes no request
+        [mentionsPlugin textViewDidBeginEditing:textView];
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+    });
+
+    it(@"should cache prefetched results on the main thread when the data source calls back from another thread", ^{
+        HKWTextView.enableTypeaheadResultsCache = YES;
+        HKWTextView.enableBackgroundResultsProcessing = YES;
+        mentionsManager.callbackQueue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+        mentionsPlugin.prefetchesInitialResults = YES;
+        [mentionsPlugin textViewDidBeginEditing:textView];
+        [dataProvider queryUpdatedWithKeyString:@"" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [mentionsManager completeRequestAtIndex:0 withResults:@[alan, john, john] isComplete:YES];
+        // The results are deduplicated in the background, and only cached and shown once back on the main thread
+        expect(dataProvider.entityArray.count).to.equal(0);
+        expect(dataProvider.entityArray.count).will.equal(2);
+        expect([dataProvider.resultsCache completeResultsForKeyString:@""
+                                                           searchType:HKWMentionsSearchTypeExplicit
+                                                     controlCharacter:'@'].count).to.equal(2);
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+    });
+
+    it(@"should use the default rate limit policy unless another is set", ^{
+        expect(mentionsPlugin.rateLimitPolicy).to.beKindOf([HKWMentionsDefaultRateLimitPolicy class]);
+        expect(mentionsPlugin.rateLimitPolicy.sendsLeadingEdgeRequests).to.beTruthy();
+        HKWMentionsDefaultRateLimitPolicy *policy = [HKWMentionsDefaultRateLimitPolicy fixedPolicyWithDelay:0.3];
+        mentionsPlugin.rateLimitPolicy = policy;
+        expect(mentionsPlugin.rateLimitPolicy).to.beIdenticalTo(policy);
+        mentionsPlugin.rateLimitPolicy = nil;
+        expect(mentionsPlugin.rateLimitPolicy).notTo.beNil();
+    });
+
+    it(@"should cancel superseded requests and hold back requests over the limit", ^{
+        HKWMentionsDefaultRateLimitPolicy *policy = [HKWMentionsDefaultRateLimitPolicy leadingAndTrailingEdgePolicyWithCooldown:0.01];
+        policy.maximumConcurrentRequests = 1;
+        mentionsPlugin.rateLimitPolicy = policy;
+
+        [dataProvider queryUpdatedWithKeyString:@"J" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+        // Once the cooldown expires, the request for "J" is superseded, but still awaits a response
+        expect(mentionsManager.cancellationTokens[0].cancelled).will.beTruthy();
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+        expect(dataProvider.requestsAwaitingResponse).to.equal(1);
+
+        [mentionsManager completeRequestAtIndex:0 withResults:nil isComplete:YES];
+        expect(mentionsManager.cancellationTokens.count).will.equal(2);
+        expect(mentionsManager.cancellationTokens[1].cancelled).to.beFalsy();
+        [dataProvider cancelAllRequests];
+        expect(mentionsManager.cancellationTokens[1].cancelled).to.beTruthy();
+    });
+
+    it(@"should append pages of results without duplicates", ^{
+        [dataProvider queryUpdatedWithKeyString:@"J" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [mentionsManager completeRequestAtIndex:0 withResults:@[john] isComplete:NO];
+        expect(dataProvider.entityArray.count).to.equal(1);
+        [mentionsManager completeRequestAtIndex:0 withResults:@[john, joanna] isComplete:YES];
+        expect(dataProvider.entityArray.count).to.equal(2);
+        expect(((HKWTDummyMentionEntity *)dataProvider.entityArray[1]).entityId).to.equal(@"7");
+        // Calls after the results were finalized are ignored
+        [mentionsManager completeRequestAtIndex:0 withResults:@[alan] isComplete:YES];
+        expect(dataProvider.entityArray.count).to.equal(2);
+    });
+
+    it(@"should process responses off the main thread and drop those of canceled requests", ^{
+        HKWTextView.enableBackgroundResultsProcessing = YES;
+        [dataProvider queryUpdatedWithKeyString:@"J" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [mentionsManager completeRequestAtIndex:0 withResults:@[john, john] isComplete:NO];
+        // The results are only shown once they have been deduplicated in the background
+        expect(dataProvider.entityArray.count).to.equal(0);
+        expect(dataProvider.entityArray.count).will.equal(1);
+
+        // Responses are published in order, so once the response to "Jo" is shown the late page for "J" was dropped
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(mentionsManager.cancellationTokens.count).will.equal(2);
+        [mentionsManager completeRequestAtIndex:0 withResults:@[joanna] isComplete:YES];
+        [mentionsManager completeRequestAtIndex:1
+                                    withResults:@[[HKWTDummyMentionEntity entityWithName:@"John Backus" entityID:@"2"]]
+                                     isComplete:YES];
+        expect(((HKWTDummyMentionEntity *)dataProvider.entityArray[0]).entityId).will.equal(@"2");
+        expect(dataProvider.entityArray.count).to.equal(1);
+    });
+
+    it(@"should show recent entities first and append the results without duplicates", ^{
+        mentionsPlugin.recentEntitiesStore = [[HKWMentionsRecentEntitiesStore alloc] initWithCapacity:10 fileURL:nil];
+        [mentionsPlugin.recentEntitiesStore recordEntity:joanna];
+
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(dataProvider.entityArray.count).to.equal(1);
+        [mentionsManager completeRequestAtIndex:0 withResults:@[john, joanna] isComplete:YES];
+        expect(dataProvider.entityArray.count).to.equal(2);
+        expect(((HKWTDummyMentionEntity *)dataProvider.entityArray[0]).entityId).to.equal(@"7");
+        expect(((HKWTDummyMentionEntity *)dataProvider.entityArray[1]).entityId).to.equal(@"6");
+    });
+
+    it(@"should show indexed entities without a default chooser view delegate", ^{
+        mentionsPlugin.defaultChooserViewDelegate = nil;
+        mentionsPlugin.localEntityIndex = [HKWMentionsEntityIndex new];
+        __block BOOL indexed = NO;
+        [mentionsPlugin.localEntityIndex addEntities:@[alan, john, joanna] completion:^{
+            indexed = YES;
+        }];
+        expect(indexed).will.beTruthy();
+
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(dataProvider.entityArray.count).to.equal(2);
+        expect(((HKWTDummyMentionEntity *)dataProvider.entityArray[0]).entityId).to.equal(@"6");
+    });
+
+    it(@"should update the chooser as each typeahead source answers, and drop sources which miss their deadline", ^{
+        HKWTDummyMentionsManager *prioritySource = [[HKWTDummyMentionsManager alloc] init];
+        prioritySource.holdsRequests = YES;
+        prioritySource.sourcePriority = 1;
+        HKWTDummyMentionsManager *slowSource = [[HKWTDummyMentionsManager alloc] init];
+        slowSource.holdsRequests = YES;
+        slowSource.sourceTimeout = 0.05;
+        mentionsPlugin.typeaheadSources = @[prioritySource, slowSource];
+
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(prioritySource.cancellationTokens.count).to.equal(1);
+        expect(slowSource.cancellationTokens.count).to.equal(1);
+        [mentionsManager completeRequestAtIndex:0 withResults:@[joanna, john] isComplete:YES];
+        expect(dataProvider.entityArray).to.equal(@[joanna, john]);
+        // The rows already shown keep their positions, even though the later source has a higher priority
+        [prioritySource completeRequestAtIndex:0 withResults:@[john, johann] isComplete:YES];
+        expect(dataProvider.entityArray).to.equal(@[joanna, john, johann]);
+        expect(dataProvider.currentQueryIsComplete).to.beFalsy();
+        expect(slowSource.cancellationTokens[0].cancelled).will.beTruthy();
+        expect(dataProvider.currentQueryIsComplete).to.beTruthy();
+        [slowSource completeRequestAtIndex:0 withResults:@[alan] isComplete:YES];
+        expect(dataProvider.entityArray.count).to.equal(3);
+    });
+
+    it(@"should share a request with another plug-in making the same query through a typeahead service", ^{
+        HKWMentionsTypeaheadService *service = [[HKWMentionsTypeaheadService alloc] initWithCacheCapacity:8];
+        HKWTextView *otherTextView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        HKWTDummyMentionsManager *otherManager = [[HKWTDummyMentionsManager alloc] init];
+        HKWMentionsPluginV2 *otherPlugin = makePlugin(otherTextView, otherManager);
+        HKWMentionDataProvider *otherDataProvider = otherPlugin.creationStateMachine.dataProvider;
+        mentionsPlugin.typeaheadService = service;
+        otherPlugin.typeaheadService = service;
+
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [otherDataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        expect(mentionsManager.cancellationTokens.count).to.equal(1);
+        expect(otherManager.cancellationTokens.count).to.equal(0);
+        expect(service.requestsInFlight).to.equal(1);
+        [mentionsManager completeRequestAtIndex:0 withResults:@[john, joanna] isComplete:YES];
+        expect(dataProvider.entityArray.count).to.equal(2);
+        expect(otherDataProvider.entityArray.count).to.equal(2);
+        expect(service.requestsInFlight).to.equal(0);
+    });
+
+    it(@"should only cancel a request shared through a typeahead service once no plug-in needs it", ^{
+        HKWMentionsTypeaheadService *service = [[HKWMentionsTypeaheadService alloc] initWithCacheCapacity:8];
+        HKWTextView *otherTextView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        HKWTDummyMentionsManager *otherManager = [[HKWTDummyMentionsManager alloc] init];
+        HKWMentionsPluginV2 *otherPlugin = makePlugin(otherTextView, otherManager);
+        HKWMentionDataProvider *otherDataProvider = otherPlugin.creationStateMachine.dataProvider;
+        mentionsPlugin.typeaheadService = service;
+        otherPlugin.typeaheadService = service;
+
+        [dataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [otherDataProvider queryUpdatedWithKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit isWhitespace:NO controlCharacter:'@'];
+        [dataProvider cancelAllRequests];
+        expect(mentionsManager.cancellationTokens[0].cancelled).to.beFalsy();
+        expect(dataProvider.requestsAwaitingResponse).to.equal(0);
+        [otherDataProvider cancelAllRequests];
+        expect(mentionsManager.cancellationTokens[0].cancelled).to.beTruthy();
+        expect(service.requestsInFlight).to.equal(0);
+    });
+});
+
 SpecEnd
@@ -0,0 +1,70 @@
+//
+//  HKWMentionsEntityIndexTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "HKWMentionsEntityIndex.h"
+#import "HKWTDummyMentionEntity.h"
+
+SpecBegin(entityIndex)
+
+describe(@"entity index", ^{
+    HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+    HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+    HKWTDummyMentionEntity *joanna = [HKWTDummyMentionEntity entityWithName:@"Joanna Jöhansson" entityID:@"7"];
+    HKWTDummyMentionEntity *johann = [HKWTDummyMentionEntity entityWithName:@"Johann Carl Friedrich Gauss" entityID:@"8"];
+    __block HKWMentionsEntityIndex *index;
+
+    beforeEach(^{
+        index = [HKWMentionsEntityIndex new];
+    });
+
+    it(@"should match every word of a query against the words of names, in the order entities were added", ^{
+        __block BOOL indexed = NO;
+        [index addEntities:@[alan, john, joanna, johann] completion:^{
+            indexed = YES;
+        }];
+        expect(indexed).will.beTruthy();
+        expect(index.count).to.equal(4);
+        NSArray *matches = [index entitiesMatchingKeyString:@"JO"];
+        expect(matches.count).to.equal(3);
+        expect(matches[0]).to.equal(john);
+        expect(matches[2]).to.equal(johann);
+        expect([index entitiesMatchingKeyString:@"johans"]).to.equal(@[joanna]);
+        expect([index entitiesMatchingKeyString:@"carl jo"]).to.equal(@[johann]);
+        expect([index entitiesMatchingKeyString:@"perlis alan"]).to.equal(@[alan]);
+        expect([index entitiesMatchingKeyString:@"lan"].count).to.equal(0);
+        index.maximumResults = 2;
+        expect([index entitiesMatchingKeyString:@"jo"]).to.equal(@[john, joanna]);
+        expect([index entitiesMatchingKeyString:@""]).to.equal(@[alan, john]);
+    });
+
+    it(@"should find entities added in later batches, and discard batches added before it was emptied", ^{
+        __block NSUInteger indexedBatches = 0;
+        [index addEntities:@[alan] completion:nil];
+        [index removeAllEntities];
+        [index addEntities:@[johann] completion:^{
+            indexedBatches += 1;
+        }];
+        [index addEntities:@[john] completion:^{
+            indexedBatches += 1;
+        }];
+        expect(indexedBatches).will.equal(2);
+        expect([index entitiesMatchingKeyString:@"jo"]).to.equal(@[johann, john]);
+        expect([index entitiesMatchingKeyString:@"al"].count).to.equal(0);
+    });
+});
+
+SpecEnd
@@ -18,12 +18,14 @@
 
 #import "HKWTextView.h"
 #import "HKWTextView+Plugins.h"
+#import "HKWTextView+TextTransformation.h"
 #import "HKWMentionsPlugin.h"
 #import "HKWMentionsPluginV1.h"
 #import "HKWMentionsPluginV2.h"
 #import "HKWMentionsAttribute.h"
 #import "HKWCustomAttributes.h"
 #import "HKWExternalMentionConstants.h"
+#import "_HKWLayoutManager.h"
 
 @interface HKWMentionsPluginV1 ()
 - (BOOL)stringValidForMentionsCreation:(NSString *)string;
@@ -35,6 +37,10 @@
 - (void)createMention:(HKWMentionsAttribute *)mention cursorLocation:(NSUInteger)cursorLocation;
 - (NSUInteger)mostRecentControlCharacterLocationInText:(NSString *)text locationOffsetInOriginalText:(NSUInteger)locationOffsetInOriginalText;
 - (NSUInteger)mostRecentValidControlCharacterLocation:(NSString *)text beforeLocation:(NSUInteger)location;
+- (NSString *)mentionsQueryInText:(NSString *)text location:(NSUInteger)location;
+- (NSUInteger)endOfValidWordInText:(NSString *)text afterLocation:(NSUInteger)location;
++ (NSString *)wordAfterLocation:(NSUInteger)location text:(NSString *)text;
+- (HKWMentionsAttribute *)mentionAttributeAtLocation:(NSUInteger)location range:(NSRangePointer)range;
 @end
 
 // Methods for testing attribute values/ranges in pluginV2
@@ -126,6 +132,45 @@ static NSUInteger MAX_MENTION_QUERY_LENGTH = 100;
 }
 
 
+@end
+
+@interface HKWRecordingMentionsStateChangeDelegate : NSObject <HKWMentionsStateChangeDelegate>
+
+@property (nonatomic, strong) NSMutableArray<NSArray *> *deletedMentionsNotifications;
+
+@end
+
+@implementation HKWRecordingMentionsStateChangeDelegate
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    self.deletedMentionsNotifications = [NSMutableArray array];
+    return self;
+}
+
+- (void)mentionsPlugin:(__unused id<HKWMentionsPlugin> _Null_unspecified)plugin
+       deletedMentions:(NSArray<id<HKWMentionsEntityProtocol>> *_Null_unspecified)mentions
+               inRange:(__unused NSRange)range {
+    [self.deletedMentionsNotifications addObject:mentions];
+}
+
+@end
+
+/// A plug-in which counts the mentions added through \c addMention:.
+@interface HKWCountingMentionsPluginV2 : HKWMentionsPluginV2
+@property (nonatomic) NSUInteger addMentionCount;
+@end
+
+@implementation HKWCountingMentionsPluginV2
+
+- (void)addMention:(HKWMentionsAttribute *)mention {
+    self.addMentionCount++;
+    [super addMention:mention];
+}
+
 @end
 
 SpecBegin(mentionPluginsSetup)
@@ -1148,6 +1193,49 @@ describe(@"highlight mentions - MENTIONS PLUGIN V2", ^{
         expect([highlightedAttribute class]).to.equal([HKWRoundedRectBackgroundAttributeValue class]);
     });
 
+    it(@"highlight mention without modifying the text storage", ^{
+        HKWTextView.enableRenderingOnlyMentionHighlighting = YES;
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName LastName" identifier:@"3"];
+        [textView insertText:@"Hello "];
+        [textView insertText:m1.mentionText];
+        m1.range = NSMakeRange(6, m1.mentionText.length);
+        [mentionsPlugin addMention:m1];
+        NSAttributedString *unhighlightedText = [textView.attributedText copy];
+        HKWLayoutManager *layoutManager = (HKWLayoutManager *)textView.layoutManager;
+
+        // Highlighted
+        textView.selectedRange = NSMakeRange(m1.range.location + 3, 0);
+        expect(NSEqualRanges(layoutManager.highlightedCharacterRange, m1.range)).to.beTruthy();
+        expect([layoutManager.highlightAttributes[HKWRoundedRectBackgroundAttributeName] class]).to.equal([HKWRoundedRectBackgroundAttributeValue class]);
+        expect([textView.attributedText isEqualToAttributedString:unhighlightedText]).to.beTruthy();
+
+        // Unhighlighted
+        textView.selectedRange = NSMakeRange(2, 0);
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(NSNotFound);
+        expect([textView.attributedText isEqualToAttributedString:unhighlightedText]).to.beTruthy();
+        HKWTextView.enableRenderingOnlyMentionHighlighting = NO;
+    });
+
+    it(@"unhighlight a mention after text is inserted before it without modifying the text storage", ^{
+        HKWTextView.enableRenderingOnlyMentionHighlighting = YES;
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName LastName" identifier:@"3"];
+        [textView insertText:@"Hello "];
+        [textView insertText:m1.mentionText];
+        m1.range = NSMakeRange(6, m1.mentionText.length);
+        [mentionsPlugin addMention:m1];
+        HKWLayoutManager *layoutManager = (HKWLayoutManager *)textView.layoutManager;
+        textView.selectedRange = NSMakeRange(m1.range.location + 3, 0);
+        expect(NSEqualRanges(layoutManager.highlightedCharacterRange, m1.range)).to.beTruthy();
+
+        // The layout manager moves the highlight along with the mention
+        [textView.textStorage replaceCharactersInRange:NSMakeRange(0, 0) withString:@"Well, "];
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(m1.range.location + 6);
+
+        textView.selectedRange = NSMakeRange(2, 0);
+        expect(layoutManager.highlightedCharacterRange.location).to.equal(NSNotFound);
+        HKWTextView.enableRenderingOnlyMentionHighlighting = NO;
+    });
+
     it(@"do not highlight mention - multichar select", ^{
         HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName LastName" identifier:@"3"];
 
@@ -1178,4 +1266,403 @@ describe(@"highlight mentions - MENTIONS PLUGIN V2", ^{
     });
 });
 
+
+describe(@"mentions index - MENTIONS PLUGIN V2", ^{
+    __block HKWTextView *textView;
+    __block HKWMentionsPluginV2 *mentionsPlugin;
+
+    beforeEach(^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        mentionsPlugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:mentionsPlugin];
+    });
+
+    it(@"shifts mention ranges when text is inserted before them", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"FirstName2 LastName2" identifier:@"2"];
+        NSString *string = @" NonMentionWord ";
+        [textView insertText:m1.mentionText];
+        [textView insertText:string];
+        [textView insertText:m2.mentionText];
+        m1.range = NSMakeRange(0, m1.mentionText.length);
+        m2.range = NSMakeRange(m1.mentionText.length + string.length, m2.mentionText.length);
+        [mentionsPlugin addMention:m1];
+        [mentionsPlugin addMention:m2];
+        expect(mentionsPlugin.mentions.count).to.equal(2);
+
+        // Insert text between the two mentions
+        textView.selectedRange = NSMakeRange(m1.mentionText.length + 1, 0);
+        [textView insertText:@"abc"];
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(2);
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[0]).range, m1.range)).to.beTruthy();
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, NSMakeRange(m2.range.location + 3, m2.range.length))).to.beTruthy();
+    });
+
+    it(@"keeps mention ranges in sync across edits made in different places", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"FirstName2 LastName2" identifier:@"2"];
+        HKWMentionsAttribute *m3 = [HKWMentionsAttribute mentionWithText:@"FirstName3 LastName3" identifier:@"3"];
+        NSString *string = @" NonMentionWord ";
+        [textView insertText:m1.mentionText];
+        [textView insertText:string];
+        [textView insertText:m2.mentionText];
+        [textView insertText:string];
+        [textView insertText:m3.mentionText];
+        m1.range = NSMakeRange(0, 20);
+        m2.range = NSMakeRange(36, 20);
+        m3.range = NSMakeRange(72, 20);
+        [mentionsPlugin addMention:m1];
+        [mentionsPlugin addMention:m2];
+        [mentionsPlugin addMention:m3];
+
+        // Alternate between the gap after the second mention and the gap after the first one
+        textView.selectedRange = NSMakeRange(57, 0);
+        [textView insertText:@"abc"];
+        textView.selectedRange = NSMakeRange(21, 0);
+        [textView insertText:@"de"];
+        textView.selectedRange = NSMakeRange(62, 0);
+        [textView insertText:@"f"];
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(3);
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[0]).range, NSMakeRange(0, 20))).to.beTruthy();
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, NSMakeRange(38, 20))).to.beTruthy();
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[2]).range, NSMakeRange(78, 20))).to.beTruthy();
+        expect(((HKWMentionsAttribute *)[mentionsPlugin mentionAttributeAtLocation:80 range:NULL]).entityIdentifier).to.equal(@"3");
+        expect([mentionsPlugin mentionAttributeAtLocation:59 range:NULL]).to.beNil();
+    });
+
+    it(@"reflects edits made earlier in the same batch of transformations", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"FirstName2 LastName2" identifier:@"2"];
+        NSString *string = @" NonMentionWord ";
+        [textView insertText:m1.mentionText];
+        [textView insertText:string];
+        [textView insertText:m2.mentionText];
+        m1.range = NSMakeRange(0, 20);
+        m2.range = NSMakeRange(36, 20);
+        [mentionsPlugin addMention:m1];
+        [mentionsPlugin addMention:m2];
+
+        [textView performBatchTransformations:^{
+            [textView insertPlainText:@"abc" location:21];
+            NSArray *mentions = mentionsPlugin.mentions;
+            expect(mentions.count).to.equal(2);
+            expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, NSMakeRange(39, 20))).to.beTruthy();
+
+            [textView removeTextForRange:NSMakeRange(21, 18)];
+            mentions = mentionsPlugin.mentions;
+            expect(mentions.count).to.equal(2);
+            expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, NSMakeRange(21, 20))).to.beTruthy();
+        }];
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(textView.text).to.equal(@"FirstName1 LastName1 FirstName2 LastName2");
+        expect(mentions.count).to.equal(2);
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[0]).range, NSMakeRange(0, 20))).to.beTruthy();
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, NSMakeRange(21, 20))).to.beTruthy();
+    });
+
+    it(@"reflects text set programmatically", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName LastName" identifier:@"1"];
+        [textView insertText:m1.mentionText];
+        m1.range = NSMakeRange(0, m1.mentionText.length);
+        [mentionsPlugin addMention:m1];
+        expect(mentionsPlugin.mentions.count).to.equal(1);
+
+        NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:@"Hello "];
+        [text appendAttributedString:textView.attributedText];
+        textView.attributedText = text;
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(1);
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[0]).range, NSMakeRange(6, m1.mentionText.length))).to.beTruthy();
+
+        textView.attributedText = [[NSAttributedString alloc] initWithString:@"No mentions here"];
+        expect(mentionsPlugin.mentions.count).to.equal(0);
+    });
+
+    it(@"only bleaches mentions that intersect the range", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"FirstName2 LastName2" identifier:@"2"];
+        NSString *string = @" NonMentionWord ";
+        [textView insertText:m1.mentionText];
+        [textView insertText:string];
+        [textView insertText:m2.mentionText];
+        m1.range = NSMakeRange(0, m1.mentionText.length);
+        m2.range = NSMakeRange(m1.mentionText.length + string.length, m2.mentionText.length);
+        [mentionsPlugin addMention:m1];
+        [mentionsPlugin addMention:m2];
+
+        // Adding a mention over the tail of the first one bleaches only the first one
+        HKWMentionsAttribute *m3 = [HKWMentionsAttribute mentionWithText:@"LastName1" identifier:@"3"];
+        m3.range = NSMakeRange(11, m3.mentionText.length);
+        [mentionsPlugin addMention:m3];
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(2);
+        expect(((HKWMentionsAttribute *)mentions[0]).entityIdentifier).to.equal(@"3");
+        expect(((HKWMentionsAttribute *)mentions[1]).entityIdentifier).to.equal(@"2");
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, m2.range)).to.beTruthy();
+    });
+});
+
+
+describe(@"bulk adding mentions - MENTIONS PLUGIN V2", ^{
+    __block HKWTextView *textView;
+    __block HKWMentionsPluginV2 *mentionsPlugin;
+    NSString *text = @"FirstName1 LastName1 NonMentionWord FirstName2 LastName2";
+
+    beforeEach(^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        mentionsPlugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:mentionsPlugin];
+        [textView insertText:text];
+    });
+
+    it(@"adds valid mentions regardless of the order they are passed in", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        m1.range = NSMakeRange(0, m1.mentionText.length);
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"FirstName2 LastName2" identifier:@"2"];
+        m2.range = NSMakeRange(36, m2.mentionText.length);
+
+        NSDictionary *rejections = nil;
+        [mentionsPlugin addMentions:@[m2, m1] rejectedMentions:&rejections];
+        expect(rejections.count).to.equal(0);
+        expect(textView.text).to.equal(text);
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(2);
+        expect(((HKWMentionsAttribute *)mentions[0]).entityIdentifier).to.equal(@"1");
+        expect(NSEqualRanges(((HKWMentionsAttribute *)mentions[1]).range, m2.range)).to.beTruthy();
+    });
+
+    it(@"reports rejected mentions and why they were rejected", ^{
+        HKWMentionsAttribute *valid = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        valid.range = NSMakeRange(0, valid.mentionText.length);
+        HKWMentionsAttribute *overlapping = [HKWMentionsAttribute mentionWithText:@"LastName1" identifier:@"2"];
+        overlapping.range = NSMakeRange(11, overlapping.mentionText.length);
+        HKWMentionsAttribute *mismatched = [HKWMentionsAttribute mentionWithText:@"Someone Else" identifier:@"3"];
+        mismatched.range = NSMakeRange(36, mismatched.mentionText.length);
+        HKWMentionsAttribute *outOfBounds = [HKWMentionsAttribute mentionWithText:@"FirstName2" identifier:@"4"];
+        outOfBounds.range = NSMakeRange(text.length, outOfBounds.mentionText.length);
+
+        NSDictionary *rejections = nil;
+        [mentionsPlugin addMentions:@[overlapping, @"not a mention", mismatched, valid, outOfBounds] rejectedMentions:&rejections];
+        expect(rejections.count).to.equal(4);
+        expect(rejections[@0]).to.equal(@(HKWMentionsRejectionReasonOverlap));
+        expect(rejections[@1]).to.equal(@(HKWMentionsRejectionReasonInvalidObject));
+        expect(rejections[@2]).to.equal(@(HKWMentionsRejectionReasonTextMismatch));
+        expect(rejections[@4]).to.equal(@(HKWMentionsRejectionReasonInvalidRange));
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(1);
+        expect(((HKWMentionsAttribute *)mentions[0]).entityIdentifier).to.equal(@"1");
+    });
+
+    it(@"bleaches existing mentions that the new mentions intrude upon", ^{
+        HKWMentionsAttribute *existing = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        existing.range = NSMakeRange(0, existing.mentionText.length);
+        [mentionsPlugin addMention:existing];
+
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"LastName1" identifier:@"2"];
+        m1.range = NSMakeRange(11, m1.mentionText.length);
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"LastName2" identifier:@"3"];
+        m2.range = NSMakeRange(47, m2.mentionText.length);
+        [mentionsPlugin addMentions:@[m1, m2]];
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(2);
+        expect(((HKWMentionsAttribute *)mentions[0]).entityIdentifier).to.equal(@"2");
+        expect(((HKWMentionsAttribute *)mentions[1]).entityIdentifier).to.equal(@"3");
+    });
+
+    it(@"keeps adding mentions one at a time through addMention: when no rejections are requested", ^{
+        HKWCountingMentionsPluginV2 *countingPlugin =
+            [HKWCountingMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:countingPlugin];
+
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        m1.range = NSMakeRange(0, m1.mentionText.length);
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"FirstName2 LastName2" identifier:@"2"];
+        m2.range = NSMakeRange(36, m2.mentionText.length);
+        [countingPlugin addMentions:@[m1, m2]];
+
+        expect(countingPlugin.addMentionCount).to.equal(2);
+        expect(countingPlugin.mentions.count).to.equal(2);
+    });
+
+    it(@"resolves overlaps passed to addMentions: in favor of the last mention", ^{
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        m1.range = NSMakeRange(0, m1.mentionText.length);
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:@"LastName1" identifier:@"2"];
+        m2.range = NSMakeRange(11, m2.mentionText.length);
+        [mentionsPlugin addMentions:@[m1, m2]];
+
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(1);
+        expect(((HKWMentionsAttribute *)mentions[0]).entityIdentifier).to.equal(@"2");
+    });
+
+    it(@"bleaches existing mentions overlapped by a mismatched mention passed to addMentions:", ^{
+        HKWMentionsAttribute *existing = [HKWMentionsAttribute mentionWithText:@"FirstName1 LastName1" identifier:@"1"];
+        existing.range = NSMakeRange(0, existing.mentionText.length);
+        [mentionsPlugin addMention:existing];
+
+        HKWMentionsAttribute *mismatched = [HKWMentionsAttribute mentionWithText:@"Someone" identifier:@"2"];
+        mismatched.range = NSMakeRange(11, mismatched.mentionText.length);
+        [mentionsPlugin addMentions:@[mismatched]];
+        expect(mentionsPlugin.mentions.count).to.equal(0);
+
+        // The sweep leaves the existing mention alone instead
+        [mentionsPlugin addMention:existing];
+        NSDictionary *rejections = nil;
+        [mentionsPlugin addMentions:@[mismatched] rejectedMentions:&rejections];
+        expect(rejections[@0]).to.equal(@(HKWMentionsRejectionReasonTextMismatch));
+        expect(mentionsPlugin.mentions.count).to.equal(1);
+    });
+});
+
+
+describe(@"bulk deleting mentions", ^{
+    __block HKWTextView *textView;
+    __block HKWRecordingMentionsStateChangeDelegate *stateChangeDelegate;
+    NSString *text = @"FirstName1 LastName1 NonMentionWord FirstName2 LastName2 FirstName3 LastName3";
+
+    NSArray<HKWMentionsAttribute *> *(^mentionsForText)(void) = ^NSArray<HKWMentionsAttribute *> *{
+        NSMutableArray *mentions = [NSMutableArray array];
+        for (NSNumber *location in @[@0, @36, @57]) {
+            NSString *name = [text substringWithRange:NSMakeRange([location unsignedIntegerValue], 20)];
+            HKWMentionsAttribute *mention = [HKWMentionsAttribute mentionWithText:name identifier:[location stringValue]];
+            mention.range = NSMakeRange([location unsignedIntegerValue], 20);
+            [mentions addObject:mention];
+        }
+        return mentions;
+    };
+
+    beforeEach(^{
+        stateChangeDelegate = [[HKWRecordingMentionsStateChangeDelegate alloc] init];
+    });
+
+    it(@"should bleach every mention in the range and notify the delegate once - MENTIONS PLUGIN V1", ^{
+        HKWTextView.enableMentionsPluginV2 = NO;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        HKWMentionsPluginV1 *mentionsPlugin = [HKWMentionsPluginV1 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:mentionsPlugin];
+        mentionsPlugin.stateChangeDelegate = stateChangeDelegate;
+        [textView insertText:text];
+        [mentionsPlugin addMentions:mentionsForText()];
+        expect(mentionsPlugin.mentions.count).to.equal(3);
+
+        // Delete from the middle of the first mention to the middle of the third
+        [mentionsPlugin textView:textView shouldChangeTextInRange:NSMakeRange(5, 60) replacementText:@""];
+        expect(mentionsPlugin.mentions.count).to.equal(0);
+        expect(textView.text).to.equal(text);
+        expect(stateChangeDelegate.deletedMentionsNotifications.count).to.equal(1);
+        expect(stateChangeDelegate.deletedMentionsNotifications[0].count).to.equal(3);
+    });
+
+    it(@"should notify the delegate once when a selection spanning many mentions is deleted - MENTIONS PLUGIN V2", ^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        HKWMentionsPluginV2 *mentionsPlugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:mentionsPlugin];
+        mentionsPlugin.stateChangeDelegate = stateChangeDelegate;
+        [textView insertText:text];
+        [mentionsPlugin addMentions:mentionsForText()];
+        expect(mentionsPlugin.mentions.count).to.equal(3);
+
+        BOOL deletionResult = [mentionsPlugin textView:textView shouldChangeTextInRange:NSMakeRange(0, text.length) replacementText:@""];
+        expect(deletionResult).to.equal(YES);
+        expect(stateChangeDelegate.deletedMentionsNotifications.count).to.equal(1);
+        expect(stateChangeDelegate.deletedMentionsNotifications[0].count).to.equal(3);
+    });
+
+    it(@"should report a deleted mention of the same entity as a trimmed mention - MENTIONS PLUGIN V2", ^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        HKWMentionsPluginV2 *mentionsPlugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:mentionsPlugin];
+        mentionsPlugin.stateChangeDelegate = stateChangeDelegate;
+        NSString *name = @"FirstName1 LastName1";
+        HKWDummyMentionsDefaultChooserViewDelegate *delegate = [[HKWDummyMentionsDefaultChooserViewDelegate alloc] initWithTrimmableStrings:@[name]];
+        mentionsPlugin.defaultChooserViewDelegate = delegate;
+        [textView insertText:[NSString stringWithFormat:@"%@ %@", name, name]];
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:name identifier:@"1"];
+        m1.range = NSMakeRange(0, name.length);
+        HKWMentionsAttribute *m2 = [HKWMentionsAttribute mentionWithText:name identifier:@"1"];
+        m2.range = NSMakeRange(name.length + 1, name.length);
+        [mentionsPlugin addMentions:@[m1, m2]];
+        expect(mentionsPlugin.mentions.count).to.equal(2);
+
+        // Delete the first mention and the tail of the second one, which is trimmed rather than deleted
+        [mentionsPlugin textView:textView shouldChangeTextInRange:NSMakeRange(0, name.length + 6) replacementText:@""];
+        expect(textView.text).to.equal(@"FirstName1");
+        expect(mentionsPlugin.mentions.count).to.equal(1);
+        expect(stateChangeDelegate.deletedMentionsNotifications.count).to.equal(1);
+        expect(stateChangeDelegate.deletedMentionsNotifications[0].count).to.equal(1);
+    });
+
+    it(@"should strip mentions within a range in a single pass - MENTIONS PLUGIN V2", ^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        HKWMentionsPluginV2 *mentionsPlugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        [textView setControlFlowPlugin:mentionsPlugin];
+        [textView insertText:text];
+        [mentionsPlugin addMentions:mentionsForText()];
+
+        // A mention spanning all three existing mentions' text displaces them
+        HKWMentionsAttribute *wide = [HKWMentionsAttribute mentionWithText:[text substringWithRange:NSMakeRange(11, 52)] identifier:@"wide"];
+        wide.range = NSMakeRange(11, 52);
+        [mentionsPlugin addMention:wide];
+        NSArray *mentions = mentionsPlugin.mentions;
+        expect(mentions.count).to.equal(1);
+        expect(((HKWMentionsAttribute *)mentions[0]).entityIdentifier).to.equal(@"wide");
+        expect(textView.text).to.equal(text);
+    });
+});
+
+
+describe(@"mentions query utils - MENTIONS PLUGIN V2", ^{
+    __block HKWTextView *textView;
+    __block HKWMentionsPluginV2 *mentionsPlugin;
+
+    beforeEach(^{
+        HKWTextView.enableMentionsPluginV2 = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        mentionsPlugin = [HKWMentionsPluginV2 mentionsPluginWithChooserMode:HKWMentionsChooserPositionModeCustomLockTopArrowPointingUp];
+        mentionsPlugin.controlCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"@"];
+        [textView setControlFlowPlugin:mentionsPlugin];
+    });
+
+    it(@"finds the query surrounding the cursor", ^{
+        NSString *text = @"Hello @Jo hn there";
+        textView.text = text;
+        expect([mentionsPlugin mentionsQueryInText:text location:8]).to.equal(@"@Jo");
+        expect([mentionsPlugin mentionsQueryInText:text location:7]).to.equal(@"@Jo");
+        expect([mentionsPlugin mentionsQueryInText:text location:5]).to.beNil();
+        expect([mentionsPlugin endOfValidWordInText:text afterLocation:10]).to.equal(12);
+        expect([mentionsPlugin endOfValidWordInText:text afterLocation:text.length]).to.equal(text.length);
+    });
+
+    it(@"rejects a word that runs into a mention", ^{
+        NSString *text = @"@FirstName LastName";
+        textView.text = text;
+        HKWMentionsAttribute *m1 = [HKWMentionsAttribute mentionWithText:@"LastName" identifier:@"1"];
+        m1.range = NSMakeRange(11, m1.mentionText.length);
+        [mentionsPlugin addMention:m1];
+        expect([mentionsPlugin endOfValidWordInText:text afterLocation:3]).to.equal(10);
+        expect([mentionsPlugin endOfValidWordInText:text afterLocation:11]).to.equal(NSNotFound);
+    });
+
+    it(@"finds the word after a location", ^{
+        expect([HKWMentionsPluginV2 wordAfterLocation:6 text:@"Hello there world"]).to.equal(@"there");
+        expect([HKWMentionsPluginV2 wordAfterLocation:5 text:@"Hello there world"]).to.beNil();
+        expect([HKWMentionsPluginV2 wordAfterLocation:17 text:@"Hello there world"]).to.beNil();
+    });
+});
+
 SpecEnd
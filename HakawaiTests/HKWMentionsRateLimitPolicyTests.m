@@ -0,0 +1,45 @@
+//
+//  HKWMentionsRateLimitPolicyTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "HKWMentionsRateLimitPolicy.h"
+
+SpecBegin(rateLimitPolicy)
+
+describe(@"typeahead rate limit policy", ^{
+    it(@"should only send leading edge requests if not fixed", ^{
+        expect([HKWMentionsDefaultRateLimitPolicy fixedPolicyWithDelay:0.2].sendsLeadingEdgeRequests).to.beFalsy();
+        expect([HKWMentionsDefaultRateLimitPolicy defaultPolicy].sendsLeadingEdgeRequests).to.beTruthy();
+        expect([[HKWMentionsDefaultRateLimitPolicy defaultPolicy] delayForSearchType:HKWMentionsSearchTypeExplicit]).to.equal(0.1);
+    });
+
+    it(@"should adapt its delay to a moving average of the response times", ^{
+        HKWMentionsDefaultRateLimitPolicy *policy = [HKWMentionsDefaultRateLimitPolicy adaptivePolicyWithMinimumDelay:0.05
+                                                                                                          maximumDelay:0.5];
+        policy.smoothingFactor = 0.5;
+        expect([policy delayForSearchType:HKWMentionsSearchTypeExplicit]).to.equal(0.05);
+        [policy recordResponseTime:0.2 forSearchType:HKWMentionsSearchTypeExplicit];
+        [policy recordResponseTime:0.4 forSearchType:HKWMentionsSearchTypeExplicit];
+        expect([policy averageResponseTimeForSearchType:HKWMentionsSearchTypeExplicit]).to.beCloseTo(0.3);
+        expect([policy delayForSearchType:HKWMentionsSearchTypeExplicit]).to.beCloseTo(0.3);
+        // Other search types keep their own average
+        expect([policy delayForSearchType:HKWMentionsSearchTypeImplicit]).to.equal(0.05);
+        [policy recordResponseTime:4.0 forSearchType:HKWMentionsSearchTypeExplicit];
+        expect([policy delayForSearchType:HKWMentionsSearchTypeExplicit]).to.equal(0.5);
+    });
+});
+
+SpecEnd
@@ -0,0 +1,58 @@
+//
+//  HKWMentionsRecentEntitiesStoreTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "HKWMentionsRecentEntitiesStore.h"
+#import "HKWMentionsAttribute.h"
+#import "HKWTDummyMentionEntity.h"
+
+SpecBegin(recentEntitiesStore)
+
+describe(@"recent entities store", ^{
+    HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+    HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+    HKWTDummyMentionEntity *joanna = [HKWTDummyMentionEntity entityWithName:@"Joanna Jöhansson" entityID:@"7"];
+
+    it(@"should keep the most recently used entities which match a query", ^{
+        HKWMentionsRecentEntitiesStore *store = [[HKWMentionsRecentEntitiesStore alloc] initWithCapacity:2 fileURL:nil];
+        [store recordEntity:john];
+        [store recordEntity:joanna];
+        [store recordEntity:john];
+        NSArray *matches = [store entitiesMatchingKeyString:@"jo"];
+        expect(matches.count).to.equal(2);
+        expect(matches[0]).to.equal(john);
+        [store recordEntity:alan];
+        expect(store.count).to.equal(2);
+        expect([store entitiesMatchingKeyString:@"Joa"].count).to.equal(0);
+        // A mention for a stored entity keeps the entity
+        [store recordMention:[HKWMentionsAttribute mentionWithText:@"John" identifier:@"6"]];
+        expect([store entitiesMatchingKeyString:@""][0]).to.equal(john);
+    });
+
+    it(@"should persist the entities to its file", ^{
+        NSURL *fileURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"HKWRecentEntitiesTest.plist"]];
+        HKWMentionsRecentEntitiesStore *store = [[HKWMentionsRecentEntitiesStore alloc] initWithCapacity:2 fileURL:fileURL];
+        [store removeAllEntities];
+        [store recordEntity:joanna];
+        expect([[HKWMentionsRecentEntitiesStore alloc] initWithCapacity:2 fileURL:fileURL].count).will.equal(1);
+        id<HKWMentionsEntityProtocol> loadedEntity = [[[HKWMentionsRecentEntitiesStore alloc] initWithCapacity:2 fileURL:fileURL] entitiesMatchingKeyString:@"Jo"][0];
+        expect([loadedEntity entityId]).to.equal(@"7");
+        expect([loadedEntity entityName]).to.equal(@"Joanna Jöhansson");
+        [store removeAllEntities];
+    });
+});
+
+SpecEnd
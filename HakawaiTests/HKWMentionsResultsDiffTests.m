@@ -0,0 +1,56 @@
+//
+//  HKWMentionsResultsDiffTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "_HKWMentionsResultsDiff.h"
+
+SpecBegin(resultsDiff)
+
+describe(@"typeahead results diff", ^{
+    NSString *(^uniqueId)(id) = ^NSString *(NSString *result) { return result; };
+
+    it(@"should only move results whose relative order changed", ^{
+        HKWMentionsResultsDiff *diff = [HKWMentionsResultsDiff diffFromResults:@[@"A", @"B", @"C", @"D"]
+                                                                     toResults:@[@"B", @"A", @"E", @"D"]
+                                                                      uniqueId:uniqueId
+                                                                   needsReload:^BOOL(NSString *oldResult, __unused NSString *newResult) {
+            return [oldResult isEqualToString:@"D"];
+        }];
+        expect(diff.hasChanges).to.beTruthy();
+        expect(diff.deletedRows).to.equal([NSIndexSet indexSetWithIndex:2]);
+        expect(diff.insertedRows).to.equal([NSIndexSet indexSetWithIndex:2]);
+        expect(diff.reloadedRows).to.equal([NSIndexSet indexSetWithIndex:3]);
+        expect(diff.movedFromRows).to.equal(@[@1]);
+        expect(diff.movedToRows).to.equal(@[@0]);
+    });
+
+    it(@"should have no changes for identical results", ^{
+        HKWMentionsResultsDiff *diff = [HKWMentionsResultsDiff diffFromResults:@[@"A", @"B"]
+                                                                     toResults:@[@"A", @"B"]
+                                                                      uniqueId:uniqueId
+                                                                   needsReload:^BOOL(__unused id oldResult, __unused id newResult) { return NO; }];
+        expect(diff.hasChanges).to.beFalsy();
+    });
+
+    it(@"should not diff results with duplicate unique IDs", ^{
+        expect([HKWMentionsResultsDiff diffFromResults:@[@"A", @"A"]
+                                             toResults:@[@"A"]
+                                              uniqueId:uniqueId
+                                           needsReload:^BOOL(__unused id oldResult, __unused id newResult) { return NO; }]).to.beNil();
+    });
+});
+
+SpecEnd
@@ -0,0 +1,65 @@
+//
+//  HKWMentionsResultsMergerTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "_HKWMentionsResultsMerger.h"
+#import "HKWTDummyMentionEntity.h"
+
+SpecBegin(resultsMerger)
+
+describe(@"typeahead results merger", ^{
+    HKWTDummyMentionEntity *alan = [HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"];
+    HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+    HKWTDummyMentionEntity *joanna = [HKWTDummyMentionEntity entityWithName:@"Joanna Jöhansson" entityID:@"7"];
+    HKWTDummyMentionEntity *johann = [HKWTDummyMentionEntity entityWithName:@"Johann Carl Friedrich Gauss" entityID:@"8"];
+
+    it(@"should merge results in order of source priority without duplicates", ^{
+        HKWMentionsResultsMerger *merger = [[HKWMentionsResultsMerger alloc] initWithSourcePriorities:@[@0, @1, @0]
+                                                                                       leadingResults:@[alan]
+                                                                                             uniqueId:^NSString *(id entity) {
+            return [entity entityId];
+        }];
+        [merger addResults:@[johann, joanna, alan] fromSourceAtIndex:2 isComplete:YES];
+        [merger addResults:@[john, joanna] fromSourceAtIndex:1 isComplete:YES];
+        expect(merger.results).to.equal(@[alan, john, joanna, johann]);
+        expect(merger.isComplete).to.beFalsy();
+        [merger dropSourceAtIndex:0];
+        [merger addResults:@[alan] fromSourceAtIndex:0 isComplete:YES];
+        expect(merger.results).to.equal(@[alan, john, joanna, johann]);
+        expect(merger.isComplete).to.beTruthy();
+        expect(merger.hasDroppedSources).to.beTruthy();
+    });
+
+    it(@"should append results below those already published", ^{
+        HKWMentionsResultsMerger *merger = [[HKWMentionsResultsMerger alloc] initWithSourcePriorities:@[@0, @1, @2]
+                                                                                       leadingResults:@[alan]
+                                                                                             uniqueId:^NSString *(id entity) {
+            return [entity entityId];
+        }];
+        [merger addResults:@[joanna, alan] fromSourceAtIndex:0 isComplete:YES];
+        expect(merger.results).to.equal(@[alan, joanna]);
+        [merger markResultsAsPublished];
+        // Higher priority sources answering later don't move the published rows, but are ordered among themselves
+        [merger addResults:@[john] fromSourceAtIndex:1 isComplete:YES];
+        [merger addResults:@[johann, joanna] fromSourceAtIndex:2 isComplete:YES];
+        expect(merger.results).to.equal(@[alan, joanna, johann, john]);
+        [merger markResultsAsPublished];
+        expect(merger.results).to.equal(@[alan, joanna, johann, john]);
+        expect(merger.isComplete).to.beTruthy();
+    });
+});
+
+SpecEnd
@@ -0,0 +1,63 @@
+//
+//  HKWMentionsTypeaheadCacheTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "_HKWMentionsTypeaheadCache.h"
+#import "HKWTDummyMentionEntity.h"
+
+SpecBegin(typeaheadCache)
+
+describe(@"typeahead results cache", ^{
+    __block HKWMentionsTypeaheadCache *cache;
+    NSArray *entities = @[[HKWTDummyMentionEntity entityWithName:@"Alan Perlis" entityID:@"1"],
+                          [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"],
+                          [HKWTDummyMentionEntity entityWithName:@"Joanna Jöhansson" entityID:@"7"]];
+
+    beforeEach(^{
+        cache = [[HKWMentionsTypeaheadCache alloc] initWithCapacity:2];
+    });
+
+    it(@"should refine the complete results of a prefix locally", ^{
+        [cache setResults:entities isComplete:YES forKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        NSArray *results = [cache completeResultsForKeyString:@"Joh" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        expect(results.count).to.equal(2);
+        expect(((HKWTDummyMentionEntity *)results[0]).entityId).to.equal(@"6");
+        expect(((HKWTDummyMentionEntity *)results[1]).entityId).to.equal(@"7");
+        results = [cache completeResultsForKeyString:@"John" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        expect(results.count).to.equal(1);
+        expect(((HKWTDummyMentionEntity *)results[0]).entityId).to.equal(@"6");
+    });
+
+    it(@"should not refine incomplete results or results for a different query type", ^{
+        [cache setResults:entities isComplete:NO forKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        expect([cache completeResultsForKeyString:@"Joh" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@']).to.beNil();
+        [cache setResults:entities isComplete:YES forKeyString:@"Jo" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        expect([cache completeResultsForKeyString:@"Joh" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'#']).to.beNil();
+        expect([cache completeResultsForKeyString:@"Joh" searchType:HKWMentionsSearchTypeImplicit controlCharacter:'@']).to.beNil();
+    });
+
+    it(@"should evict the least recently used results", ^{
+        [cache setResults:entities isComplete:YES forKeyString:@"A" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        [cache setResults:entities isComplete:YES forKeyString:@"B" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        expect([cache completeResultsForKeyString:@"A" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@']).notTo.beNil();
+        [cache setResults:entities isComplete:YES forKeyString:@"C" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@'];
+        expect(cache.count).to.equal(2);
+        expect([cache completeResultsForKeyString:@"A" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@']).notTo.beNil();
+        expect([cache completeResultsForKeyString:@"B" searchType:HKWMentionsSearchTypeExplicit controlCharacter:'@']).to.beNil();
+    });
+});
+
+SpecEnd
@@ -0,0 +1,119 @@
+//
+//  HKWMentionsTypeaheadServiceTests.m
+//  Hakawai
+//
+//  Copyright (c) 2014 LinkedIn Corp. All rights reserved.
+//  Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with
+//  the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software distributed under the License is distributed on
+//  an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//
+
+#define EXP_SHORTHAND
+
+#import "Specta.h"
+#import "Expecta.h"
+
+#import "_HKWMentionsTypeaheadService.h"
+#import "HKWMentionsCancellationToken.h"
+#import "HKWTDummyMentionEntity.h"
+
+SpecBegin(typeaheadService)
+
+describe(@"typeahead service", ^{
+    HKWTDummyMentionEntity *john = [HKWTDummyMentionEntity entityWithName:@"John McCarthy" entityID:@"6"];
+    HKWTDummyMentionEntity *joanna = [HKWTDummyMentionEntity entityWithName:@"Joanna Jöhansson" entityID:@"7"];
+    __block HKWMentionsTypeaheadService *service;
+    __block NSUInteger requestCount;
+    __block HKWMentionsCancellationToken *sharedToken;
+    __block HKWMentionsTypeaheadCompletion sharedCompletion;
+    __block void (^request)(HKWMentionsCancellationToken *, HKWMentionsTypeaheadCompletion);
+
+    beforeEach(^{
+        service = [[HKWMentionsTypeaheadService alloc] initWithCacheCapacity:8];
+        requestCount = 0;
+        sharedToken = nil;
+        sharedCompletion = nil;
+        request = ^(HKWMentionsCancellationToken *token, HKWMentionsTypeaheadCompletion completion) {
+            requestCount += 1;
+            sharedToken = token;
+            sharedCompletion = completion;
+        };
+    });
+
+    it(@"should make one request for the same query and pass every page to each caller", ^{
+        NSMutableArray *firstPages = [NSMutableArray array];
+        NSMutableArray *secondPages = [NSMutableArray array];
+        [service retrieveEntitiesForKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'@'
+                            cancellationToken:[HKWMentionsCancellationToken new]
+                                      request:request
+                                   completion:^(NSArray *results, __unused BOOL dedupe, __unused BOOL isComplete) {
+            [firstPages addObject:results];
+        }];
+        sharedCompletion(@[john], YES, NO);
+        // A caller joining the request is passed the pages received so far
+        [service retrieveEntitiesForKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'@'
+                            cancellationToken:[HKWMentionsCancellationToken new]
+                                      request:request
+                                   completion:^(NSArray *results, __unused BOOL dedupe, __unused BOOL isComplete) {
+            [secondPages addObject:results];
+        }];
+        expect(requestCount).to.equal(1);
+        expect(service.requestsInFlight).to.equal(1);
+        sharedCompletion(@[joanna], YES, YES);
+        expect(firstPages).to.equal(@[@[john], @[joanna]]);
+        expect(secondPages).to.equal(@[@[john], @[joanna]]);
+        expect(service.requestsInFlight).to.equal(0);
+    });
+
+    it(@"should not share requests for different queries", ^{
+        HKWMentionsTypeaheadCompletion completion = ^(__unused NSArray *results, __unused BOOL dedupe, __unused BOOL isComplete) {};
+        [service retrieveEntitiesForKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'@'
+                            cancellationToken:[HKWMentionsCancellationToken new]
+                                      request:request
+                                   completion:completion];
+        [service retrieveEntitiesForKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'#'
+                            cancellationToken:[HKWMentionsCancellationToken new]
+                                      request:request
+                                   completion:completion];
+        expect(requestCount).to.equal(2);
+        expect(service.requestsInFlight).to.equal(2);
+    });
+
+    it(@"should only cancel a request once no caller needs it", ^{
+        HKWMentionsCancellationToken *firstToken = [HKWMentionsCancellationToken new];
+        HKWMentionsCancellationToken *secondToken = [HKWMentionsCancellationToken new];
+        __block BOOL firstFinalized = NO;
+        [service retrieveEntitiesForKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'@'
+                            cancellationToken:firstToken
+                                      request:request
+                                   completion:^(NSArray *results, __unused BOOL dedupe, BOOL isComplete) {
+            firstFinalized = (results == nil && isComplete);
+        }];
+        [service retrieveEntitiesForKeyString:@"Jo"
+                                   searchType:HKWMentionsSearchTypeExplicit
+                             controlCharacter:'@'
+                            cancellationToken:secondToken
+                                      request:request
+                                   completion:^(__unused NSArray *results, __unused BOOL dedupe, __unused BOOL isComplete) {}];
+        [firstToken cancel];
+        expect(firstFinalized).to.beTruthy();
+        expect(sharedToken.cancelled).to.beFalsy();
+        [secondToken cancel];
+        expect(sharedToken.cancelled).to.beTruthy();
+        expect(service.requestsInFlight).to.equal(0);
+    });
+});
+
+SpecEnd
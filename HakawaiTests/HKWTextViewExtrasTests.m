@@ -17,6 +17,7 @@
 #import "Expecta.h"
 
 #import "HKWTextView+Extras.h"
+#import "_HKWCharacterClassifier.h"
 
 SpecBegin(rangeForWordPrecedingCursor)
 
@@ -102,6 +103,14 @@ describe(@"rangeForWordPrecedingCursor", ^{
         NSRange r = [textView rangeForWordPrecedingCursor];
         expect(r.location).to.equal(NSNotFound);
     });
+
+    it(@"should properly treat newlines as word delimiters", ^{
+        textView.attributedText = [[NSAttributedString alloc] initWithString:@"The quick\nbrown fox"];
+        textView.selectedRange = NSMakeRange(12, 0);
+        NSRange r = [textView rangeForWordPrecedingCursor];
+        expect(r.length).to.equal(5);
+        expect(r.location).to.equal(10);
+    });
 });
 
 SpecEnd
@@ -144,3 +153,75 @@ describe(@"characterPrecedingLocation", ^{
 });
 
 SpecEnd
+
+SpecBegin(characterClassifier)
+
+describe(@"character classifier", ^{
+    __block HKWCharacterClassifier *classifier;
+
+    beforeEach(^{
+        classifier = [HKWCharacterClassifier classifierWithControlCharacterSet:[NSCharacterSet characterSetWithCharactersInString:@"@+"]];
+    });
+
+    it(@"should classify characters the same way as the underlying character sets", ^{
+        expect([classifier classOfCharacter:' ']).to.equal(HKWCharacterClassWhitespace);
+        expect([classifier classOfCharacter:'\n']).to.equal(HKWCharacterClassWhitespace);
+        expect([classifier classOfCharacter:',']).to.equal(HKWCharacterClassPunctuation);
+        expect([classifier classOfCharacter:'@']).to.equal(HKWCharacterClassPunctuation | HKWCharacterClassControl);
+        expect([classifier classOfCharacter:'+']).to.equal(HKWCharacterClassControl);
+        expect([classifier classOfCharacter:'a']).to.equal(HKWCharacterClassAlphanumeric);
+        expect([classifier classOfCharacter:'7']).to.equal(HKWCharacterClassAlphanumeric);
+        expect([classifier classOfCharacter:0x00E9]).to.equal(HKWCharacterClassAlphanumeric);
+        expect([[HKWCharacterClassifier sharedClassifier] character:'@' isInClass:HKWCharacterClassControl]).to.beFalsy();
+    });
+
+    it(@"should find the next and previous whitespace or control characters in a string", ^{
+        NSString *text = @"ab +cd ef";
+        HKWCharacterClass mask = HKWCharacterClassWhitespace | HKWCharacterClassControl;
+        expect([classifier nextIndexOfCharacterInClass:mask inString:text fromIndex:0]).to.equal(2);
+        expect([classifier nextIndexOfCharacterInClass:HKWCharacterClassControl inString:text fromIndex:0]).to.equal(3);
+        expect([classifier nextIndexOfCharacterInClass:mask inString:text fromIndex:7]).to.equal([text length]);
+        expect([classifier previousIndexOfCharacterInClass:mask inString:text range:NSMakeRange(0, [text length])]).to.equal(6);
+        expect([classifier previousIndexOfCharacterInClass:mask inString:text range:NSMakeRange(4, 2)]).to.equal(NSNotFound);
+    });
+
+    it(@"should find characters in a buffer", ^{
+        const unichar characters[] = { 'a', 'b', '@', 'c', ' ' };
+        expect([classifier nextIndexOfCharacterInClass:HKWCharacterClassControl
+                                          inCharacters:characters
+                                                length:5
+                                             fromIndex:0]).to.equal(2);
+        expect([classifier previousIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                              inCharacters:characters
+                                                    length:5
+                                                     range:NSMakeRange(0, 4)]).to.equal(NSNotFound);
+    });
+
+    it(@"should share one reader between several scans of a string", ^{
+        // A mutable string doesn't expose its characters directly, so it is read through the reader's inline buffer
+        NSMutableString *text = [NSMutableString stringWithString:@"hi +cd ef"];
+        HKWCharacterReader reader;
+        HKWCharacterReaderInitWithString(&reader, text);
+        NSUInteger controlLocation = [classifier previousIndexOfCharacterInClass:HKWCharacterClassControl
+                                                                        inReader:&reader
+                                                                           range:NSMakeRange(0, 6)];
+        expect(controlLocation).to.equal(3);
+        expect(HKWCharacterReaderCharacterAtIndex(&reader, controlLocation - 1)).to.equal(' ');
+        expect([classifier nextIndexOfCharacterInClass:HKWCharacterClassWhitespace
+                                              inReader:&reader
+                                             fromIndex:controlLocation]).to.equal(6);
+        expect(HKWCharacterReaderCharacterAtIndex(&reader, [text length])).to.equal(0);
+    });
+
+    it(@"should classify surrogate pairs as a single character", ^{
+        HKWCharacterClassifier *emojiClassifier = [HKWCharacterClassifier classifierWithControlCharacterSet:[NSCharacterSet characterSetWithCharactersInString:@"\U0001F600"]];
+        NSString *text = @"a\U0001F600b\U0001F601";
+        expect([emojiClassifier classOfLongCharacter:0x1F600]).to.equal(HKWCharacterClassControl);
+        expect([emojiClassifier nextIndexOfCharacterInClass:HKWCharacterClassControl inString:text fromIndex:0]).to.equal(1);
+        expect([emojiClassifier previousIndexOfCharacterInClass:HKWCharacterClassControl
+                                                       inString:text
+                                                          range:NSMakeRange(0, [text length])]).to.equal(1);
+    });
+});
+
+SpecEnd
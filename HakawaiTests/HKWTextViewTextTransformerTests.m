@@ -18,6 +18,26 @@
 
 #import "HKWTextView+TextTransformation.h"
 
+@interface HKWTTransformationRecordingDelegate : NSObject <HKWTextViewDelegate>
+@property (nonatomic) NSUInteger changeCount;
+@property (nonatomic, strong) NSAttributedString *lastNewText;
+@property (nonatomic, strong) NSAttributedString *lastOriginalText;
+@property (nonatomic) NSRange lastOriginalRange;
+@end
+
+@implementation HKWTTransformationRecordingDelegate
+
+- (void)textView:(__unused HKWTextView *)textView didChangeAttributedTextTo:(NSAttributedString *)newText
+    originalText:(NSAttributedString *)originalText
+   originalRange:(NSRange)originalRange {
+    self.changeCount++;
+    self.lastNewText = newText;
+    self.lastOriginalText = originalText;
+    self.lastOriginalRange = originalRange;
+}
+
+@end
+
 SpecBegin(transformTextAtRange)
 
 describe(@"transformTextAtRange with plain text", ^{
@@ -86,6 +106,116 @@ describe(@"transformTextAtRange with plain text", ^{
     });
 });
 
+describe(@"transformTextAtRange editing the text storage in place", ^{
+    NSString *baseString = @"The quick brown fox jumps over the lazy dog";
+    __block HKWTextView *textView;
+
+    beforeEach(^{
+        HKWTextView.enableInPlaceTextTransformation = YES;
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        textView.attributedText = [[NSAttributedString alloc] initWithString:baseString];
+    });
+
+    afterEach(^{
+        HKWTextView.enableInPlaceTextTransformation = NO;
+    });
+
+    it(@"should properly transform text in middle", ^{
+        NSTextStorage *textStorage = textView.textStorage;
+        [textView transformTextAtRange:NSMakeRange(5, 12) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+            return [[NSAttributedString alloc] initWithString:@"blah_string"];
+        }];
+        expect(textView.text).to.equal(@"The qblah_stringox jumps over the lazy dog");
+        expect(textView.textStorage).to.beIdenticalTo(textStorage);
+    });
+
+    it(@"should properly trim ranges whose ends are out of range", ^{
+        [textView transformTextAtRange:NSMakeRange(10, 1000) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+            return [[NSAttributedString alloc] initWithString:@"~~~~ !!!! ~~~~"];
+        }];
+        expect(textView.text).to.equal(@"The quick ~~~~ !!!! ~~~~");
+    });
+
+    it(@"should properly handle an empty string for transformed text", ^{
+        [textView transformTextAtRange:NSMakeRange(0, 11) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+            return nil;
+        }];
+        expect(textView.text).to.equal(@"rown fox jumps over the lazy dog");
+    });
+
+    it(@"should restore the insertion point if the length is unchanged", ^{
+        textView.selectedRange = NSMakeRange(7, 0);
+        [textView transformTextAtRange:NSMakeRange(4, 5) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+            return [[NSAttributedString alloc] initWithString:@"QUICK"];
+        }];
+        expect(textView.selectedRange.location).to.equal(7);
+        expect(textView.selectedRange.length).to.equal(0);
+    });
+
+    it(@"should shift the insertion point if it follows the transformed text", ^{
+        textView.selectedRange = NSMakeRange(20, 0);
+        [textView transformTextAtRange:NSMakeRange(4, 5) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+            return [[NSAttributedString alloc] initWithString:@"slow"];
+        }];
+        expect(textView.text).to.equal(@"The slow brown fox jumps over the lazy dog");
+        expect(textView.selectedRange.location).to.equal(19);
+        expect(textView.selectedRange.length).to.equal(0);
+    });
+});
+
+describe(@"performBatchTransformations", ^{
+    NSString *baseString = @"The quick brown fox jumps over the lazy dog";
+    __block HKWTextView *textView;
+    __block HKWTTransformationRecordingDelegate *delegate;
+
+    beforeEach(^{
+        textView = [[HKWTextView alloc] initWithFrame:CGRectMake(0, 0, 100, 100)];
+        textView.attributedText = [[NSAttributedString alloc] initWithString:baseString];
+        delegate = [HKWTTransformationRecordingDelegate new];
+        textView.externalDelegate = delegate;
+    });
+
+    it(@"should apply every transformation and notify the delegate once", ^{
+        [textView performBatchTransformations:^{
+            [textView transformTextAtRange:NSMakeRange(16, 3) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+                return [[NSAttributedString alloc] initWithString:@"cat"];
+            }];
+            [textView transformTextAtRange:NSMakeRange(4, 5) withTransformer:^NSAttributedString *(__unused NSAttributedString *s) {
+                return [[NSAttributedString alloc] initWithString:@"slow"];
+            }];
+        }];
+        expect(textView.text).to.equal(@"The slow brown cat jumps over the lazy dog");
+        expect(delegate.changeCount).to.equal(1);
+        expect(delegate.lastOriginalText.string).to.equal(@"quick brown fox");
+        expect(delegate.lastNewText.string).to.equal(@"slow brown cat");
+        expect(delegate.lastOriginalRange.location).to.equal(4);
+        expect(delegate.lastOriginalRange.length).to.equal(15);
+    });
+
+    it(@"should shift an insertion point that follows the changed text", ^{
+        textView.selectedRange = NSMakeRange(30, 0);
+        [textView performBatchTransformations:^{
+            [textView removeTextForRange:NSMakeRange(4, 6)];
+            [textView removeTextForRange:NSMakeRange(10, 4)];
+        }];
+        expect(textView.text).to.equal(@"The brown jumps over the lazy dog");
+        expect(textView.selectedRange.location).to.equal(20);
+        expect(textView.selectedRange.length).to.equal(0);
+    });
+
+    it(@"should only finish the outermost transaction", ^{
+        [textView performBatchTransformations:^{
+            [textView performBatchTransformations:^{
+                [textView removeTextForRange:NSMakeRange(0, 4)];
+            }];
+            expect(delegate.changeCount).to.equal(0);
+            [textView removeTextForRange:NSMakeRange(0, 6)];
+        }];
+        expect(textView.text).to.equal(@"brown fox jumps over the lazy dog");
+        expect(delegate.changeCount).to.equal(1);
+    });
+});
+
 describe(@"transformTextAtRange with attributed text", ^{
     NSString *baseString = @"The quick brown fox jumps over the lazy dog";
     NSString *replacementString = @"## TEST ##";
@@ -13,7 +13,24 @@
 #import "HKWMentionsPlugin.h"
 #import "HKWTDummyMentionEntity.h"
 
-@interface HKWTDummyMentionsManager: NSObject<HKWMentionsDefaultChooserViewDelegate>
+@interface HKWTDummyMentionsManager: NSObject<HKWMentionsDefaultChooserViewDelegate, HKWMentionsTypeaheadSource>
+
+/// If set, requests are held until completed with \c completeRequestAtIndex:withResults:isComplete:, instead of being
+/// answered immediately.
+@property (nonatomic) BOOL holdsRequests;
+
+/// If set, held requests are completed asynchronously on this queue, as a data source calling back from a background
+/// thread would.
+@property (nonatomic, strong) dispatch_queue_t callbackQueue;
+
+/// The cancellation tokens of all requests made so far, in order.
+@property (nonatomic, readonly) NSMutableArray<HKWMentionsCancellationToken *> *cancellationTokens;
+
+/// The priority and deadline of the manager when it is used as an additional typeahead source.
+@property (nonatomic) NSInteger sourcePriority;
+@property (nonatomic) NSTimeInterval sourceTimeout;
+
+- (void)completeRequestAtIndex:(NSUInteger)requestIndex withResults:(NSArray *)results isComplete:(BOOL)isComplete;
 
 - (void)asyncRetrieveEntitiesForKeyString:(NSString *)keyString
                                searchType:(HKWMentionsSearchType)type
@@ -12,8 +12,47 @@
 
 #import "HKWTDummyMentionsManager.h"
 
+@interface HKWTDummyMentionsManager ()
+
+@property (nonatomic, readwrite) NSMutableArray<HKWMentionsCancellationToken *> *cancellationTokens;
+@property (nonatomic) NSMutableArray *heldCompletionBlocks;
+
+@end
+
 @implementation HKWTDummyMentionsManager
 
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _cancellationTokens = [NSMutableArray array];
+        _heldCompletionBlocks = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)asyncRetrieveEntitiesForKeyString:(NSString *)keyString
+                               searchType:(HKWMentionsSearchType)type
+                         controlCharacter:(unichar)character
+                        cancellationToken:(HKWMentionsCancellationToken *)cancellationToken
+                               completion:(void(^)(NSArray *results, BOOL dedupe, BOOL isComplete))completionBlock {
+    [self.cancellationTokens addObject:cancellationToken];
+    if (self.holdsRequests) {
+        [self.heldCompletionBlocks addObject:[completionBlock copy]];
+        return;
+    }
+    [self asyncRetrieveEntitiesForKeyString:keyString searchType:type controlCharacter:character completion:completionBlock];
+}
+
+- (void)completeRequestAtIndex:(NSUInteger)requestIndex withResults:(NSArray *)results isComplete:(BOOL)isComplete {
+    void (^completionBlock)(NSArray *, BOOL, BOOL) = self.heldCompletionBlocks[requestIndex];
+    if (self.callbackQueue) {
+        dispatch_async(self.callbackQueue, ^{
+            completionBlock(results, YES, isComplete);
+        });
+        return;
+    }
+    completionBlock(results, YES, isComplete);
+}
 - (void)asyncRetrieveEntitiesForKeyString:(__unused NSString *)keyString
                                searchType:(HKWMentionsSearchType)type
                          controlCharacter:(__unused unichar)character